@@ -15,6 +15,14 @@
  *	.data	-- initialized data
  *	.bss/.sbss -- uninitialized data (should be zero'd on program startup)
  *
+ * Normally the segments are packed back to back in the NOFF file.  With
+ * -a, each one starts in a new sector of the file (NOFFALIGN bytes), at
+ * the same offset within the sector as its address within its page, so
+ * that every page of the program is a whole sector of the file; the
+ * header then has NOFFMAGICALIGNED for its magic number.  For the code
+ * to have pages of its own, which can be mapped read-only, the data must
+ * also be linked to start on a new page (cf. test/script).
+ *
  * Copyright (c) 1992-1993 The Regents of the University of California.
  * All rights reserved.  See copyright.h for copyright notice and limitation 
  * of liability and disclaimer of warranty provisions.
@@ -89,17 +97,35 @@ void Write(int fd, char *buf, int nBytes)
     }
 }
 
+/* where in the NOFF file to put a segment at "virtualAddr", the next free
+ * byte of the file being "inNoffFile"
+ */
+int Place(int inNoffFile, int virtualAddr, int aligned)
+{
+    int offset = virtualAddr % NOFFALIGN;
+
+    if (!aligned)
+	return inNoffFile;
+    inNoffFile = (inNoffFile + NOFFALIGN - 1) / NOFFALIGN * NOFFALIGN;
+    return inNoffFile + offset;
+}
+
 main (int argc, char **argv)
 {
-    int fdIn, fdOut, numsections, i, inNoffFile;
+    int fdIn, fdOut, numsections, i, inNoffFile, aligned = 0;
     struct filehdr fileh;
     struct aouthdr systemh;
     struct scnhdr *sections;
     char *buffer;
     NoffHeader noffH;
 
-    if (argc < 2) {
-	fprintf(stderr, "Usage: %s <coffFileName> <noffFileName>\n", argv[0]);
+    if (argc > 1 && !strcmp(argv[1], "-a")) {
+	aligned = 1;
+	argc--, argv++;
+    }
+    if (argc < 3) {
+	fprintf(stderr, "Usage: %s [-a] <coffFileName> <noffFileName>\n", 
+		argv[0]);
 	exit(1);
     }
     
@@ -152,10 +178,8 @@ main (int argc, char **argv)
  /* initialize the NOFF header, in case not all the segments are defined
   * in the COFF file
   */
-    noffH.noffMagic = NOFFMAGIC;
-    noffH.code.size = 0;
-    noffH.initData.size = 0;
-    noffH.uninitData.size = 0;
+    memset((char *) &noffH, 0, sizeof(noffH));
+    noffH.noffMagic = aligned ? NOFFMAGICALIGNED : NOFFMAGIC;
 
  /* Copy the segments in */
     inNoffFile = sizeof(NoffHeader);
@@ -168,6 +192,8 @@ main (int argc, char **argv)
 	if (sections[i].s_size == 0) {
 		/* do nothing! */	
 	} else if (!strcmp(sections[i].s_name, ".text")) {
+	    inNoffFile = Place(inNoffFile, sections[i].s_paddr, aligned);
+	    lseek(fdOut, inNoffFile, 0);
 	    noffH.code.virtualAddr = sections[i].s_paddr;
 	    noffH.code.inFileAddr = inNoffFile;
 	    noffH.code.size = sections[i].s_size;
@@ -186,6 +212,8 @@ main (int argc, char **argv)
 	        unlink(noffFileName);
 	        exit(1);
 	    }
+	    inNoffFile = Place(inNoffFile, sections[i].s_paddr, aligned);
+	    lseek(fdOut, inNoffFile, 0);
 	    noffH.initData.virtualAddr = sections[i].s_paddr;
 	    noffH.initData.inFileAddr = inNoffFile;
 	    noffH.initData.size = sections[i].s_size;
@@ -219,6 +247,16 @@ main (int argc, char **argv)
 	    exit(1);
 	}
     }
+    if (aligned && noffH.code.size > 0 && noffH.initData.size > 0
+	    && noffH.initData.virtualAddr / NOFFALIGN
+		== (noffH.code.virtualAddr + noffH.code.size - 1) / NOFFALIGN)
+	fprintf(stderr, "Warning: code and data share page %d, so it can't "
+		"be read-only\n", noffH.initData.virtualAddr / NOFFALIGN);
+    if (aligned && inNoffFile % NOFFALIGN != 0) {
+	/* pad out the last sector, so it can be read whole */
+	lseek(fdOut, inNoffFile / NOFFALIGN * NOFFALIGN + NOFFALIGN - 1, 0);
+	Write(fdOut, "", 1);
+    }
     lseek(fdOut, 0, 0);
     Write(fdOut, (char *)&noffH, sizeof(NoffHeader));
     close(fdIn);
@@ -5,9 +5,21 @@
  *	code (read-only), initialized data, and unitialized data
  */
 
+#ifndef NOFF_H
+#define NOFF_H
+
 #define NOFFMAGIC	0xbadfad 	/* magic number denoting Nachos 
 					 * object code file 
 					 */
+#define NOFFMAGICALIGNED 0xbadfae	/* same, but page-aligned: each 
+					 * segment starts in a new sector of 
+					 * the file, at the same offset in 
+					 * it as in its first page (cf. 
+					 * coff2noff -a) 
+					 */
+#define NOFFALIGN	128		/* the sector size, which is also 
+					 * the page size 
+					 */
 
 typedef struct segment {
   int virtualAddr;		/* location of segment in virt addr space */
@@ -23,3 +35,5 @@ typedef struct noffHeader {
 				 * should be zero'ed before use 
 				 */
 } NoffHeader;
+
+#endif /* NOFF_H */
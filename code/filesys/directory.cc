@@ -32,6 +32,7 @@
 #include "utility.h"
 #include "filehdr.h"
 #include "directory.h"
+#include "system.h"
 
 //----------------------------------------------------------------------
 // Directory::Directory
@@ -260,7 +261,14 @@ bool Directory::Clear(OpenFile* freeMapFile,OpenFile* curFile,int n)
                 delFile=new OpenFile(table[i].sector);
                 delDir->FetchFrom(delFile);
                 delDir->Clear(freeMapFile,delFile,n);
+                delete delFile;
             }
+#ifdef USER_PROGRAM
+            else {
+                textCache->Invalidate(sector);	// in case it's an executable
+                imageCache->Invalidate(sector);
+            }
+#endif
             DEBUG('f',"------2----------%d\n",sector);
             fileHdr->FetchFrom(table[i].sector);
             freeMap->FetchFrom(freeMapFile);
@@ -269,6 +277,7 @@ bool Directory::Clear(OpenFile* freeMapFile,OpenFile* curFile,int n)
             DEBUG('f',"------4----------%d\n",sector);
             freeMap->Clear(table[i].sector);
             freeMap->WriteBack(freeMapFile);
+            ForgetInode(table[i].sector);	// in case it's still open
             Remove(table[i].name);
             table[i].inUse=false;
         }
@@ -279,5 +288,6 @@ bool Directory::Clear(OpenFile* freeMapFile,OpenFile* curFile,int n)
 
     delete fileHdr;
     delete freeMap;
+    delete delDir;
     return true;
 }
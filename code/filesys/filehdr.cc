@@ -27,60 +27,122 @@
 #include "system.h"
 #include "filehdr.h"
 
+//----------------------------------------------------------------------
+// AllocateNear
+// 	Allocate a free sector as close as we can to "sector": the first
+//	free one at or after it in its group, or failing that, anywhere in
+//	the group.  If the group is full, spill into the neighbouring
+//	groups, working outwards one group at a time on either side.
+//	Return -1 if the disk is full.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"sector" is where we would most like the new sector to be
+//----------------------------------------------------------------------
+
+int
+AllocateNear(BitMap *freeMap, int sector)
+{
+    int home, group, distance, side, i, which;
+
+    sector %= NumSectors;
+    home = sector / SectorsPerGroup;
+    for (distance = 0; distance < NumGroups; distance++)
+	for (side = -1; side <= 1; side += 2) {
+	    group = home + side * distance;
+	    if (group < 0 || group >= NumGroups
+			|| (distance == 0 && side > 0))
+		continue;
+	    for (i = 0; i < SectorsPerGroup; i++) {
+		if (group == home)	// start looking at "sector"
+		    which = group * SectorsPerGroup 
+				+ (sector + i) % SectorsPerGroup;
+		else
+		    which = group * SectorsPerGroup + i;
+		if (!freeMap->Test(which)) {
+		    freeMap->Mark(which);
+		    return which;
+		}
+	    }
+	}
+    return -1;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Allocate
 // 	Initialize a fresh file header for a newly created file.
 //	Allocate data blocks for the file out of the map of free disk blocks.
 //	Return FALSE if there are not enough free blocks to accomodate
-//	the new file.
+//	the new file.  A file that fits in the header gets no data blocks,
+//	unless "canInline" is FALSE.
 //
 //	"freeMap" is the bit map of free disk sectors
 //	"fileSize" is the bit map of free disk sectors
+//	"hdrSector" is the disk sector holding this header
+//	"canInline" is whether a small file can be kept in the header
 //----------------------------------------------------------------------
 
 bool
-FileHeader::Allocate(BitMap *freeMap, int fileSize)
+FileHeader::Allocate(BitMap *freeMap, int fileSize, int hdrSector,
+		     bool canInline)
 { 
+    int next = hdrSector + 1;
+
     numBytes = fileSize;
+    if (canInline && fileSize <= MaxInlineSize) {
+	numSectors = 0;
+	ClearInline();
+	return TRUE;
+    }
     numSectors  = divRoundUp(fileSize, SectorSize);
     if (freeMap->NumClear() < numSectors)
    	    return FALSE;		// not enough space
 
-    for (int i = 0; i < numSectors; i++)
-	     dataSectors[i] = freeMap->Find();
+    for (int i = 0; i < numSectors; i++) {
+	dataSectors[i] = AllocateNear(freeMap, next);
+	next = dataSectors[i] + 1;
+    }
     return TRUE;
 }
-bool FileHeader::Allocate(BitMap *freeMap, int fileSize, int incrementBytes) {
-    if (numSectors > 30) 
-     return false; //超出限定的文件大小（文件最大限定 128*30 个字节）
-    if ( (fileSize==0) &&( incrementBytes>0) ) { //在一个空文件后追加数据
-     if (freeMap->NumClear() <1) //至少需要一个扇区块
-     return false; 
-  
-    dataSectors[0] = freeMap->Find();
-    numSectors = 1; 
-    numBytes = 0;
-    } 
-    numBytes=fileSize;
-    int offsetr= numBytes % SectorSize; //原文件最后一个扇区块数据偏移量
-    int newSectorBytes = incrementBytes - (SectorSize - (offsetr + 1));
-    //最后一个扇区块剩余空间足以容纳追加数据, 不需分配新的扇区块
-    if (newSectorBytes <= 0 ) { 
-     numBytes = numBytes + incrementBytes; //更新文件头中的文件大小
-     return TRUE;
+
+//----------------------------------------------------------------------
+// FileHeader::Extend
+// 	Add "moreSectors" data sectors to the end of the file, all at
+//	once.  Each new sector is placed right after the one before it
+//	whenever that sector is free, so that a file which grows by
+//	appending still ends up laid out contiguously on disk, and at
+//	worst in the same group.  The first data sector of an empty file
+//	goes right after its header.
+//	Return FALSE if the file would get too big, or if there are not
+//	enough free sectors.
+//
+//	The length of the file is left alone; the caller sets it.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"moreSectors" is the number of data sectors to add
+//	"hdrSector" is the disk sector holding this header
+//----------------------------------------------------------------------
+
+bool
+FileHeader::Extend(BitMap *freeMap, int moreSectors, int hdrSector)
+{
+    int next;
+
+    if (numSectors + moreSectors > (int) NumDirect)
+	return FALSE;			// file too big
+    if (freeMap->NumClear() < moreSectors)
+	return FALSE;			// not enough space
+
+    if (numSectors > 0)
+	next = dataSectors[numSectors - 1] + 1;
+    else
+	next = hdrSector + 1;
+    for (int i = 0; i < moreSectors; i++) {
+	dataSectors[numSectors] = AllocateNear(freeMap, next);
+	next = dataSectors[numSectors++] + 1;
     }
-    //最后一个扇区的剩余空间不足以容纳要写入的数据，分配新的磁盘块
-    int moreSectors = divRoundUp(newSectorBytes, SectorSize); //新加扇区块数
-    if (numSectors + moreSectors > 30)
-     return FALSE; //文件过块
-    if (freeMap->NumClear() < moreSectors) //磁盘无足够的空闲块
-     return false; 
-    for ( int i = numSectors; i < numSectors + moreSectors; i++ )
-    dataSectors[i] = freeMap->Find();
-    numBytes = numBytes + incrementBytes; 
-    numSectors = numSectors + moreSectors; 
     return TRUE;
 }
+
 //----------------------------------------------------------------------
 // FileHeader::Deallocate
 // 	De-allocate all the space allocated for data blocks for this file.
@@ -150,6 +212,20 @@ FileHeader::FileLength()
     return numBytes;
 }
 
+//----------------------------------------------------------------------
+// PrintByte
+// 	Print one byte of a file, escaping anything unprintable.
+//----------------------------------------------------------------------
+
+static void
+PrintByte(char c)
+{
+    if ('\040' <= c && c <= '\176')   // isprint(c)
+	printf("%c", c);
+    else
+	printf("\\%x", (unsigned char)c);
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Print
 // 	Print the contents of the file header, and the contents of all
@@ -160,20 +236,25 @@ void
 FileHeader::Print()
 {
     int i, j, k;
-    char *data = new char[SectorSize];
+    char *data;
 
+    if (IsInline()) {
+	printf("FileHeader contents.  File size: %d.  Inline data:\n", 
+							numBytes);
+	for (j = 0; j < numBytes; j++)
+	    PrintByte(InlineData()[j]);
+	printf("\n");
+	return;
+    }
+    data = new char[SectorSize];
     printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
     for (i = 0; i < numSectors; i++)
 	printf("%d ", dataSectors[i]);
     printf("\nFile contents:\n");
     for (i = k = 0; i < numSectors; i++) {
 	synchDisk->ReadSector(dataSectors[i], data);
-        for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
-	    if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
-		printf("%c", data[j]);
-            else
-		printf("\\%x", (unsigned char)data[j]);
-	}
+        for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++)
+	    PrintByte(data[j]);
         printf("\n"); 
     }
     delete [] data;
@@ -19,6 +19,19 @@
 
 #define NumDirect 	((SectorSize - 2 * sizeof(int)) / sizeof(int))
 #define MaxFileSize 	(NumDirect * SectorSize)
+#define MaxInlineSize 	((int) (NumDirect * sizeof(int)))
+
+// The disk is split into groups of neighbouring tracks (the "cylinder
+// groups" of the BSD fast file system).  A directory has a home group,
+// and the files created in it -- their headers and their data -- are
+// placed in that group too, so that going from a directory to a file
+// and on to the file's data rarely means a long seek.
+#define TracksPerGroup 	4
+#define SectorsPerGroup (TracksPerGroup * SectorsPerTrack)
+#define NumGroups 	(NumTracks / TracksPerGroup)
+
+extern int AllocateNear(BitMap *freeMap, int sector);
+					// Allocate a sector close to "sector"
 
 // The following class defines the Nachos "file header" (in UNIX terms,  
 // the "i-node"), describing where on disk to find all of the data in the file.
@@ -31,16 +44,28 @@
 // as one disk sector.  Without indirect addressing, this
 // limits the maximum file length to just under 4K bytes.
 //
+// A file small enough (at most MaxInlineSize bytes) is kept "inline":
+// it has no data blocks at all, and its contents are stored in the
+// header sector itself, in place of the table of pointers.  Such a
+// file can be opened and read with a single disk read.  It is moved
+// out to data blocks when it grows too big (cf. OpenFile::WriteAt).
+//
 // There is no constructor; rather the file header can be initialized
 // by allocating blocks for the file (if it is a new file), or by
 // reading it from disk.
 
 class FileHeader {
   public:
-  bool Allocate(BitMap *freeMap, int fileSize, int incrementBytes);
-    bool Allocate(BitMap *bitMap, int fileSize);// Initialize a file header, 
+    bool Allocate(BitMap *bitMap, int fileSize, int hdrSector,
+		  bool canInline = TRUE);
+						// Initialize a file header, 
 						//  including allocating space 
-						//  on disk for the file data
+						//  on disk for the file data,
+						//  near the header
+    bool Extend(BitMap *freeMap, int moreSectors, int hdrSector);
+						// Add data sectors to the
+						//  end of the file, laid out
+						//  contiguously if possible
     void Deallocate(BitMap *bitMap);  		// De-allocate this file's 
 						//  data blocks
 
@@ -54,6 +79,18 @@ class FileHeader {
 
     int FileLength();			// Return the length of the file 
 					// in bytes
+    void SetLength(int length) { numBytes = length; }
+					// Change the length, once the data
+					// sectors for it have been arranged
+    int AllocatedLength() { return numSectors * SectorSize; }
+					// How much of the file the data
+					// sectors can hold
+
+    bool IsInline() 			// Is the data kept in the header?
+	{ return (bool) (numSectors == 0 && numBytes <= MaxInlineSize); }
+    char *InlineData() { return (char *) dataSectors; }
+    void ClearInline()			// Forget the inline data, before
+	{ bzero(dataSectors, sizeof(dataSectors)); }	// adding sectors
 
     void Print();			// Print the contents of the file.
     FileHeader()
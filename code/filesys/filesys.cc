@@ -28,9 +28,22 @@
 //	modified part of the directory and/or bitmap, we simply discard
 //	the changed version, without writing it back to disk.
 //
+//	Concurrent accesses are synchronized with a lock per directory
+//	(held while its entries are fetched, changed and written back),
+//	a readers/writers lock per open file (cf. openfile.h), a lock on
+//	the bitmap of free sectors, and a lock on the table of open files.
+//	They are always acquired in that order: a write to a file takes
+//	the free map lock to give it sectors, and the free map lock is
+//	held while a removed file is taken out of the table of open
+//	files.  The only files read or written under the free map lock
+//	are the free map file itself, and the directories RemoveDir is
+//	emptying; neither ever grows, so neither waits for the free map.
+//	Looking a name up takes no directory lock: a directory is
+//	read in one piece under its file's lock, so lookups always see a
+//	consistent version of it.
+//
 // 	Our implementation at this point has the following restrictions:
 //
-//	   there is no synchronization for concurrent accesses
 //	   files have a fixed size, set when the file is created
 //	   files cannot be bigger than about 3KB in size
 //	   there is no hierarchical directory structure, and only a limited
@@ -50,6 +63,8 @@
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
+#include "synch.h"
+#include "system.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
 // and the directory of files.  These file headers are placed in well-known 
@@ -60,7 +75,8 @@
 // Initial file sizes for the bitmap and directory; until the file system
 // supports extensible files, the directory size sets the maximum number 
 // of files that can be loaded onto the disk.
-#define FreeMapFileSize 	(NumSectors / BitsInByte)
+#define FreeMapFileSize 	(divRoundUp(NumSectors, BitsInWord) \
+					* (int) sizeof(unsigned))
 #define NumDirEntries 		10
 #define DirectoryFileSize 	(sizeof(DirectoryEntry) * NumDirEntries)
 
@@ -80,6 +96,8 @@
 FileSystem::FileSystem(bool format)
 { 
     DEBUG('f', "Initializing the file system.\n");
+    freeMapLock = new Lock("free map lock");
+    reservedSectors = 0;
     if (format) {
         BitMap *freeMap = new BitMap(NumSectors);    //free sector map
         Directory *directory = new Directory(NumDirEntries); //initialize the directory table
@@ -95,9 +113,13 @@ FileSystem::FileSystem(bool format)
 
     // Second, allocate space for the data blocks containing the contents
     // of the directory and bitmap files.  There better be enough space!
+    // Neither is kept inline, however small: an inline file only reaches
+    // the disk when it is flushed, and these two are never closed.
 
-	ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize));
-	ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize));
+	ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize, FreeMapSector, 
+								FALSE));
+	ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize, DirectorySector, 
+								FALSE));
 
     // Flush the bitmap and directory FileHeaders back to disk
     // We need to do this before we can "Open" the file, since open
@@ -142,6 +164,102 @@ FileSystem::FileSystem(bool format)
     }
 }
 
+//----------------------------------------------------------------------
+// FileSystem::LockFreeMap/UnlockFreeMap
+// 	Serialize updates to the bitmap of free sectors.  Anyone who
+//	fetches the bitmap to allocate or free sectors must hold the lock
+//	until the bitmap has been written back (or discarded).
+//----------------------------------------------------------------------
+
+void
+FileSystem::LockFreeMap()
+{
+    freeMapLock->Acquire();
+}
+
+void
+FileSystem::UnlockFreeMap()
+{
+    freeMapLock->Release();
+}
+
+//----------------------------------------------------------------------
+// FileSystem::ReserveSectors/UnreserveSectors
+// 	Data appended to a file is kept in memory, and only given disk
+//	sectors when the file is flushed (cf. OpenFile::WriteAt).  So that
+//	the flush can't run out of space, the appender reserves the sectors
+//	it will need up front; Create and friends leave reserved sectors
+//	alone.
+//
+//	ReserveSectors returns FALSE if there isn't enough unreserved free
+//	space.  UnreserveSectors must be called with the free map lock
+//	held, just before the reserved sectors are really allocated (or
+//	when the data they were for is thrown away).
+//
+//	"numSectors" -- how many sectors to reserve or give back
+//----------------------------------------------------------------------
+
+bool
+FileSystem::ReserveSectors(int numSectors)
+{
+    BitMap *freeMap;
+    bool success;
+
+    LockFreeMap();
+    freeMap = getBitMap();
+    success = HasRoom(freeMap, numSectors);
+    if (success)
+	reservedSectors += numSectors;
+    UnlockFreeMap();
+    delete freeMap;
+    return success;
+}
+
+void
+FileSystem::UnreserveSectors(int numSectors)
+{
+    ASSERT(reservedSectors >= numSectors);
+    reservedSectors -= numSectors;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::HasRoom
+// 	Return TRUE if "freeMap" has "numSectors" free sectors besides
+//	those reserved for buffered appends.
+//----------------------------------------------------------------------
+
+bool
+FileSystem::HasRoom(BitMap *freeMap, int numSectors)
+{
+    return (bool) (freeMap->NumClear() - reservedSectors >= numSectors);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::DirectoryGroup
+// 	Choose the home group for a new directory: the one with the most
+//	free sectors, so that directories, and the files that will be
+//	created in them, are spread out over the disk rather than all
+//	crowding into the first group.
+//----------------------------------------------------------------------
+
+int
+FileSystem::DirectoryGroup(BitMap *freeMap)
+{
+    int group, i, numFree, best = 0, bestFree = -1;
+
+    for (group = 0; group < NumGroups; group++) {
+	numFree = 0;
+	for (i = group * SectorsPerGroup; i < (group + 1) * SectorsPerGroup; i++)
+	    if (!freeMap->Test(i))
+		numFree++;
+	if (numFree > bestFree) {
+	    best = group;
+	    bestFree = numFree;
+	}
+    }
+    return best;
+}
+
 //----------------------------------------------------------------------
 // FileSystem::Create
 // 	Create a file in the Nachos file system (similar to UNIX create).
@@ -150,8 +268,9 @@ FileSystem::FileSystem(bool format)
 //
 //	The steps to create a file are:
 //	  Make sure the file doesn't already exist
-//        Allocate a sector for the file header
-// 	  Allocate space on disk for the data blocks for the file
+//        Allocate a sector for the file header, in the directory's group
+// 	  Allocate space on disk for the data blocks for the file, after
+//	    the header
 //	  Add the name to the directory
 //	  Store the new file header on disk 
 //	  Flush the changes to the bitmap and the directory back to disk
@@ -164,8 +283,8 @@ FileSystem::FileSystem(bool format)
 //	 	no free entry for file in directory
 //	 	no free space for data blocks for the file 
 //
-// 	Note that this implementation assumes there is no concurrent access
-//	to the file system!
+// 	The directory stays locked from the name lookup until the new entry
+//	has been written back, so two threads can't both create "name".
 //
 //	"name" -- name of file to be created
 //	"initialSize" -- size of file to be created
@@ -179,39 +298,45 @@ FileSystem::Create(char *name, int initialSize)
     FileHeader *hdr;
     int sector;
     bool success;
-    printf("Creating file\n");
+
     DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
 
+    directoryFile->LockDirectory();
     directory = new Directory(NumDirEntries);
     directory->FetchFrom(directoryFile);
-    printf("Creating file %s, size %d\n", name, initialSize);
-    if (directory->Find(name) != -1){
+    if (directory->Find(name) != -1)
       success = FALSE;			// file is already in directory
-      printf("Creating file\n");
-    }
     else {	
+        LockFreeMap();
         freeMap = new BitMap(NumSectors);
         freeMap->FetchFrom(freeMapFile);
-        sector = freeMap->Find();	// find a sector to hold the file header
+        if (!HasRoom(freeMap, 1 + divRoundUp(initialSize, SectorSize)))
+            sector = -1;		// the rest is promised to appends
+        else				// find a sector to hold the file
+            sector = AllocateNear(freeMap, directoryFile->hdrSector);
+					// header, in the directory's group
     	if (sector == -1) 		
             success = FALSE;		// no free block for file header 
         else if (!directory->Add(name, sector))
             success = FALSE;	// no space in directory
 	else {
     	    hdr = new FileHeader;
-	    if (!hdr->Allocate(freeMap, initialSize))
+	    if (!hdr->Allocate(freeMap, initialSize, sector))
             	success = FALSE;	// no space on disk for data
 	    else {	
 	    	success = TRUE;
 		// everthing worked, flush all changes back to disk
     	    	hdr->WriteBack(sector); 		
-    	    	directory->WriteBack(directoryFile);
     	    	freeMap->WriteBack(freeMapFile);
 	    }
             delete hdr;
 	}
+        UnlockFreeMap();
         delete freeMap;
+        if (success)
+    	    directory->WriteBack(directoryFile);
     }
+    directoryFile->UnlockDirectory();
     delete directory;
     return success;
 }
@@ -238,7 +363,6 @@ FileSystem::Open(char *name)
     sector = directory->Find(name); 
     if (sector >= 0) 		
 	openFile = new OpenFile(sector);	// name was found in directory 
-    printf("%d\n",sector);
     delete directory;
     return openFile;				// return NULL if not found
 }
@@ -281,11 +405,14 @@ FileSystem::Remove(char *name)
             sector=directory->Find(dirs[i],true);
             DEBUG('f', "Opening filesss %d\n", sector);
             if(sector==-1){
-                delete dirFile;
+                if(dirFile!=directoryFile)
+                    delete dirFile;
                 delete directory;
                 return FALSE;
             }
             DEBUG('f', "Opening filesss %d\n", sector);
+            if(dirFile!=directoryFile)
+                delete dirFile;
             dirFile=new OpenFile(sector);
             directory->FetchFrom(dirFile);
         }
@@ -300,19 +427,42 @@ FileSystem::Remove(char *name)
        delete directory;
        return FALSE;			 // file not found 
     }*/
+    // look the name up again now that no one else can change the
+    // directory under us
+    dirFile->LockDirectory();
+    directory->FetchFrom(dirFile);
     sector = directory->Find(name);
+    if (sector == -1) {
+       dirFile->UnlockDirectory();
+       if (dirFile != directoryFile)
+           delete dirFile;
+       delete directory;
+       return FALSE;			 // file not found 
+    }
+#ifdef USER_PROGRAM
+    textCache->Invalidate(sector);	// in case it's an executable
+    imageCache->Invalidate(sector);
+#endif
+
+    // Read the header under the free map lock: a Flush of the file,
+    // which may give it new sectors, writes the header under it too.
+    LockFreeMap();
     fileHdr = new FileHeader;
     fileHdr->FetchFrom(sector);
-
     freeMap = new BitMap(NumSectors);
     freeMap->FetchFrom(freeMapFile);
 
     fileHdr->Deallocate(freeMap);  		// remove data blocks
     freeMap->Clear(sector);			// remove header block
-    directory->Remove(name);
     freeMap->WriteBack(freeMapFile);		// flush to disk
+    ForgetInode(sector);			// in case it's still open
+    UnlockFreeMap();
+    directory->Remove(name);
     directory->WriteBack(dirFile);        // flush to disk
+    dirFile->UnlockDirectory();
 
+    if (dirFile != directoryFile)
+        delete dirFile;
     delete fileHdr;
     delete directory;
     delete freeMap;
@@ -385,81 +535,84 @@ FileSystem::CreateDir(char**dirs,int filelength){
         fr=createdir(dirs[i],fr,cur);
         if(fr==NULL){
             printf("Directory creation failed\n");
+            if(cur!=directoryFile)
+                delete cur;
             return FALSE;
         }
         i++;
     }
     //已经到达要创建的文件
-    Directory*frr=new Directory(NumDirEntries);
-        frr->FetchFrom(directoryFile);
-        int index=frr->FindIndex(dirs[0],true);
-        DEBUG('f', "$$ppppp$$$1%d\n",index);
     bool re= createFile(dirs[i],fr,filelength,cur);
-    frr=new Directory(NumDirEntries);
-        frr->FetchFrom(directoryFile);
-        index=frr->FindIndex(dirs[0],true);
-        DEBUG('f', "$$ppppp$$$1%d\n",index);
+    if(cur!=directoryFile)
+        delete cur;
     return re;
 }
 Directory*
 FileSystem::createdir(char*name,Directory*fr,OpenFile*&in_file){
+    OpenFile*parent=in_file;
+    //整个查找-添加-写回过程都要持有父目录的锁
+    parent->LockDirectory();
+    fr->FetchFrom(parent);
     //先判断此目录下是否存在同名目录
     int find;
     find=fr->Find(name,true);
     if(find!=-1){
         //已存在同名目录
-        printf("Directory already exists%s\n",name);
+        parent->UnlockDirectory();
+        DEBUG('f',"Directory already exists %s\n",name);
         in_file=new OpenFile(find);
-        fr=new Directory(NumDirEntries);
+        if(parent!=directoryFile)
+            delete parent;
         fr->FetchFrom(in_file);
         return fr;
     }
     //要创建新目录了
     DEBUG('f',"Createing Directory %s \n",name);
+    LockFreeMap();
     BitMap* map=new BitMap(NumSectors);
-    DEBUG('f', "1\n");
     map->FetchFrom(freeMapFile);
 
-    int sector=map->Find();//获取一个空的块
+    int sector=-1;
+    if(HasRoom(map,1+divRoundUp(DirectoryFileSize,SectorSize)))
+        //新目录放在最空闲的柱面组里，它的文件以后也放在那里
+        sector=AllocateNear(map,DirectoryGroup(map)*SectorsPerGroup);
     Directory*ans=NULL;
     DEBUG('f', "1   %d\n",sector);
 
-    if(sector==-1){
+    if(sector==-1 || !fr->Add(name,sector,true)){
+        UnlockFreeMap();
+        parent->UnlockDirectory();
         delete map;
+        delete fr;
         return ans;
     }
-    else{
-        DEBUG('f', "2\n");
-        bool pk=fr->Add(name,sector,true);
-        if(!pk){
-            delete map;
-            return ans;
-        }
-
-        int index=fr->FindIndex(name,true);
-        DEBUG('f', "$$$$$%d\n",index);
-        FileHeader*pg=new FileHeader;
-        pk=pg->Allocate(map,DirectoryFileSize);
-        DEBUG('f', "2\n");
-        if(!pk){
-            delete map;
-            return ans;
-        }
-        DEBUG('f', "123456789");
-        pg->WriteBack(sector);
-        fr->WriteBack(in_file);
-
-        map->WriteBack(freeMapFile);
-        ans=new Directory(NumDirEntries);
-        in_file=new OpenFile(sector);
-        ans->FetchFrom(in_file);
-        
-
-
+    FileHeader*pg=new FileHeader;
+    if(!pg->Allocate(map,DirectoryFileSize,sector)){
+        UnlockFreeMap();
+        parent->UnlockDirectory();
         delete map;
         delete pg;
+        delete fr;
         return ans;
     }
+    pg->WriteBack(sector);
+    map->WriteBack(freeMapFile);
+    UnlockFreeMap();
+    fr->WriteBack(parent);
+    parent->UnlockDirectory();
+
+    // the data sectors may still hold an old directory, so start
+    // the new one out empty rather than reading it back
+    ans=new Directory(NumDirEntries);
+    in_file=new OpenFile(sector);
+    ans->WriteBack(in_file);
+    if(parent!=directoryFile)
+        delete parent;
+
+    delete map;
+    delete pg;
+    delete fr;
+    return ans;
 }
 bool FileSystem::createFile(char* name,Directory *in,int fileLength,OpenFile* in_file)
 {
@@ -471,17 +624,21 @@ bool FileSystem::createFile(char* name,Directory *in,int fileLength,OpenFile* in
 
     DEBUG('f', "Creating file %s, size %d\n", name, fileLength);
 
-    // make file in the directory `in`
+    // make file in the directory `in`, re-reading it under the lock
     directory = in;
-    DEBUG('f', "Creating filedwdwdwdwdwdwdw%d\n",directory->Find(name));
-    if (directory->Find(name) != -1){
+    in_file->LockDirectory();
+    directory->FetchFrom(in_file);
+    if (directory->Find(name) != -1)
       success = FALSE;			// file is already in directory
-      DEBUG('f', "Creating filedwdwdwdwdwdwdw\n");}
     else {
+        LockFreeMap();
         freeMap = new BitMap(NumSectors);
         freeMap->FetchFrom(freeMapFile);
-        sector = freeMap->Find();	// find a sector to hold the file header
-        DEBUG('f', "Creating filedwdwdwdwdwdwdw\n");
+        if (!HasRoom(freeMap, 1 + divRoundUp(fileLength, SectorSize)))
+            sector = -1;		// the rest is promised to appends
+        else				// find a sector to hold the file
+            sector = AllocateNear(freeMap, in_file->hdrSector);
+					// header, in the directory's group
 
     	if (sector == -1) 		
             success = FALSE;		// no free block for file header 
@@ -489,19 +646,22 @@ bool FileSystem::createFile(char* name,Directory *in,int fileLength,OpenFile* in
             success = FALSE;	// no space in directory
 	else {
     	    hdr = new FileHeader;
-	    if (!hdr->Allocate(freeMap, fileLength))
+	    if (!hdr->Allocate(freeMap, fileLength, sector))
             	success = FALSE;	// no space on disk for data
 	    else {	
 	    	success = TRUE;
 		// everthing worked, flush all changes back to disk
     	    	hdr->WriteBack(sector); 		
-    	    	directory->WriteBack(in_file);
     	    	freeMap->WriteBack(freeMapFile);
 	    }
             delete hdr;
 	}
+        UnlockFreeMap();
         delete freeMap;
+        if (success)
+    	    directory->WriteBack(in_file);
     }
+    in_file->UnlockDirectory();
     delete directory;
     return success;
 }
@@ -523,7 +683,13 @@ FileSystem::Open(char **name)
         directory->FetchFrom(openFile);
         sector = directory->Find(name[i],true);
         DEBUG('f', "Opening directory %s\n  %d", name[i],sector);
-        if(sector<0)return NULL;
+        // done with the parent directory, whether or not we go on
+        if(openFile!=directoryFile)
+            delete openFile;
+        if(sector<0){
+            delete directory;
+            return NULL;
+        }
         openFile=new OpenFile(sector);
         i++;
     }
@@ -531,6 +697,8 @@ FileSystem::Open(char **name)
     directory->FetchFrom(openFile);
     sector = directory->Find(name[i]); 
     DEBUG('f', "Opening filesss %d\n", sector);
+    if(openFile!=directoryFile)
+        delete openFile;
     if (sector >= 0) 		
 	openFile = new OpenFile(sector);	// name was found in directory 
 else openFile=NULL;
@@ -559,28 +727,42 @@ FileSystem::RemoveDir(char*name){
 
     for(i=0;dirs[i+1]!=NULL;i++)
     {
-        sector=dir->Find(dirs[i]);
+        sector=dir->Find(dirs[i],true);
         if(sector<0){
             printf("Cann't Find Directory %s\n",dirs[i]);
+            if(dirFile!=directoryFile)
+                delete dirFile;
+            delete dir;
             return false;
         }
+        if(dirFile!=directoryFile)
+            delete dirFile;
         dirFile=new OpenFile(sector);
         dir->FetchFrom(dirFile);
     }
 
-    // printf("Ready to CLear!\n");
-
+    // parent first, then the directory being removed; the free map
+    // is held across the whole tree, since Clear updates it as it goes
+    dirFile->LockDirectory();
+    dir->FetchFrom(dirFile);
     sector=dir->Find(dirs[i],true);
     if(sector<0){
         printf("RemoveDir: Unable to Find the directory %s\n",dirs[i]);
+        dirFile->UnlockDirectory();
+        if(dirFile!=directoryFile)
+            delete dirFile;
+        delete dir;
+        return false;
     }
-    printf("%d#############",sector);
     OpenFile* delFile=new OpenFile(sector);
     Directory* delDir=new Directory(NumDirEntries);
 
+    delFile->LockDirectory();
+    LockFreeMap();
     delDir->FetchFrom(delFile);
     // clear the content of directory dirs[i]
     delDir->Clear(freeMapFile,delFile,NumDirEntries);
+    delFile->UnlockDirectory();
 
     FileHeader* fileHdr = new FileHeader;
     fileHdr->FetchFrom(sector);
@@ -590,18 +772,22 @@ FileSystem::RemoveDir(char*name){
 
     fileHdr->Deallocate(freeMap);  		// remove data blocks
     freeMap->Clear(sector);			// remove header block
+    freeMap->WriteBack(freeMapFile);		// flush to disk
+    ForgetInode(sector);			// delFile still has it open
+    UnlockFreeMap();
     if(!dir->Remove(dirs[i],true))
         printf("RemoveDir: Unable to Remove directory %s\n",dirs[i]);
-
-    freeMap->WriteBack(freeMapFile);		// flush to disk
     dir->WriteBack(dirFile);        // flush to disk
+    dirFile->UnlockDirectory();
 
     delete dir;
     delete fileHdr;
     delete freeMap;
     delete delDir;
     delete delFile;
-    delete dirFile;
+    if(dirFile!=directoryFile)
+        delete dirFile;
+    return true;
 }
 
 void FileSystem::ListDir(char* name)
@@ -621,14 +807,20 @@ void FileSystem::ListDir(char* name)
             if((sector=dir->Find(dirs[i],true))<0)
             {
                 printf("ListDir: Unable to find directory:%s\n",dirs[i]);
+                if(curFile!=directoryFile)
+                    delete curFile;
+                delete dir;
                 return;
             }
             DEBUG('f',"starting    %d\n",sector);
+            if(curFile!=directoryFile)
+                delete curFile;
             curFile=new OpenFile(sector);
             dir->FetchFrom(curFile);
         }
         dir->List();
-        delete curFile;
+        if(curFile!=directoryFile)
+            delete curFile;
         delete dir;
         return;
     }
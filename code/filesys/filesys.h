@@ -40,6 +40,7 @@
 #include "parse.h"
 #include "directory.h"
 #include "bitmap.h"
+#include "disk.h"
 #ifdef FILESYS_STUB 		// Temporarily implement file system calls as 
 				// calls to UNIX, until the real file system
 				// implementation is available
@@ -67,6 +68,8 @@ class FileSystem {
 };
 
 #else // FILESYS
+class Lock;
+
 class FileSystem {
   public:
     FileSystem(bool format);		// Initialize the file system.
@@ -89,9 +92,16 @@ class FileSystem {
 	bool CreateDir(char**dirs,int filelength);//这个是总的处理目录的函数
 	Directory*createdir(char*dir,Directory*fr,OpenFile*&in_file);//这个函数是被总函数根据路径循环调用，创建每一级目录，fr是父目录
   
-	BitMap* getBitMap() {
-		//numSector: DISK 上总扇区数（共有 32*32=1024 个扇区）
-		BitMap *freeBitMap = new BitMap(1024); 
+	void LockFreeMap();		// Serialize changes to the bitmap
+	void UnlockFreeMap();		// of free sectors
+	bool ReserveSectors(int numSectors);
+					// Set aside room for data that
+					// will be allocated later
+	void UnreserveSectors(int numSectors);
+					// Give it back, once allocated
+
+	BitMap* getBitMap() {		// caller must hold the free map lock
+		BitMap *freeBitMap = new BitMap(NumSectors); 
 		freeBitMap->FetchFrom(freeMapFile);
 		return freeBitMap;
 	}
@@ -104,6 +114,13 @@ class FileSystem {
 					// represented as a file
    OpenFile* directoryFile;		// "Root" directory -- list of 
 					// file names, represented as a file
+   Lock* freeMapLock;			// held while the bitmap is changed
+   int reservedSectors;			// free sectors promised to buffered
+					// appends (cf. openfile.cc)
+   bool HasRoom(BitMap *freeMap, int numSectors);
+					// Are there that many free sectors
+					// that aren't reserved?
+   int DirectoryGroup(BitMap *freeMap);	// Where to put a new directory
 };
 
 #endif // FILESYS
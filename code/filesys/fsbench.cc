@@ -0,0 +1,358 @@
+// fsbench.cc
+//	Benchmark driver for the Nachos file system, run with "-bench".
+//
+//	Each workload is measured on its own: we snapshot the statistics
+//	before it starts, run it, and print one line with the difference,
+//	so that the output can be collected by a script and compared from
+//	one version of the file system to the next.  A line looks like
+//
+//	  BENCH workload=seqread xfer=128 ops=24 bytes=3072 ticks=...
+//	    reads=... writes=... seeks=... seekdist=... wall_us=...
+//
+//	(all on one line).  "ticks", "reads", "writes", "seeks" and
+//	"seekdist" come from the simulated machine (cf. stats.h);
+//	"wall_us" is the time the host actually spent, in microseconds.
+//
+//	The workloads are:
+//	   seqwrite/seqread -- grow a file by appending, then read it back,
+//		at several transfer sizes
+//	   randwrite/randread -- rewrite/read random pieces of that file
+//	   storm -- create and delete a batch of files, over and over
+//	   deepdir -- build a deep directory tree, open a file at the
+//		bottom of it repeatedly, then remove the whole tree
+//	   smallfiles -- lots of tiny files, written then read back
+//	   parread -- several threads reading the same file at once
+//
+//	The benchmark expects a freshly formatted disk ("nachos -f -bench"),
+//	since the root directory only has room for a handful of files.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#include "utility.h"
+#include "filesys.h"
+#include "system.h"
+#include "disk.h"
+#include "stats.h"
+#include "parse.h"
+#include "synch.h"
+
+#define BenchFileName 	"bseq"
+#define BenchFileSize 	(24 * SectorSize)	// fits without indirection
+#define BenchRandomOps 	32		// requests per random workload
+#define StormRounds 	16		// create/delete storm iterations
+#define StormFiles 	6		// files created per storm round
+#define StormFileSize 	SectorSize
+#define DeepDirPath 	"./b0/b1/b2/b3/b4/b5/leaf"
+#define DeepDirRoot 	"./b0"
+#define DeepDirOpens 	16		// lookups of the leaf file
+#define SmallFiles 	6
+#define SmallFileSize 	100
+#define ParallelReaders 4		// threads in the parread workload
+
+static int xferSizes[] = { 16, 128, 512, 1024 };
+#define NumXferSizes 	(int)(sizeof(xferSizes) / sizeof(int))
+
+// The counters we report, captured at the start of a workload.
+static int startTicks, startReads, startWrites, startSeeks, startSeekDist;
+static double startWall;
+
+static void
+BenchStart()
+{
+    startTicks = stats->totalTicks;
+    startReads = stats->numDiskReads;
+    startWrites = stats->numDiskWrites;
+    startSeeks = stats->numDiskSeeks;
+    startSeekDist = stats->diskSeekDistance;
+    startWall = WallClock();
+}
+
+static void
+BenchReport(char *workload, int xfer, int ops, int bytes)
+{
+    printf("BENCH workload=%s xfer=%d ops=%d bytes=%d ticks=%d reads=%d "
+	"writes=%d seeks=%d seekdist=%d wall_us=%d\n", workload, xfer, ops,
+	bytes, stats->totalTicks - startTicks,
+	stats->numDiskReads - startReads, stats->numDiskWrites - startWrites,
+	stats->numDiskSeeks - startSeeks,
+	stats->diskSeekDistance - startSeekDist,
+	(int) (WallClock() - startWall));
+}
+
+//----------------------------------------------------------------------
+// BenchSequential
+// 	Write BenchFileSize bytes into a new, empty file, "xfer" bytes at
+//	a time, so that the file grows on every request; then read it back
+//	with the same request size, checking the contents.
+//----------------------------------------------------------------------
+
+static bool
+BenchSequential(int xfer, char *data)
+{
+    OpenFile *openFile;
+    char *buffer = new char[xfer];
+    int done, ops, n;
+
+    if (!fileSystem->Create(BenchFileName, 0)) {
+	printf("Bench: can't create %s\n", BenchFileName);
+	delete [] buffer;
+	return FALSE;
+    }
+
+    BenchStart();
+    openFile = fileSystem->Open(BenchFileName);
+    for (done = ops = 0; done < BenchFileSize; done += n, ops++) {
+	n = min(xfer, BenchFileSize - done);
+	if (openFile->Write(data + done, n) != n) {
+	    printf("Bench: write of %s failed at %d\n", BenchFileName, done);
+	    delete openFile;
+	    delete [] buffer;
+	    return FALSE;
+	}
+    }
+    openFile->WriteBack();
+    delete openFile;
+    BenchReport("seqwrite", xfer, ops, done);
+
+    BenchStart();
+    openFile = fileSystem->Open(BenchFileName);
+    for (done = ops = 0; (n = openFile->Read(buffer, xfer)) > 0; ops++) {
+	if (strncmp(buffer, data + done, n)) {
+	    printf("Bench: %s has bad data at %d\n", BenchFileName, done);
+	    break;
+	}
+	done += n;
+    }
+    delete openFile;
+    BenchReport("seqread", xfer, ops, done);
+
+    delete [] buffer;
+    return (bool) (done == BenchFileSize);
+}
+
+//----------------------------------------------------------------------
+// BenchRandom
+// 	Rewrite, then read, BenchRandomOps pieces of "xfer" bytes at
+//	random offsets of the file left behind by BenchSequential.
+//----------------------------------------------------------------------
+
+static void
+BenchRandom(int xfer, char *data)
+{
+    OpenFile *openFile = fileSystem->Open(BenchFileName);
+    char *buffer = new char[xfer];
+    int i, offset;
+
+    ASSERT(openFile != NULL);
+    BenchStart();
+    for (i = 0; i < BenchRandomOps; i++) {
+	offset = Random() % (BenchFileSize - xfer + 1);
+	openFile->WriteAt(data + offset, xfer, offset);
+    }
+    BenchReport("randwrite", xfer, BenchRandomOps, BenchRandomOps * xfer);
+
+    BenchStart();
+    for (i = 0; i < BenchRandomOps; i++) {
+	offset = Random() % (BenchFileSize - xfer + 1);
+	openFile->ReadAt(buffer, xfer, offset);
+    }
+    BenchReport("randread", xfer, BenchRandomOps, BenchRandomOps * xfer);
+
+    delete openFile;
+    delete [] buffer;
+}
+
+//----------------------------------------------------------------------
+// BenchStorm
+// 	Create and delete StormFiles files in the root directory,
+//	StormRounds times.  Mostly exercises the directory and the
+//	free sector map.
+//----------------------------------------------------------------------
+
+static void
+BenchStorm()
+{
+    char name[FileNameMaxLen + 1];
+    int round, i, ops = 0;
+
+    BenchStart();
+    for (round = 0; round < StormRounds; round++) {
+	for (i = 0; i < StormFiles; i++, ops++) {
+	    sprintf(name, "s%d", i);
+	    if (!fileSystem->Create(name, StormFileSize))
+		printf("Bench: can't create %s\n", name);
+	}
+	for (i = 0; i < StormFiles; i++, ops++) {
+	    sprintf(name, "s%d", i);
+	    fileSystem->Remove(name);
+	}
+    }
+    BenchReport("storm", StormFileSize, ops, 0);
+}
+
+//----------------------------------------------------------------------
+// BenchDeepDir
+// 	Build a chain of nested directories with a file at the bottom,
+//	open that file DeepDirOpens times (each open walks the whole path),
+//	then remove the tree.
+//----------------------------------------------------------------------
+
+static void
+BenchDeepDir(char *data)
+{
+    OpenFile *openFile;
+    char **dirs;
+    int i, ops = 0;
+
+    if (!ParseFileName(DeepDirPath, dirs))
+	return;
+    BenchStart();
+    if (!fileSystem->CreateDir(dirs, SmallFileSize)) {
+	printf("Bench: can't create %s\n", DeepDirPath);
+	return;
+    }
+    ops++;
+    for (i = 0; i < DeepDirOpens; i++, ops++) {
+	if ((openFile = fileSystem->Open(dirs)) == NULL) {
+	    printf("Bench: can't open %s\n", DeepDirPath);
+	    break;
+	}
+	if (i == 0)
+	    openFile->WriteAt(data, SmallFileSize, 0);
+	delete openFile;
+    }
+    fileSystem->RemoveDir(DeepDirRoot);
+    ops++;
+    BenchReport("deepdir", SmallFileSize, ops, SmallFileSize);
+}
+
+//----------------------------------------------------------------------
+// BenchSmallFiles
+// 	Create SmallFiles files of SmallFileSize bytes each, by appending
+//	to empty files; read them all back; then delete them.
+//----------------------------------------------------------------------
+
+static void
+BenchSmallFiles(char *data)
+{
+    OpenFile *openFile;
+    char name[FileNameMaxLen + 1];
+    char *buffer = new char[SmallFileSize];
+    int i;
+
+    BenchStart();
+    for (i = 0; i < SmallFiles; i++) {
+	sprintf(name, "m%d", i);
+	if (!fileSystem->Create(name, 0)) {
+	    printf("Bench: can't create %s\n", name);
+	    continue;
+	}
+	openFile = fileSystem->Open(name);
+	openFile->Write(data + i, SmallFileSize);
+	openFile->WriteBack();
+	delete openFile;
+    }
+    for (i = 0; i < SmallFiles; i++) {
+	sprintf(name, "m%d", i);
+	if ((openFile = fileSystem->Open(name)) == NULL)
+	    continue;
+	if (openFile->Read(buffer, SmallFileSize) != SmallFileSize
+		|| strncmp(buffer, data + i, SmallFileSize))
+	    printf("Bench: %s has bad data\n", name);
+	delete openFile;
+    }
+    for (i = 0; i < SmallFiles; i++) {
+	sprintf(name, "m%d", i);
+	fileSystem->Remove(name);
+    }
+    BenchReport("smallfiles", SmallFileSize, 3 * SmallFiles,
+	SmallFiles * SmallFileSize);
+    delete [] buffer;
+}
+
+//----------------------------------------------------------------------
+// BenchParallelRead
+// 	Fork ParallelReaders threads, each of which opens the benchmark
+//	file and reads all of it; wait for all of them to finish.  Since
+//	reads only share the file's lock, one reader's disk I/O overlaps
+//	with the others.
+//----------------------------------------------------------------------
+
+static Semaphore *readersDone;
+
+static void
+ParallelReader(_int which)
+{
+    OpenFile *openFile = fileSystem->Open(BenchFileName);
+    char buffer[SectorSize];
+
+    ASSERT(openFile != NULL);
+    while (openFile->Read(buffer, SectorSize) > 0)
+	currentThread->Yield();		// let the other readers in
+    delete openFile;
+    readersDone->V();
+}
+
+static void
+BenchParallelRead(char *data)
+{
+    OpenFile *openFile;
+    Thread *t;
+    int i;
+
+    if (!fileSystem->Create(BenchFileName, 0)) {
+	printf("Bench: can't create %s\n", BenchFileName);
+	return;
+    }
+    openFile = fileSystem->Open(BenchFileName);
+    openFile->Write(data, BenchFileSize);
+    openFile->WriteBack();
+    delete openFile;
+
+    readersDone = new Semaphore("bench readers", 0);
+    BenchStart();
+    for (i = 0; i < ParallelReaders; i++) {
+	t = new Thread("bench reader");
+	t->Fork(ParallelReader, i);
+    }
+    for (i = 0; i < ParallelReaders; i++)
+	readersDone->P();
+    BenchReport("parread", SectorSize, ParallelReaders * BenchFileSize
+	/ SectorSize, ParallelReaders * BenchFileSize);
+    delete readersDone;
+
+    fileSystem->Remove(BenchFileName);
+}
+
+//----------------------------------------------------------------------
+// FileSystemBenchmark
+// 	Run every workload, printing one "BENCH" line for each.
+//----------------------------------------------------------------------
+
+void
+FileSystemBenchmark()
+{
+    char *data = new char[BenchFileSize];
+    int i;
+
+    for (i = 0; i < BenchFileSize; i++)
+	data[i] = 'a' + (i % 26);
+
+    printf("Starting file system benchmark:\n");
+    for (i = 0; i < NumXferSizes; i++) {
+	if (BenchSequential(xferSizes[i], data))
+	    BenchRandom(xferSizes[i], data);
+	fileSystem->Remove(BenchFileName);
+    }
+    BenchStorm();
+    BenchDeepDir(data);
+    BenchSmallFiles(data);
+    BenchParallelRead(data);
+    stats->Print();
+
+    delete [] data;
+}
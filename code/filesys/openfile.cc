@@ -5,7 +5,15 @@
 //	the OpenFile data structure).
 //
 //	Also as in UNIX, for convenience, we keep the file header in
-//	memory while the file is open.
+//	memory while the file is open.  Opening a file that is already
+//	open shares the in-memory header (the FileInode) instead of
+//	reading another copy, so that all the opens see the same length
+//	and contents, and so that they can be synchronized.
+//
+//	Data written past the end of a file's data sectors is not given
+//	sectors right away: it is kept with the inode, and the sectors
+//	for it are allocated together when the file is flushed -- on
+//	WriteBack, on the last close, or when too much data is waiting.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -15,19 +23,223 @@
 #include "filehdr.h"
 #include "openfile.h"
 #include "system.h"
+#include "synch.h"
+
+// The table of inodes of open files, hashed on header sector.
+#define InodeHashSize 	31
+
+static FileInode *inodeTable[InodeHashSize];
+static RWLock *inodeTableLock = NULL;	// protects inodeTable and refCounts
+
+// Appended data waiting for disk sectors, summed over all open files.
+// Once there is more than MaxPendingBytes, the file being written to
+// is flushed right away rather than at close.
+#define MaxPendingBytes 	(8 * SectorSize)
+
+static int totalPendingBytes = 0;
+
+//----------------------------------------------------------------------
+// FindInode
+// 	Look "sector" up in the inode table; NULL if it isn't there.
+//	The caller holds the table lock, for reading or writing.
+//----------------------------------------------------------------------
+
+static FileInode *
+FindInode(int sector)
+{
+    FileInode *inode;
+
+    for (inode = inodeTable[sector % InodeHashSize]; inode != NULL;
+	 				inode = inode->next)
+	if (inode->sector == sector)
+	    break;
+    return inode;
+}
+
+//----------------------------------------------------------------------
+// GetInode
+// 	Return the in-memory inode for the file whose header is at
+//	"sector", reading the header in from disk if no one else has the
+//	file open.
+//
+//	Most opens find the file already open (the root directory, for
+//	one, is open all the time), so lookups only take the table lock
+//	for reading, and just bump the reference count.  On a miss we
+//	upgrade to the write lock, and hold it while the header is read,
+//	so that two threads opening the same file end up with one inode.
+//----------------------------------------------------------------------
+
+static FileInode *
+GetInode(int sector)
+{
+    FileInode *inode;
+    IntStatus oldLevel;
+
+    if (inodeTableLock == NULL)
+	inodeTableLock = new RWLock("inode table");
+    inodeTableLock->ReadAcquire();
+    if ((inode = FindInode(sector)) != NULL) {
+	oldLevel = interrupt->SetLevel(IntOff);	// other readers are
+	inode->refCount++;			// counting too
+	(void) interrupt->SetLevel(oldLevel);
+	inodeTableLock->ReadRelease();
+	return inode;
+    }
+
+    if (!inodeTableLock->Upgrade()) {	// someone else is upgrading
+	inodeTableLock->ReadRelease();
+	inodeTableLock->WriteAcquire();
+    }
+    if ((inode = FindInode(sector)) == NULL) {	// still not there
+	inode = new FileInode;
+	inode->sector = sector;
+	inode->refCount = 0;
+	inode->hdr = new FileHeader;
+	inode->hdr->FetchFrom(sector);
+	inode->lock = new RWLock("inode lock");
+	inode->dirLock = new Lock("directory lock");
+	inode->pending = NULL;
+	inode->pendingBytes = 0;
+	inode->inlineBytes = 0;
+	inode->dirty = FALSE;
+	inode->removed = FALSE;
+	inode->closing = FALSE;
+	inode->next = inodeTable[sector % InodeHashSize];
+	inodeTable[sector % InodeHashSize] = inode;
+    }
+    inode->refCount++;
+    inodeTableLock->WriteRelease();
+    return inode;
+}
+
+//----------------------------------------------------------------------
+// UnlinkInode
+// 	Take "inode" out of the inode table.  The caller holds the table
+//	lock for writing.
+//----------------------------------------------------------------------
+
+static void
+UnlinkInode(FileInode *inode)
+{
+    FileInode **ptr;
+
+    for (ptr = &inodeTable[inode->sector % InodeHashSize]; *ptr != inode;
+						ptr = &(*ptr)->next)
+	;
+    *ptr = inode->next;
+}
+
+//----------------------------------------------------------------------
+// PutInode
+// 	Drop a reference to an in-memory inode.  Return TRUE if it was the
+//	last one: the caller is then closing the file, and must flush it
+//	and call FreeInode.
+//
+//	The inode stays in the table while it is being flushed, so that a
+//	thread opening the file meanwhile shares it rather than reading
+//	the old header from disk.  "closing" keeps a close by that thread
+//	from starting a second flush (and a second free) of its own.
+//----------------------------------------------------------------------
+
+static bool
+PutInode(FileInode *inode)
+{
+    bool last;
+
+    inodeTableLock->WriteAcquire();
+    last = (bool) ((--inode->refCount == 0) && !inode->closing);
+    if (last)
+	inode->closing = TRUE;
+    inodeTableLock->WriteRelease();
+    return last;
+}
+
+//----------------------------------------------------------------------
+// FreeInode
+// 	Finish closing a file, once the last OpenFile on it has flushed
+//	it.  Return FALSE if the file was opened, written and closed again
+//	during the flush, so that it has to be flushed again.
+//
+//	If it was opened and is still open, leave the inode alone: the
+//	last of those opens will flush it.  If the file has been removed,
+//	whatever was appended to it and never flushed is thrown away.
+//----------------------------------------------------------------------
+
+static bool
+FreeInode(FileInode *inode)
+{
+    inodeTableLock->WriteAcquire();
+    if (inode->refCount > 0) {			// opened again
+	inode->closing = FALSE;
+	inodeTableLock->WriteRelease();
+	return TRUE;
+    }
+    if (!inode->removed) {
+	if ((inode->pendingBytes > 0) || inode->dirty) {
+	    inodeTableLock->WriteRelease();
+	    return FALSE;			// written to again
+	}
+	UnlinkInode(inode);
+    }
+    inodeTableLock->WriteRelease();
+
+    // No one can find the inode now.  Give back the sectors reserved
+    // for a removed file's appended data, outside the table lock, since
+    // Remove takes the free map lock before the table lock.
+    if (inode->pendingBytes > 0) {
+	fileSystem->LockFreeMap();
+	fileSystem->UnreserveSectors(divRoundUp(inode->pendingBytes, SectorSize));
+	fileSystem->UnlockFreeMap();
+	totalPendingBytes -= inode->pendingBytes;
+    }
+    delete [] inode->pending;
+    delete inode->hdr;
+    delete inode->lock;
+    delete inode->dirLock;
+    delete inode;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// ForgetInode
+// 	The file whose header is at "sector" has been removed.  If it is
+//	still open, mark its inode removed and take it out of the table
+//	(cf. openfile.h); it goes away, along with any data appended to
+//	the file and not yet flushed, when the last OpenFile on it is
+//	closed.
+//
+//	Called with the free map locked, before the sector can be handed
+//	out again.
+//----------------------------------------------------------------------
+
+void
+ForgetInode(int sector)
+{
+    FileInode *inode;
+
+    if (inodeTableLock == NULL)
+	return;				// nothing has been opened yet
+    inodeTableLock->WriteAcquire();
+    if ((inode = FindInode(sector)) != NULL) {
+	UnlinkInode(inode);
+	inode->removed = TRUE;
+    }
+    inodeTableLock->WriteRelease();
+}
 
 //----------------------------------------------------------------------
 // OpenFile::OpenFile
 // 	Open a Nachos file for reading and writing.  Bring the file header
-//	into memory while the file is open.
+//	into memory while the file is open, or share it if it's already
+//	there.
 //
 //	"sector" -- the location on disk of the file header for this file
 //----------------------------------------------------------------------
 
 OpenFile::OpenFile(int sector)
 { 
-    hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    inode = GetInode(sector);
+    hdr = inode->hdr;
     seekPosition = 0;
     hdrSector=sector;
 }
@@ -49,11 +261,15 @@ int OpenFile::ReadStdin(char *into, int numBytes)
 //----------------------------------------------------------------------
 // OpenFile::~OpenFile
 // 	Close a Nachos file, de-allocating any in-memory data structures.
+//	The last close of a file flushes it (cf. PutInode, FreeInode).
 //----------------------------------------------------------------------
 
 OpenFile::~OpenFile()
 {
-    delete hdr;
+    if ((inode != NULL) && PutInode(inode))
+	do
+	    WriteBack();
+	while (!FreeInode(inode));
 }
 
 //----------------------------------------------------------------------
@@ -87,8 +303,7 @@ OpenFile::Seek(int position)
 int
 OpenFile::Read(char *into, int numBytes)
 {
-    printf("9999999999999999999999999999   \n");
-   int result = ReadAt(into, numBytes, 0);
+   int result = ReadAt(into, numBytes, seekPosition);
    seekPosition += result;
    return result;
 }
@@ -107,40 +322,159 @@ OpenFile::Write(char *into, int numBytes)
 //	Return the number of bytes actually written or read, but has
 //	no side effects (except that Write modifies the file, of course).
 //
-//	There is no guarantee the request starts or ends on an even disk sector
-//	boundary; however the disk only knows how to read/write a whole disk
-//	sector at a time.  Thus:
-//
-//	For ReadAt:
-//	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
-//	For WriteAt:
-//	   We must first read in any sectors that will be partially written,
-//	   so that we don't overwrite the unmodified portion.  We then copy
-//	   in the data that will be modified, and write back all the full
-//	   or partial sectors that are part of the request.
+//	A small file's data is kept in its header (cf. filehdr.h), and is
+//	read and written there; WriteAt moves it out once it grows past
+//	MaxInlineSize.  Otherwise, the part of the request that falls
+//	within the file's data sectors goes to the disk (cf. ReadSectors/
+//	WriteSectors); the part past them is in the inode's buffer of
+//	appended data.  WriteAt never allocates sectors itself -- it only
+//	reserves them, and the actual allocation is left to Flush.
 //
 //	"into" -- the buffer to contain the data to be read from disk 
 //	"from" -- the buffer containing the data to be written to disk 
 //	"numBytes" -- the number of bytes to transfer
 //	"position" -- the offset within the file of the first byte to be
 //			read/written
+//
+//	Reads hold the inode lock shared, so they can overlap with each
+//	other; writes hold it exclusively.
 //----------------------------------------------------------------------
 
 int
 OpenFile::ReadAt(char *into, int numBytes, int position)
 {
-    int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    char *buf;
-    //printf("Reading %d  %d  %d\n",numBytes,fileLength,position);
-    if ((numBytes <= 0) || (position >= fileLength))
+    int fileLength, onDisk, diskBytes;
+
+    inode->lock->ReadAcquire();
+    fileLength = hdr->FileLength();
+    if ((numBytes <= 0) || (position >= fileLength)) {
+	inode->lock->ReadRelease();
     	return 0; 				// check request
+    }
     if ((position + numBytes) > fileLength)		
 	numBytes = fileLength - position;
     DEBUG('f', "Reading %d bytes at %d, from file of length %d.\n", 	
 			numBytes, position, fileLength);
-    //printf("Reading %d\n",numBytes);
+
+    if (hdr->IsInline()) {		// the data is right in the header
+	bcopy(hdr->InlineData() + position, into, numBytes);
+	inode->lock->ReadRelease();
+	return numBytes;
+    }
+
+    // anything past the file's data sectors is still in memory
+    onDisk = hdr->AllocatedLength();
+    diskBytes = max(0, min(numBytes, onDisk - position));
+    if (diskBytes > 0)
+	ReadSectors(into, diskBytes, position);
+    if (diskBytes < numBytes)
+	bcopy(&inode->pending[position + diskBytes - onDisk], 
+				into + diskBytes, numBytes - diskBytes);
+
+    inode->lock->ReadRelease();
+    return numBytes;
+}
+
+int
+OpenFile::WriteAt(char *from, int numBytes, int position)
+{
+    int fileLength, onDisk, diskBytes, newLength, moreSectors;
+    bool inlined;
+
+#ifdef USER_PROGRAM
+    textCache->Invalidate(hdrSector);	// in case it's an executable
+    imageCache->Invalidate(hdrSector);
+#endif
+    inode->lock->WriteAcquire();
+    fileLength = hdr->FileLength();
+    if ((numBytes <= 0) || (position > fileLength)
+		|| (position + numBytes > (int) MaxFileSize)) {
+	inode->lock->WriteRelease();
+	return -1;				// check request
+    }
+    DEBUG('f', "Writing %d bytes at %d, from file of length %d.\n", 	
+			numBytes, position, fileLength);
+
+    onDisk = hdr->AllocatedLength();
+    newLength = max(fileLength, position + numBytes);
+    inlined = hdr->IsInline();
+    if (inlined && newLength <= MaxInlineSize) {
+	// still small enough to live in the header
+	bcopy(from, hdr->InlineData() + position, numBytes);
+	hdr->SetLength(newLength);
+	inode->dirty = TRUE;
+	inode->lock->WriteRelease();
+	return numBytes;
+    }
+
+    // Whatever doesn't fit in the data sectors the file already has is
+    // buffered, to be given sectors all at once when the file is flushed.
+    // Reserve the room for it now, so that the flush can't fail.
+    if (newLength > onDisk) {
+	moreSectors = divRoundUp(newLength - onDisk, SectorSize)
+			- divRoundUp(inode->pendingBytes, SectorSize);
+	if ((moreSectors > 0) && !fileSystem->ReserveSectors(moreSectors)) {
+	    inode->lock->WriteRelease();
+	    return -1;				// disk is full
+	}
+	if (inode->pending == NULL) {
+	    inode->pending = new char[MaxFileSize];
+	    bzero(inode->pending, MaxFileSize);
+	}
+	if (inlined) {
+	    // The file has outgrown its header: what was stored inline
+	    // becomes the start of the buffered data, and gets sectors
+	    // along with the rest of it.
+	    bcopy(hdr->InlineData(), inode->pending, fileLength);
+	    hdr->ClearInline();
+	    inode->inlineBytes = fileLength;
+	}
+	totalPendingBytes += (newLength - onDisk) - inode->pendingBytes;
+	inode->pendingBytes = newLength - onDisk;
+    }
+
+    diskBytes = max(0, min(numBytes, onDisk - position));
+    if (diskBytes > 0)
+	WriteSectors(from, diskBytes, position);
+    if (diskBytes < numBytes)
+	bcopy(from + diskBytes, 
+		&inode->pending[position + diskBytes - onDisk], 
+					numBytes - diskBytes);
+
+    if (newLength != fileLength) {
+	hdr->SetLength(newLength);
+	inode->dirty = TRUE;
+    }
+    if (totalPendingBytes > MaxPendingBytes)	// too much buffered overall
+	Flush();
+
+    inode->lock->WriteRelease();
+    return numBytes;
+}
+
+//----------------------------------------------------------------------
+// OpenFile::ReadSectors/WriteSectors
+// 	Transfer part of the file that lies entirely within its data
+//	sectors, to or from the disk.
+//
+//	For ReadSectors:
+//	   We read in all of the full or partial sectors that are part of the
+//	   request, but we only copy the part we are interested in.
+//	For WriteSectors:
+//	   We must first read in any sectors that will be partially written,
+//	   so that we don't overwrite the unmodified portion.  We then copy
+//	   in the data that will be modified, and write back all the full
+//	   or partial sectors that are part of the request.
+//
+//	The caller holds the inode lock.
+//----------------------------------------------------------------------
+
+void
+OpenFile::ReadSectors(char *into, int numBytes, int position)
+{
+    int i, firstSector, lastSector, numSectors;
+    char *buf;
+
     firstSector = divRoundDown(position, SectorSize);
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
     numSectors = 1 + lastSector - firstSector;
@@ -154,33 +488,15 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
     // copy the part we want
     bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
     delete [] buf;
-    return numBytes;
 }
 
-int
-OpenFile::WriteAt(char *from, int numBytes, int position)
+void
+OpenFile::WriteSectors(char *from, int numBytes, int position)
 {
-    int fileLength = hdr->FileLength();
     int i, firstSector, lastSector, numSectors;
     bool firstAligned, lastAligned;
     char *buf;
 
-    if ((numBytes <= 0) || (position > fileLength))
-	return -1;				// check request
-    /*if ((position + numBytes) > fileLength)
-	numBytes = fileLength - position;*/
-    if ((position + numBytes) > fileLength) { 
-        int incrementBytes = (position + numBytes) - fileLength;
-         BitMap *freeBitMap = fileSystem-> getBitMap(); 
-         bool hdrRet;
-        hdrRet = hdr->Allocate(freeBitMap, fileLength, incrementBytes); //实现
-         if ( !hdrRet ) // Insuficient Disk Space, or File is Too Big
-         return -1; 
-         fileSystem-> setBitMap(freeBitMap); 
-    }
-    DEBUG('f', "Writing %d bytes at %d, from file of length %d.\n", 	
-			numBytes, position, fileLength);
-
     firstSector = divRoundDown(position, SectorSize);
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
     numSectors = 1 + lastSector - firstSector;
@@ -192,10 +508,11 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
 
 // read in first and last sector, if they are to be partially modified
     if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);	
+        synchDisk->ReadSector(hdr->ByteToSector(firstSector * SectorSize), 
+					buf);
     if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize], 
-				SectorSize, lastSector * SectorSize);	
+        synchDisk->ReadSector(hdr->ByteToSector(lastSector * SectorSize), 
+				&buf[(lastSector - firstSector) * SectorSize]);
 
 // copy in the bytes we want to change 
     bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
@@ -205,7 +522,73 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
         synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize), 
 					&buf[(i - firstSector) * SectorSize]);
     delete [] buf;
-    return numBytes;
+}
+
+//----------------------------------------------------------------------
+// OpenFile::Flush
+// 	Give disk sectors to any data appended to the file since the last
+//	flush, and write it out; then write the header, if it has changed.
+//	The new sectors are allocated in one batch, right after the file's
+//	last one where possible, so the bitmap and header are each written
+//	once per flush rather than once per append.
+//
+//	The free map lock is held throughout, so that the file can't be
+//	removed, and its sectors handed out again, while they are being
+//	written.  Once the file has been removed there is nothing left on
+//	disk to update, and its appended data stays in memory until the
+//	last close throws it away (cf. FreeInode).
+//
+//	The caller holds the inode lock for writing.
+//----------------------------------------------------------------------
+
+void
+OpenFile::Flush()
+{
+    int onDisk = hdr->AllocatedLength();
+    int i, numSectors;
+    BitMap *freeMap;
+    bool success;
+
+    if ((inode->pendingBytes == 0) && !inode->dirty)
+	return;
+    fileSystem->LockFreeMap();
+    if (inode->removed) {
+	fileSystem->UnlockFreeMap();
+	return;
+    }
+    if (inode->pendingBytes > 0) {
+	numSectors = divRoundUp(inode->pendingBytes, SectorSize);
+	freeMap = fileSystem->getBitMap();
+	fileSystem->UnreserveSectors(numSectors);
+	success = hdr->Extend(freeMap, numSectors, inode->sector);
+	if (success)
+	    fileSystem->setBitMap(freeMap);
+	delete freeMap;
+
+	if (success) {
+	    for (i = 0; i < numSectors; i++)
+		synchDisk->WriteSector(hdr->ByteToSector(onDisk + i * SectorSize),
+					&inode->pending[i * SectorSize]);
+	} else {			// can't happen, we reserved the room
+	    printf("Flush: lost %d bytes appended to file at sector %d\n",
+				inode->pendingBytes, inode->sector);
+	    if (onDisk == 0) {		// it was inline: keep what it held
+		bcopy(inode->pending, hdr->InlineData(), inode->inlineBytes);
+		hdr->SetLength(inode->inlineBytes);
+	    } else
+		hdr->SetLength(onDisk);
+	}
+	totalPendingBytes -= inode->pendingBytes;
+	inode->pendingBytes = 0;
+	delete [] inode->pending;
+	inode->pending = NULL;
+	inode->dirty = TRUE;
+    }
+    if (inode->dirty) {
+	hdr->WriteBack(inode->sector);
+	inode->dirty = FALSE;
+    }
+    fileSystem->UnlockFreeMap();
 }
 
 //----------------------------------------------------------------------
@@ -220,7 +603,37 @@ OpenFile::Length()
 }
 
 
+//----------------------------------------------------------------------
+// OpenFile::WriteBack
+// 	Make the file's contents and header safe on disk (cf. Flush).
+//	Also done automatically when the last OpenFile on the file is
+//	closed.
+//----------------------------------------------------------------------
+
 void 
 OpenFile::WriteBack() {
-    hdr-> WriteBack(hdrSector);
+    inode->lock->WriteAcquire();
+    Flush();
+    inode->lock->WriteRelease();
+}
+
+//----------------------------------------------------------------------
+// OpenFile::LockDirectory/UnlockDirectory
+// 	Serialize changes to the entries of a directory file.  Anyone
+//	who fetches a directory, modifies it and writes it back must hold
+//	this across all three steps; a thread that only looks names up
+//	doesn't need it, since a directory is read and written whole, under
+//	the inode lock.
+//----------------------------------------------------------------------
+
+void
+OpenFile::LockDirectory()
+{
+    inode->dirLock->Acquire();
+}
+
+void
+OpenFile::UnlockDirectory()
+{
+    inode->dirLock->Release();
 }
\ No newline at end of file
@@ -9,9 +9,9 @@
 //
 //	The other is the "real" implementation, that turns these
 //	operations into read and write disk sector requests. 
-//	In this baseline implementation of the file system, we don't 
-//	worry about concurrent accesses to the file system
-//	by different threads -- this is part of the assignment.
+//	All the OpenFiles on the same file share one in-memory copy of
+//	its header (a FileInode), which also carries the locks that let
+//	several threads use the file at once.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -60,10 +60,52 @@ class OpenFile {
 
 #else // FILESYS
 class FileHeader;
+class RWLock;
+class Lock;
+
+// The in-memory copy of a file header (in UNIX terms, the "in-core
+// inode").  There is at most one per file; every OpenFile on that file
+// points to it, so that a write through one is seen through the others.
+//
+// "lock" is held for reading by ReadAt and for writing by WriteAt, so
+// readers of a file run concurrently, and a writer (which may grow the
+// file) has it to itself.  "dirLock" is only used when the file is a
+// directory: it is held across the fetch-modify-writeback of the
+// directory's entries by Create, Remove and friends.
+//
+// Locks are always taken in the order: directory, inode, free map,
+// inode table.
+
+class FileInode {
+  public:
+    int sector;				// where the header lives on disk
+    int refCount;			// # of OpenFiles sharing this inode
+    FileHeader *hdr;			// the header itself
+    RWLock *lock;			// protects the file's contents
+    Lock *dirLock;			// protects a directory's entries
+    char *pending;			// appended data that has no disk
+					// sectors yet, starting right after
+					// the last data sector
+    int pendingBytes;			// how much of it there is
+    int inlineBytes;			// how much of the file was kept in
+					// the header before it outgrew it
+    bool dirty;				// hdr has changed since it was read
+    bool removed;			// the file has been deleted, and its
+					// header sector may be in use again
+    bool closing;			// the last OpenFile on it is being
+					// closed, and is flushing it
+    FileInode *next;			// next inode in the same hash bucket
+};
+
+// Called when the file whose header is at "sector" is deleted, and the
+// sector freed.  Whoever still has the file open keeps the old inode,
+// but it is taken out of the inode table, so that a new file given the
+// same header sector gets an inode of its own.
+extern void ForgetInode(int sector);
 
 class OpenFile {
   public:
-  OpenFile(char*types){};
+  OpenFile(char*types){ inode = NULL; hdr = NULL; };
     OpenFile(int sector);		// Open a file whose header is located
 					// at "sector" on the disk
 	
@@ -88,11 +130,24 @@ class OpenFile {
 					// than the UNIX idiom -- lseek to 
 					// end of file, tell, lseek back 
     int hdrSector;
-	void WriteBack() ;
+	void WriteBack() ;		// Flush the file's data and header
 	int WriteStdout(char *from, int numBytes);
 	int ReadStdin(char *into, int numBytes);
+
+    void LockDirectory();		// Serialize changes to the entries
+    void UnlockDirectory();		// of a directory file
+
   private:
-    FileHeader *hdr;			// Header for this file 
+    void ReadSectors(char *into, int numBytes, int position);
+    void WriteSectors(char *from, int numBytes, int position);
+					// ReadAt/WriteAt, for the part of
+					// the file that has data sectors
+    void Flush();			// Allocate sectors for appended
+					// data, write it and the header
+
+    FileInode *inode;			// In-memory inode, shared with 
+					// other opens of the same file
+    FileHeader *hdr;			// Header for this file (inode->hdr)
     int seekPosition;			// Current position within the file
 };
 
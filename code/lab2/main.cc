@@ -8,7 +8,7 @@
 //
 // 	Most of this file is not needed until later assignments.
 //
-// Usage: nachos -d <debugflags> -rs <random seed #>
+// Usage: nachos -d <debugflags> -rs <random seed #> -trace <trace file>
 //		-s -x <nachos file> -c <consoleIn> <consoleOut>
 //		-f -cp <unix file> <nachos file>
 //		-p <nachos file> 
@@ -23,6 +23,8 @@
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -trace records context switches, and writes them to <trace file>
+//	as Chrome trace-event JSON when Nachos stops (cf. trace.h)
 //    -z prints the copyright message
 //
 //  USER_PROGRAM
@@ -56,6 +56,8 @@ Scheduler::ReadyToRun (Thread *thread)
     DEBUG('t', "Putting thread %s on ready list.\n", thread->getName());
 
     thread->setStatus(READY);
+    if (schedTrace != NULL)
+	schedTrace->Ready(thread);
     readyList->Append((void *)thread);
     //readyList->SortedInsert((void *)thread,thread->get_this_priority());
 }
@@ -108,6 +110,8 @@ Scheduler::Run (Thread *nextThread)
     
     DEBUG('t', "Switching from thread \"%s\" to thread \"%s\"\n",
 	  oldThread->getName(), nextThread->getName());
+    if (schedTrace != NULL)
+	schedTrace->Switch(oldThread, nextThread);
     
     // void SWITCH( thread *t1, thread *t2 )
 	//This is a machine-dependent assembly language routine defined
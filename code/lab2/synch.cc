@@ -37,7 +37,7 @@ Semaphore::Semaphore(char* debugName, int initialValue)
 {
     name = debugName;
     value = initialValue;
-    queue = new List;
+    queue = new Heap;
 }
 
 //----------------------------------------------------------------------
@@ -67,7 +67,7 @@ Semaphore::P()
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	// disable interrupts
     
     while (value == 0) { 			// semaphore not available
-	queue->Append((void *)currentThread);	// so go to sleep
+	queue->Insert((void *)currentThread, 0);	// so go to sleep
 	currentThread->Sleep();
     } 
     value--; 					// semaphore available, 
@@ -90,7 +90,7 @@ Semaphore::V()
     Thread *thread;
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
 
-    thread = (Thread *)queue->Remove();
+    thread = (Thread *)queue->RemoveMin(NULL);
     if (thread != NULL)	   // make thread ready, consuming the V immediately
 	scheduler->ReadyToRun(thread);
     value++;
@@ -110,7 +110,8 @@ Lock::Lock(char* debugName)
 {
     name = debugName;
     owner = NULL;
-    lock = new Semaphore(name,1);
+    waiters = new Heap;
+    nextHeld = NULL;
 }
 
 
@@ -121,37 +122,43 @@ Lock::Lock(char* debugName)
 //----------------------------------------------------------------------
 Lock::~Lock() 
 {
-    delete lock;
+    delete waiters;
 }
 
 //----------------------------------------------------------------------
 // Lock::Acquire
-//      Use a binary semaphore to implement the lock.  Record which 
-//      thread acquired the lock in order to assure that only the
+//      Wait until the lock is free, first come first served.  Record
+//      which thread acquired the lock in order to assure that only the
 //      same thread releases it.
 //----------------------------------------------------------------------
 void Lock::Acquire() 
 {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);  // disable interrupts
 
-    lock->P();                            // procure the semaphore
+    while (owner != NULL) {		  // lock is busy, so go to sleep
+	waiters->Insert((void *)currentThread, 0);
+	currentThread->Sleep();
+    }
     owner = currentThread;                // record the new owner of the lock
     (void) interrupt->SetLevel(oldLevel); // re-enable interrupts
 }
 
 //----------------------------------------------------------------------
 // Lock::Release
-//      Set the lock to be free (i.e. vanquish the semaphore).  Check
+//      Set the lock to be free, waking up the first waiter.  Check
 //      that the currentThread is allowed to release this lock.
 //----------------------------------------------------------------------
 void Lock::Release() 
 {
+    Thread *thread;
     IntStatus oldLevel = interrupt->SetLevel(IntOff);  // disable interrupts
 
     // Ensure: a) lock is BUSY  b) this thread is the same one that acquired it.
     ASSERT(currentThread == owner);        
     owner = NULL;                          // clear the owner
-    lock->V();                             // vanquish the semaphore
+    thread = (Thread *)waiters->RemoveMin(NULL);
+    if (thread != NULL)
+	scheduler->ReadyToRun(thread);
     (void) interrupt->SetLevel(oldLevel);
 }
 
@@ -179,7 +186,7 @@ bool Lock::isHeldByCurrentThread()
 Condition::Condition(char* debugName) 
 { 
     name = debugName;
-    queue = new List;
+    queue = new Heap;
     lock = NULL;
 }
 
@@ -212,7 +219,7 @@ void Condition::Wait(Lock* conditionLock)
 	lock = conditionLock;  // helps to enforce pre-condition
     } 
     ASSERT(lock == conditionLock); // another pre-condition
-    queue->Append(currentThread);  // add this thread to the waiting list
+    queue->Insert(currentThread, 0);  // add this thread to the waiting list
     conditionLock->Release();      // release the lock
     currentThread->Sleep();        // goto sleep
     conditionLock->Acquire();      // awaken: re-acquire the lock
@@ -234,7 +241,7 @@ void Condition::Signal(Lock* conditionLock)
     ASSERT(conditionLock->isHeldByCurrentThread());
     if(!queue->IsEmpty()) {
 	ASSERT(lock == conditionLock);
-	nextThread = (Thread *)queue->Remove();
+	nextThread = (Thread *)queue->RemoveMin(NULL);
 	scheduler->ReadyToRun(nextThread);      // wake up the thread
     } 
     (void) interrupt->SetLevel(oldLevel);
@@ -255,7 +262,7 @@ void Condition::Broadcast(Lock* conditionLock)
     ASSERT(conditionLock->isHeldByCurrentThread());
     if(!queue->IsEmpty()) {
 	ASSERT(lock == conditionLock);
-	while(nextThread = (Thread *)queue->Remove()) {
+	while(nextThread = (Thread *)queue->RemoveMin(NULL)) {
 	    scheduler->ReadyToRun(nextThread);  // wake up the thread
 	}
     } 
@@ -7,6 +7,7 @@
 
 #include "copyright.h"
 #include "system.h"
+#include "config.h"
 
 // This defines *all* of the global data structures used by Nachos.
 // These are all initialized and de-allocated by this file.
@@ -18,6 +19,8 @@ Interrupt *interrupt;			// interrupt status
 Statistics *stats;			// performance metrics
 Timer *timer;				// the hardware timer device,
 					// for invoking context switches
+SchedTrace *schedTrace;			// scheduler trace, NULL unless
+					// asked for with -trace
 
 #ifdef FILESYS_NEEDED
 FileSystem  *fileSystem;
@@ -80,6 +83,7 @@ Initialize(int argc, char **argv)
     int argCount;
     char* debugArgs = "";
     bool randomYield = FALSE;
+    char *traceFile = NULL;
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
@@ -108,6 +112,18 @@ Initialize(int argc, char **argv)
 						// number generator
 	    randomYield = TRUE;
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-trace")) {
+	    ASSERT(argc > 1);
+	    traceFile = *(argv + 1);		// trace the scheduler
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-geom")) {
+	    ASSERT(argc > 1);
+	    ReadMachineConfig(*(argv + 1));	// cf. machine/config.h
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-set")) {
+	    ASSERT(argc > 1);
+	    SetMachineParameter(*(argv + 1));	// "name=value"
+	    argCount = 2;
 	}
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))   //running user program step by step
@@ -134,8 +150,15 @@ Initialize(int argc, char **argv)
 #endif
     }
 
+    if (!CheckMachineConfig()) {		// cf. machine/config.h
+	printf("Bad machine geometry, giving up\n");
+	Exit(1);
+    }
+
     DebugInit(debugArgs);			// initialize DEBUG messages
     stats = new Statistics();			// collect statistics
+    if (traceFile != NULL)
+	schedTrace = new SchedTrace(traceFile);
     interrupt = new Interrupt;			// start up interrupt handling
     scheduler = new Scheduler();		// initialize the ready queue
     if (randomYield)				// start the timer (if needed)
@@ -193,6 +216,7 @@ Cleanup()
     delete synchDisk;
 #endif
     
+    delete schedTrace;				// writes out the trace
     delete timer;
     delete scheduler;
     delete interrupt;
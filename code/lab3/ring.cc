@@ -40,6 +40,10 @@ Ring::Ring(int sz)
 	fprintf(stderr, "Error: Ring: size %d too small\n", sz);
 	exit(1);
     }
+    if (sz > (1 << 28)) {		// positions go up to 3 * size
+	fprintf(stderr, "Error: Ring: size %d too big\n", sz);
+	exit(1);
+    }
 
     // Initialize the data members of the ring object.
     size = sz;
@@ -74,9 +78,9 @@ Ring::~Ring()
 void
 Ring::Put(slot *message)
 {
-    buffer[in].thread_id = message->thread_id;
-    buffer[in].value = message->value;
-    in = (in + 1) % size;
+    buffer[Slot(in)].thread_id = message->thread_id;
+    buffer[Slot(in)].value = message->value;
+    in = Next(in, 1);
 }
 
 //----------------------------------------------------------------------
@@ -90,21 +94,68 @@ Ring::Put(slot *message)
 void
 Ring::Get(slot *message)
 {
-    message->thread_id = buffer[out].thread_id;
-    message->value = buffer[out].value;
-    out = (out + 1) % size;
+    message->thread_id = buffer[Slot(out)].thread_id;
+    message->value = buffer[Slot(out)].value;
+    out = Next(out, 1);
+}
+
+//----------------------------------------------------------------------
+// Ring::PutBatch
+// 	Put as many of "messages" as there are empty slots for, up to
+//	"n" of them, and return how many were put.  The slots are filled
+//	before "in" moves past them, so a consumer running at the same
+//	time never sees a half-written slot.
+//
+//	"messages" -- the messages to be put in the buffer, in order
+//	"n" -- how many there are
+//----------------------------------------------------------------------
+
+int
+Ring::PutBatch(slot *messages, int n)
+{
+    int i, room = size - Count();
+
+    if (n > room)
+	n = room;
+    for (i = 0; i < n; i++)
+	buffer[Slot(Next(in, i))] = messages[i];
+    in = Next(in, n);
+    return n;
+}
+
+//----------------------------------------------------------------------
+// Ring::GetBatch
+// 	Get up to "n" messages from the full slots, oldest first, and
+//	return how many were got.  As in PutBatch, "out" only moves once
+//	the slots have been copied.
+//
+//	"messages" -- where to put the messages from the buffer
+//	"n" -- how many there is room for
+//----------------------------------------------------------------------
+
+int
+Ring::GetBatch(slot *messages, int n)
+{
+    int i, full = Count();
+
+    if (n > full)
+	n = full;
+    for (i = 0; i < n; i++)
+	messages[i] = buffer[Slot(Next(out, i))];
+    out = Next(out, n);
+    return n;
 }
 
 int
 Ring::Empty()
 {
-// to be implemented
+    return in == out;
 }
 
 int
 Ring::Full()
 {
-// to be implemented
+    return Count() == size;
 }
 
 
@@ -12,6 +12,16 @@
 //
 // The constructor (initializer) for the ring burrer is passed with an
 // integer for the size of the buffer (the number of slots). 
+//
+// PutBatch and GetBatch move as many messages as they can (up to "n")
+// in one go, so the caller synchronizes once per batch, not once per
+// message.  They return how many messages they moved.
+//
+// "in" only ever changes in Put/PutBatch and "out" only in Get/GetBatch,
+// and each is changed after the slots it covers.  So with exactly one
+// producer and one consumer, the ring needs no synchronization at all:
+// the two threads can call PutBatch and GetBatch whenever they like,
+// and just try again later if nothing moved.
 
 // class of the slot in the ring-buffer
 class slot {
@@ -33,14 +43,26 @@ class Ring {
     void Put(slot *message); // Put a message the next empty slot.
     
     void Get(slot *message); // Get a message from the next  full slot.
+
+    int PutBatch(slot *messages, int n); // Put up to n messages.
+    int GetBatch(slot *messages, int n); // Get up to n messages.
                                             
     int Full();       // Returns non-0 if the ring is full, 0 otherwise.
     int Empty();      // Returns non-0 if the ring is empty, 0 otherwise.
+    int Count() { return (in - out + 2 * size) % (2 * size); }
+				// # of full slots
     
   private:
     int size;         // The size of the ring buffer.
-    int in, out;      // Index of 
+    int in, out;		// # of messages ever put and got, modulo
+				// 2 * size, so that a full ring (in - out
+				// == size) isn't taken for an empty one
     slot *buffer;       // A pointer to an array for the ring buffer.
+
+    int Slot(int pos) { return (pos < size) ? pos : pos - size; }
+				// the slot for a position
+    int Next(int pos, int n) { return (pos + n) % (2 * size); }
+				// the position "n" past "pos"
 };
 
 
@@ -0,0 +1,243 @@
+// ringbench.cc
+//	Throughput benchmark for the ring buffer: one producer thread
+//	sends RingBenchMsgs messages to one consumer thread, for each of
+//	a few ring sizes, three ways:
+//
+//	"semaphore"  -- one message at a time, with the counting
+//			semaphores of prodcons++.cc around each Put and Get
+//	"batched"    -- up to RingBenchBatch messages at a time, with
+//			PutBatch/GetBatch under a lock and two condition
+//			variables, so the threads synchronize once per batch
+//	"spsc"       -- batches again, but with no synchronization at
+//			all: with one producer and one consumer, the ring
+//			can be used as is (cf. ring.h).  A thread that
+//			can't move anything yields, and tries again.
+//
+//	The consumer checks that the messages arrive in order.  Each run
+//	prints one "BENCH" line, like the other benchmarks.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "synch.h"
+#include "ring.h"
+
+#define RingBenchMsgs	20000	// messages sent in each run
+#define RingBenchBatch	16	// most messages moved at a time
+
+static int ringSizes[] = { 1, 4, 16, 64 };
+#define NumRingSizes	(int) (sizeof(ringSizes) / sizeof(int))
+
+enum RingWorkload { SemaphoreRing, BatchedRing, SpscRing };
+static char *workloadNames[] = { "semaphore", "batched", "spsc" };
+
+static Ring *benchRing;
+static Semaphore *benchDone;		// V'ed by each thread when done
+static int outOfOrder;			// # of messages the consumer
+					// didn't expect
+
+// for the "semaphore" runs
+static Semaphore *nempty, *nfull, *mutex;
+
+// for the "batched" runs
+static Lock *ringLock;
+static Condition *notFull, *notEmpty;
+
+//----------------------------------------------------------------------
+// PutAll, GetAll
+//	Send, or receive, RingBenchMsgs messages through benchRing, in
+//	batches of up to RingBenchBatch.  "put" and "get" move one
+//	batch (or as much of it as they can) and return how many
+//	messages they moved.
+//----------------------------------------------------------------------
+
+static void
+PutAll(int (*put)(slot *messages, int n))
+{
+    slot batch[RingBenchBatch];
+    int sent = 0, n, i;
+
+    while (sent < RingBenchMsgs) {
+	n = RingBenchMsgs - sent;
+	if (n > RingBenchBatch)
+	    n = RingBenchBatch;
+	for (i = 0; i < n; i++) {
+	    batch[i].thread_id = 0;
+	    batch[i].value = sent + i;
+	}
+	sent += (*put)(batch, n);	// whatever didn't fit goes again
+    }
+}
+
+static void
+GetAll(int (*get)(slot *messages, int n))
+{
+    slot batch[RingBenchBatch];
+    int received = 0, n, i;
+
+    while (received < RingBenchMsgs) {
+	n = (*get)(batch, RingBenchBatch);
+	for (i = 0; i < n; i++)
+	    if (batch[i].value != received + i)
+		outOfOrder++;
+	received += n;
+    }
+}
+
+//----------------------------------------------------------------------
+// SemaphorePut, SemaphoreGet
+//	Move one message, the way the producers and consumers of
+//	prodcons++.cc do.
+//----------------------------------------------------------------------
+
+static int
+SemaphorePut(slot *messages, int n)
+{
+    nempty->P();
+    mutex->P();
+    benchRing->Put(messages);
+    mutex->V();
+    nfull->V();
+    return 1;
+}
+
+static int
+SemaphoreGet(slot *messages, int n)
+{
+    nfull->P();
+    mutex->P();
+    benchRing->Get(messages);
+    mutex->V();
+    nempty->V();
+    return 1;
+}
+
+//----------------------------------------------------------------------
+// BatchedPut, BatchedGet
+//	Wait for room (or for messages), then move as many messages as
+//	we can in one go, and wake up the other side.
+//----------------------------------------------------------------------
+
+static int
+BatchedPut(slot *messages, int n)
+{
+    ringLock->Acquire();
+    while (benchRing->Full())
+	notFull->Wait(ringLock);
+    n = benchRing->PutBatch(messages, n);
+    notEmpty->Signal(ringLock);
+    ringLock->Release();
+    return n;
+}
+
+static int
+BatchedGet(slot *messages, int n)
+{
+    ringLock->Acquire();
+    while (benchRing->Empty())
+	notEmpty->Wait(ringLock);
+    n = benchRing->GetBatch(messages, n);
+    notFull->Signal(ringLock);
+    ringLock->Release();
+    return n;
+}
+
+//----------------------------------------------------------------------
+// SpscPut, SpscGet
+//	Move what we can without any synchronization; if that was
+//	nothing, give the other thread a chance to run first.
+//----------------------------------------------------------------------
+
+static int
+SpscPut(slot *messages, int n)
+{
+    n = benchRing->PutBatch(messages, n);
+    if (n == 0)
+	currentThread->Yield();
+    return n;
+}
+
+static int
+SpscGet(slot *messages, int n)
+{
+    n = benchRing->GetBatch(messages, n);
+    if (n == 0)
+	currentThread->Yield();
+    return n;
+}
+
+//----------------------------------------------------------------------
+// BenchProducer, BenchConsumer
+//	The two threads of a run.  "which" is the RingWorkload.
+//----------------------------------------------------------------------
+
+static void
+BenchProducer(_int which)
+{
+    switch (which) {
+      case SemaphoreRing:	PutAll(SemaphorePut); break;
+      case BatchedRing:		PutAll(BatchedPut); break;
+      case SpscRing:		PutAll(SpscPut); break;
+    }
+    benchDone->V();
+}
+
+static void
+BenchConsumer(_int which)
+{
+    switch (which) {
+      case SemaphoreRing:	GetAll(SemaphoreGet); break;
+      case BatchedRing:		GetAll(BatchedGet); break;
+      case SpscRing:		GetAll(SpscGet); break;
+    }
+    benchDone->V();
+}
+
+//----------------------------------------------------------------------
+// RingBenchmark
+//	Time every workload with every ring size.  Invoked by "-rbench".
+//----------------------------------------------------------------------
+
+void
+RingBenchmark()
+{
+    int workload, i, size, startTicks;
+    double startWall;
+
+    benchDone = new Semaphore("ring bench done", 0);
+    for (workload = SemaphoreRing; workload <= SpscRing; workload++)
+	for (i = 0; i < NumRingSizes; i++) {
+	    size = ringSizes[i];
+	    benchRing = new Ring(size);
+	    nempty = new Semaphore("nempty", size);
+	    nfull = new Semaphore("nfull", 0);
+	    mutex = new Semaphore("mutex", 1);
+	    ringLock = new Lock("ring lock");
+	    notFull = new Condition("not full");
+	    notEmpty = new Condition("not empty");
+	    outOfOrder = 0;
+
+	    startTicks = stats->totalTicks;
+	    startWall = WallClock();
+	    (new Thread("ring producer"))->Fork(BenchProducer, workload);
+	    (new Thread("ring consumer"))->Fork(BenchConsumer, workload);
+	    benchDone->P();
+	    benchDone->P();
+	    printf("BENCH workload=ring-%s ringsize=%d msgs=%d errors=%d "
+		"ticks=%d wall_us=%d\n", workloadNames[workload], size,
+		RingBenchMsgs, outOfOrder, stats->totalTicks - startTicks,
+		(int) (WallClock() - startWall));
+
+	    delete benchRing;
+	    delete nempty;
+	    delete nfull;
+	    delete mutex;
+	    delete ringLock;
+	    delete notFull;
+	    delete notEmpty;
+	}
+    delete benchDone;
+}
@@ -11,7 +11,7 @@
 // Usage: nachos -d <debugflags> -rs <random seed #>
 //		-s -x <nachos file> -c <consoleIn> <consoleOut>
 //		-f -cp <unix file> <nachos file>
-//		-p <nachos file> -r <nachos file> -l -D -t
+//		-p <nachos file> -r <nachos file> -l -D -t -bench
 //              -n <network reliability> -m <machine id>
 //              -o <other machine id>
 //              -z
@@ -33,6 +33,7 @@
 //    -l lists the contents of the Nachos directory
 //    -D prints the contents of the entire file system 
 //    -t tests the performance of the Nachos file system
+//    -bench runs the file system benchmark (on a freshly formatted disk)
 //
 //  NETWORK
 //    -n sets the network reliability
@@ -59,6 +60,7 @@ extern void ThreadTest(void), Copy(char *unixFile, char *nachosFile);
 extern void Append(char *unixFile, char *nachosFile, int half);
 extern void NAppend(char *nachosFile, char *nachosFiles);
 extern void Print(char *file), PerformanceTest(void);
+extern void FileSystemBenchmark(void);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
 extern void MailTest(int networkID);
 
@@ -147,6 +149,8 @@ main(int argc, char **argv)
             fileSystem->Print();
 	} else if (!strcmp(*argv, "-t")) {	// performance test
             PerformanceTest();
+	} else if (!strcmp(*argv, "-bench")) {	// file system benchmark
+            FileSystemBenchmark();
 	}
 #endif // FILESYS
 #ifdef NETWORK
@@ -24,6 +24,7 @@
 #include "copyright.h"
 #include "system.h"
 #include "syscall.h"
+#include "filehdr.h"		// for MaxFileSize
 
 //----------------------------------------------------------------------
 // ExceptionHandler
@@ -60,6 +61,168 @@ void StartProcess(int spaceid){
     printf("执行完毕\n");
     ASSERT(FALSE);
 }
+//----------------------------------------------------------------------
+// StartForkedProcess
+// 	The first thing a process made by Fork does: load the registers
+//	the parent set up for it, and start running user code.
+//
+//	"regs" is the register set, allocated by the parent.
+//----------------------------------------------------------------------
+
+void StartForkedProcess(_int regs){
+    int *userRegs = (int *) regs;
+
+    for (int i = 0; i < NumTotalRegs; i++)
+        machine->WriteRegister(i, userRegs[i]);
+    delete [] userRegs;
+    currentThread->space->RestoreState();
+    machine->Run();
+    ASSERT(FALSE);
+}
+
+//----------------------------------------------------------------------
+// CopyInString
+// 	Copy a null-terminated string, such as a file name, from user
+//	memory at "virtAddr" into "into", which has room for "size" bytes.
+//	Returns FALSE if the string runs off the address space, or is too
+//	long.  The string is copied a byte at a time, so that nothing past
+//	its end is touched.
+//----------------------------------------------------------------------
+
+static bool
+CopyInString(int virtAddr, char *into, int size)
+{
+    for (int i = 0; i < size; i++) {
+	if (!currentThread->space->CopyIn(virtAddr + i, &into[i], 1))
+	    return FALSE;
+	if (into[i] == '\0')
+	    return TRUE;
+    }
+    return FALSE;
+}
+
+#ifdef FILESYS
+//----------------------------------------------------------------------
+// RunIoRequest
+// 	Carry out one request taken from an IoRing (cf. syscall.h), the
+//	way the system call of the same name does, and return what the
+//	system call would return, or -1 if the request is bad.  The
+//	console can't be closed this way.
+//----------------------------------------------------------------------
+
+static int
+RunIoRequest(IoRequest *request)
+{
+    AddrSpace *space = currentThread->space;
+    OpenFile *openfile = NULL;
+    char name[128], *buffer;
+    int fd = request->fd, size = request->size, result;
+
+    if (request->op != IoOpen && (fd < 0 || fd >= 10
+		|| (openfile = space->getfileId(fd)) == NULL))
+	return -1;
+    if ((request->op == IoRead || request->op == IoWrite)
+		&& (size < 0 || size > (int) MaxFileSize))
+	return -1;
+    switch (request->op) {
+      case IoOpen:
+	if (!CopyInString(request->buffer, name, 128)
+		|| (openfile = fileSystem->Open(name)) == NULL)
+	    return -1;
+	if ((result = space->getfiledescriptor(openfile)) < 0)
+	    delete openfile;
+	return result;
+
+      case IoClose:
+	if (fd < 3)
+	    return -1;
+	openfile->WriteBack();
+	delete openfile;
+	space->releasefiledescriptor(fd);
+	return 0;
+
+      case IoRead:
+	buffer = new char[size];
+	if (fd == 0)
+	    result = openfile->ReadStdin(buffer, size);
+	else
+	    result = openfile->Read(buffer, size);
+	if (result > 0 && !space->CopyOut(request->buffer, buffer, result))
+	    result = -1;
+	delete [] buffer;
+	return result;
+
+      case IoWrite:
+	buffer = new char[size];
+	if (!space->CopyIn(request->buffer, buffer, size))
+	    result = -1;
+	else if (fd == 1 || fd == 2)
+	    result = openfile->WriteStdout(buffer, size);
+	else {
+	    openfile->Seek(openfile->Length());	// append, like Write
+	    result = openfile->Write(buffer, size);
+	}
+	delete [] buffer;
+	return result;
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// SubmitIoRing
+// 	Carry out the requests queued in the IoRing at "ringAddr", in
+//	order, posting a completion for each, until the submission ring
+//	is empty or the completion ring is full.  Returns the number of
+//	requests carried out, or -1 if the ring isn't readable and
+//	writable, or its counters make no sense.
+//
+//	The whole ring is copied into the kernel, a page at a time,
+//	worked on there, and copied back when we're done, rather than
+//	going through user memory a byte at a time.  The process can't
+//	touch the ring meanwhile, since it is waiting for us.
+//----------------------------------------------------------------------
+
+static int
+SubmitIoRing(int ringAddr)
+{
+    AddrSpace *space = currentThread->space;
+    IoRing ring;
+    int *words = (int *) &ring;
+    int numWords = sizeof(IoRing) / sizeof(int), done = 0, i;
+    IoCompletion *completion;
+    IoRequest *request;
+
+    if (!space->CopyIn(ringAddr, (char *) &ring, sizeof(IoRing)))
+	return -1;
+    for (i = 0; i < numWords; i++)
+	words[i] = WordToHost(words[i]);
+    if (ring.sqHead < 0 || ring.sqTail - ring.sqHead < 0 
+		|| ring.sqTail - ring.sqHead > IoRingSize
+		|| ring.cqTail < 0 || ring.cqTail - ring.cqHead < 0
+		|| ring.cqTail - ring.cqHead > IoRingSize)
+	return -1;
+
+    while (ring.sqHead != ring.sqTail
+		&& ring.cqTail - ring.cqHead < IoRingSize) {
+	request = &ring.sq[ring.sqHead % IoRingSize];
+	completion = &ring.cq[ring.cqTail % IoRingSize];
+	completion->tag = request->tag;
+	completion->result = RunIoRequest(request);
+	DEBUG('f', "Ring request %d (op %d, fd %d): %d\n", request->tag,
+	    request->op, request->fd, completion->result);
+	ring.sqHead++;
+	ring.cqTail++;
+	done++;
+    }
+
+    for (i = 0; i < numWords; i++)
+	words[i] = WordToMachine(words[i]);
+    if (!space->CopyOut(ringAddr, (char *) &ring, sizeof(IoRing)))
+	return -1;
+    return done;
+}
+#endif // FILESYS
+
 void
 ExceptionHandler(ExceptionType which)
 {
@@ -79,21 +242,25 @@ ExceptionHandler(ExceptionType which)
                 printf("Execute system call of Exec()\n");
                 char filename[128]; 
                 int addr=machine->ReadRegister(4); 
-                int i=0;
                 printf("{{{{{{{{{{{}}}}}}}}}}}\n");
-                do{
-                    machine->ReadMem(addr+i,1,(int *)&filename[i]);
-                }while(filename[i++]!='\0');
-                OpenFile *executable = fileSystem->Open(filename); 
-                if (executable == NULL) {
+                // CopyIn 像用户指令访存一样处理缺页（换出、写时复制），见 addrspace.cc
+                if (!CopyInString(addr, filename, 128)) {
+                    printf("Bad file name for Exec\n");
+                    machine->WriteRegister(2,-1);
+                    AdvancePC();
+                    break;
+                }
+                // 最近运行过的程序已在内存中（见 imagecache.h），不必再读磁盘
+                ExecImage *image = imageCache->Load(filename);
+                if (image == NULL) {
                     printf("Unable to open file %s\n", filename);
                     return;
                 }
                 printf("{{{{{{{{{{{}}}}}}}}}}}\n");
                 //new address space
-                AddrSpace *space = new AddrSpace(executable); 
+                AddrSpace *space = new AddrSpace(image); 
+                imageCache->Release(image);     // 装入时可能阻塞，所以用完才归还
                 printf("{{{{{{{{{{{}}}}}}}}}}}\n");
-                delete executable; // close file
                 //new and fork thread
                 char *forkedThreadName=filename;
                 //
@@ -106,11 +273,65 @@ ExceptionHandler(ExceptionType which)
                 AdvancePC(); 
                 break;    
             }
+            case SC_Fork:{
+                // 子进程与父进程共享物理页（只读），写时才复制，
+                // 从 func 开始执行，栈指针与父进程相同
+                int func = machine->ReadRegister(4);
+                AddrSpace *space = new AddrSpace(currentThread->space);
+                int *regs = new int[NumTotalRegs];
+                for (int i = 0; i < NumTotalRegs; i++)
+                    regs[i] = machine->ReadRegister(i);
+                regs[PCReg] = func;
+                regs[NextPCReg] = func + 4;
+                regs[PrevPCReg] = func - 4;
+                currentThread->setWaitSpaceId(space->getSpaceID());
+                Thread *thread = new Thread("forked process");
+                thread->space = space;
+                thread->Fork(StartForkedProcess, (_int) regs);
+                machine->WriteRegister(2, space->getSpaceID());
+                AdvancePC();
+                break;
+            }
+            case SC_Mmap:{
+                // 把打开的文件映射进地址空间：按需从文件读入页，
+                // 解除映射或换出时写回被修改的页
+                int fileId = machine->ReadRegister(4);
+                int length = machine->ReadRegister(5);
+                OpenFile *openfile = NULL;
+                if (fileId >= 3 && fileId < 10)
+                    openfile = currentThread->space->getfileId(fileId);
+                machine->WriteRegister(2,
+                    currentThread->space->Mmap(openfile, length));
+                AdvancePC();
+                break;
+            }
+            case SC_Munmap:{
+                int addr = machine->ReadRegister(4);
+                if (currentThread->space->Munmap(addr))
+                    machine->WriteRegister(2, 0);
+                else
+                    machine->WriteRegister(2, -1);
+                AdvancePC();
+                break;
+            }
+            case SC_Submit:{
+                // 一次陷入处理提交环中排队的所有文件请求，结果写入完成环
+                #ifdef FILESYS
+                int ringAddr = machine->ReadRegister(4);
+                machine->WriteRegister(2, SubmitIoRing(ringAddr));
+                #else
+                machine->WriteRegister(2, -1);
+                #endif
+                AdvancePC();
+                break;
+            }
             case SC_Exit:{
                 printf("This is SC_Exit, CurrentThreadId: %d\n",(currentThread->space)->getSpaceID());
                 int exitCode = machine->ReadRegister(4);
                 machine->WriteRegister(2,exitCode);
                 currentThread->setExitCode(exitCode);
+                // 先把映射的文件写回，等待本进程的线程才能看到修改
+                currentThread->space->UnmapAll();
                 //delete currentThread->space;
                 currentThread->Finish();
                 AdvancePC();
@@ -131,20 +352,22 @@ ExceptionHandler(ExceptionType which)
                 AdvancePC();
                 break;
             }
+            case SC_Sleep:{
+                // 睡眠 r4 个时钟周期，期间其他线程照常运行
+                int ticks = machine->ReadRegister(4);
+                alarmClock->WaitUntil(ticks);
+                AdvancePC();
+                break;
+            }
             case SC_Create:{
                 #ifdef FILESYS
                     printf("Execute system call of Create()\n");    
                     int base=machine->ReadRegister(4);
-                    int value;
-                    int count=0;
-                    char *FileName= new char[128];
-                    do{
-                        machine->ReadMem(base+count,1,&value);
-                        FileName[count]=*(char*)&value;
-                        count++;
-                    } while(*(char*)&value!='\0'&&count<128);
+                    char FileName[128];
                     //when calling Create(), thread go to sleep, waked up when I/O finish
-                    if(!fileSystem->Create(FileName,0)) //call Create() in FILESYS,see filesys.h
+                    if(!CopyInString(base,FileName,128))
+                        printf("create file failed, bad file name!\n");
+                    else if(!fileSystem->Create(FileName,0)) //call Create() in FILESYS,see filesys.h
                         printf("create file %s failed!\n",FileName);
                     else
                         DEBUG('f',"create file %s succeed!\n",FileName); 
@@ -154,10 +377,8 @@ ExceptionHandler(ExceptionType which)
                     #else
                     int addr = machine->ReadRegister(4);
                     char filename[128];
-                    for(int i = 0; i < 128; i++){
-                        machine->ReadMem(addr+i,1,(int *)&filename[i]);
-                        if(filename[i] == '\0') break;
-                    }
+                    if(!CopyInString(addr,filename,128))
+                        filename[0] = '\0';        // 不是合法的文件名，下面打开失败
                     int fileDescriptor = OpenForWrite(filename);
                     if(fileDescriptor == -1) printf("create file %s failed!\n",filename);
                     else printf("create file %s succeed, the file id is %d\n",filename,fileDescriptor);
@@ -169,17 +390,14 @@ ExceptionHandler(ExceptionType which)
             case SC_Open:{
             #ifdef FILESYS
                 int base=machine->ReadRegister(4);
-                int value;
-                int count=0;
-                char *FileName= new char[128];
-                do{
-                    machine->ReadMem(base+count,1,&value);
-                    FileName[count]=*(char*)&value;
-                    count++;
-                }while(*(char*)&value!='\0'&&count<128);
+                char FileName[128];
                 int fileid;
                //call Open() in FILESYS,see filesys.h,Nachos Open()
-                OpenFile* openfile=fileSystem->Open(FileName); 
+                OpenFile* openfile=NULL;
+                if(CopyInString(base,FileName,128))
+                    openfile=fileSystem->Open(FileName); 
+                else
+                    FileName[0]='\0';
                 if(openfile == NULL ) { //file not existes, not found
                     printf("File \"%s\" not Exists, could not open it.\n",FileName);
                     fileid = -1;
@@ -198,10 +416,8 @@ ExceptionHandler(ExceptionType which)
                #else
                     int addr = machine->ReadRegister(4);
                     char filename[128];
-                    for(int i = 0; i < 128; i++){
-                        machine->ReadMem(addr+i,1,(int *)&filename[i]);
-                        if(filename[i] == '\0') break;
-                    }
+                    if(!CopyInString(addr,filename,128))
+                        filename[0] = '\0';        // 不是合法的文件名，下面打开失败
                     int fileDescriptor = OpenForWrite(filename);
                     if(fileDescriptor == -1) printf("Open file %s failed!\n",filename);
                     else printf("Open file %s succeed, the file id is %d\n",filename,fileDescriptor);                
@@ -216,29 +432,30 @@ ExceptionHandler(ExceptionType which)
                 int base =machine->ReadRegister(4); //buffer
                 int size=machine->ReadRegister(5); //bytes written to file 
                 int fileId=machine->ReadRegister(6); //fd 
-                int value;
-                int count=0;
                 // printf("base=%d, size=%d, fileId=%d \n",base,size,fileId );
-                OpenFile* openfile =new OpenFile (fileId);
-                ASSERT(openfile != NULL);
-                
-                char* buffer= new char[128];
-                do{
-                    machine->ReadMem(base+count,1,&value);
-                    buffer[count] = *(char*)&value; 
-                    count++;
-                } while((*(char*)&value!='\0') && (count<size));
-                buffer[size]='\0';
+                OpenFile* openfile;
                 
-                openfile = currentThread->space->getfileId(fileId); 
-                //printf("$$$$$$$$$$$$$$$$\n");
-                //printf("openfile =%d\n",openfile);
-                if (openfile == NULL)
+                if (size < 0 || size > (int) MaxFileSize) {
+                    printf("Bad size %d for Write.\n",size);
+                    AdvancePC();
+                    break;
+                }
+                if (fileId < 0 || fileId >= 10
+                        || (openfile = currentThread->space->getfileId(fileId)) == NULL)
                 {
                     printf("Failed to Open file \"%d\" .\n",fileId); 
                     AdvancePC();
                     break;
-                } 
+                }
+                char* buffer= new char[size+1];     // 按 size 分配，末尾还要放 '\0'
+                if (!currentThread->space->CopyIn(base,buffer,size)) {
+                    printf("Bad buffer for Write.\n");
+                    delete [] buffer;
+                    AdvancePC();
+                    break;
+                }
+                buffer[size]='\0';
+                
                 //printf("$$$$$$$$$$$$$$$$\n");
                 if (fileId ==1 || fileId ==2)
                 {
@@ -281,17 +498,21 @@ ExceptionHandler(ExceptionType which)
                     int addr = machine->ReadRegister(4);
                     int size = machine->ReadRegister(5);       // 字节数
                     int fileId = machine->ReadRegister(6);      // fd
-                    int value;
-                    int count=0;
                     // 打开文件
                     OpenFile *openfile = new OpenFile(fileId);
                     ASSERT(openfile != NULL);
-                    char* buffer= new char[128];
-                    do{
-                    machine->ReadMem(addr+count,1,&value);
-                    buffer[count] = *(char*)&value; 
-                    count++;
-                    } while((*(char*)&value!='\0') && (count<size));
+                    if (size < 0) {
+                        printf("Bad size %d for Write.\n",size);
+                        AdvancePC();
+                        break;
+                    }
+                    char* buffer= new char[size+1];     // 按 size 分配，末尾还要放 '\0'
+                    if (!currentThread->space->CopyIn(addr,buffer,size)) {
+                        printf("Bad buffer for Write.\n");
+                        delete [] buffer;
+                        AdvancePC();
+                        break;
+                    }
                     buffer[size]='\0';
 
                     // 写入数据
@@ -311,18 +532,27 @@ ExceptionHandler(ExceptionType which)
                 int base =machine->ReadRegister(4);
                 int size = machine->ReadRegister(5);
                 int fileId=machine->ReadRegister(6);
-                OpenFile* openfile = currentThread->space->getfileId(fileId); 
+                OpenFile* openfile = NULL;
+                if (size < 0 || size > (int) MaxFileSize || fileId < 0 || fileId >= 10
+                        || (openfile = currentThread->space->getfileId(fileId)) == NULL)
+                {
+                    printf("\nRead file failed!\n");
+                    machine->WriteRegister(2,-1);
+                    AdvancePC();
+                    break;
+                }
                 //printf("please input the program you want to run:");
-                char buffer[size];
+                char* buffer= new char[size+1];     // 按 size 分配，末尾还要放 '\0'
                 int readnum=0;
                 if (fileId == 0) //stdin
                 readnum = openfile->ReadStdin(buffer,size);
                 else
                 readnum = openfile->Read(buffer,size);
                 
-                for(int i = 0;i < readnum; i++)
-                machine->WriteMem(base,1,buffer[i]);
-                buffer[readnum]='\0';
+                // CopyOut 处理缺页和写时复制，见 addrspace.cc
+                if (readnum > 0 && !currentThread->space->CopyOut(base,buffer,readnum))
+                    readnum = -1;
+                buffer[max(readnum,0)]='\0';
                 
                 for(int i = 0;i < readnum; i++)
                 if (buffer[i] >=0 && buffer[i] <= 9)
@@ -344,6 +574,7 @@ ExceptionHandler(ExceptionType which)
                 else
                 printf("\nRead file failed!\n");
                 
+               delete [] buffer;
                machine->WriteRegister(2,readnum);
                AdvancePC();
                break;
@@ -357,8 +588,8 @@ ExceptionHandler(ExceptionType which)
                 OpenFile *openfile = new OpenFile(fileId);
                 int readnum = openfile->Read(buffer,size);
 
-                for(int i = 0; i < size; i++)
-                    if(!machine->WriteMem(addr,1,buffer[i])) printf("This is something Wrong.\n");
+                if(readnum > 0 && !currentThread->space->CopyOut(addr,buffer,readnum))
+                    printf("This is something Wrong.\n");
                 buffer[size] = '\0';
                 printf("read succeed, the content is \"%s\", the length is %d\n",buffer,size);
                 machine->WriteRegister(2,readnum);
@@ -397,6 +628,25 @@ ExceptionHandler(ExceptionType which)
 	            ASSERT(FALSE);
             }
         }
+    } else if (which == PageFaultException) {
+        // 第一次访问未初始化数据或栈的页：分配一个清零的页框后重新执行
+        int vpn = (unsigned) machine->ReadRegister(BadVAddrReg) / PageSize;
+        if (!currentThread->space->PageFault(vpn)) {
+            printf("Bad address 0x%x in space %d\n",
+                machine->ReadRegister(BadVAddrReg),
+                currentThread->space->getSpaceID());
+            currentThread->setExitCode(-1);
+            currentThread->Finish();
+        }
+    } else if (which == ReadOnlyException) {
+        // 写只读页：若是 Fork 之后共享的页，复制一份后重新执行该指令
+        int vpn = (unsigned) machine->ReadRegister(BadVAddrReg) / PageSize;
+        if (!currentThread->space->CopyOnWrite(vpn)) {
+            printf("Write to read-only page %d in space %d\n", vpn,
+                currentThread->space->getSpaceID());
+            currentThread->setExitCode(-1);
+            currentThread->Finish();
+        }
     } else {
 	printf("Unexpected user mode exception %d %d\n", which, type);
 	ASSERT(FALSE);
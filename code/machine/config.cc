@@ -0,0 +1,215 @@
+// config.cc
+//	The parameters of the simulated machine, and routines to set
+//	them from the command line or from a geometry file.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "config.h"
+#include "machine.h"
+#include "stats.h"
+#ifdef FILESYS
+#include "filehdr.h"
+#endif
+
+// The parameters, with their defaults (cf. machine.h, disk.h, stats.h)
+
+int NumPhysPages = 64;		// frames of physical memory
+int TLBSize = 4;		// if there is a TLB, make it small
+int NumCPUs = 1;		// processors (cf. threads/scheduler.h)
+int CPUQuantum = 100;		// instructions each runs in its turn
+int SectorsPerTrack = 32;	// number of sectors per disk track
+int NumTracks = 32;		// number of tracks per disk
+
+int UserTick = 1;		// advance for each user-level instruction
+int SystemTick = 10;		// advance each time interrupts are enabled
+int RotationTime = 500;		// time disk takes to rotate one sector
+int SeekTime = 500;		// time disk takes to seek past one track
+int ConsoleTime = 100;		// time to read or write one character
+int NetworkTime = 100;		// time to send or receive one packet
+int TimerTicks = 100;		// (average) time between timer interrupts
+
+// The table of parameters that can be set, with the least value
+// each of them makes sense with.  The file system needs at least
+// one cylinder group of tracks (cf. TracksPerGroup in filehdr.h),
+// with room in it for the free map and the root directory.
+
+struct MachineParameter {
+    char *name;
+    int *value;
+    int least;
+};
+
+static MachineParameter parameters[] = {
+    { "NumPhysPages",	 &NumPhysPages,	   1 },
+    { "TLBSize",	 &TLBSize,	   1 },
+    { "NumCPUs",	 &NumCPUs,	   1 },
+    { "CPUQuantum",	 &CPUQuantum,	   1 },
+    { "SectorsPerTrack", &SectorsPerTrack, 8 },
+    { "NumTracks",	 &NumTracks,	   4 },
+    { "UserTick",	 &UserTick,	   1 },
+    { "SystemTick",	 &SystemTick,	   1 },
+    { "RotationTime",	 &RotationTime,	   1 },
+    { "SeekTime",	 &SeekTime,	   0 },
+    { "ConsoleTime",	 &ConsoleTime,	   1 },
+    { "NetworkTime",	 &NetworkTime,	   1 },
+    { "TimerTicks",	 &TimerTicks,	   1 },
+};
+#define NumParameters (int) (sizeof(parameters) / sizeof(MachineParameter))
+
+static bool changed = FALSE;		// has anything been set?
+
+//----------------------------------------------------------------------
+// SetMachineParameter
+// 	Set the parameter called "name" to "value".  Complain, and leave
+//	the parameter as it is, if there's no such parameter or the
+//	value is too small for it.
+//----------------------------------------------------------------------
+
+bool
+SetMachineParameter(char *name, int value)
+{
+    for (int i = 0; i < NumParameters; i++) {
+	if (strcmp(name, parameters[i].name))
+	    continue;
+	if (value < parameters[i].least) {
+	    printf("Machine parameter %s must be at least %d, not %d\n",
+		name, parameters[i].least, value);
+	    return FALSE;
+	}
+	*parameters[i].value = value;
+	changed = TRUE;
+	return TRUE;
+    }
+    printf("Unknown machine parameter %s\n", name);
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// SetMachineParameter
+// 	Set a parameter from a "name=value" string, as given to "-set".
+//----------------------------------------------------------------------
+
+bool
+SetMachineParameter(char *setting)
+{
+    char name[64], extra;
+    char *equals = strchr(setting, '=');
+    int length = (equals == NULL) ? 0 : equals - setting;
+    int value;
+
+    if (length <= 0 || length >= (int) sizeof(name)) {
+	printf("Bad machine parameter setting %s, want name=value\n",
+	    setting);
+	return FALSE;
+    }
+    if (sscanf(equals + 1, "%i%c", &value, &extra) != 1) {
+	printf("Bad value for machine parameter in %s\n", setting);
+	return FALSE;
+    }
+    strncpy(name, setting, length);
+    name[length] = '\0';
+    return SetMachineParameter(name, value);
+}
+
+//----------------------------------------------------------------------
+// ReadMachineConfig
+// 	Set the parameters listed in the UNIX file "fileName", one
+//	"name value" pair per line.  Blank lines, and anything after
+//	a '#', are ignored.  Returns FALSE if the file can't be read,
+//	or if any line in it is wrong (the other lines still count).
+//----------------------------------------------------------------------
+
+bool
+ReadMachineConfig(char *fileName)
+{
+    FILE *file = fopen(fileName, "r");
+    char line[128], name[64], *comment;
+    int value, lineNo = 0, fields;
+    bool ok = TRUE;
+
+    if (file == NULL) {
+	printf("Can't open machine geometry file %s\n", fileName);
+	return FALSE;
+    }
+    while (fgets(line, sizeof(line), file) != NULL) {
+	lineNo++;
+	if ((comment = strchr(line, '#')) != NULL)
+	    *comment = '\0';
+	fields = sscanf(line, "%63s %i", name, &value);
+	if (fields == EOF || fields == 0)
+	    continue;				// a blank line
+	if (fields != 2) {
+	    printf("%s:%d: want \"name value\"\n", fileName, lineNo);
+	    ok = FALSE;
+	} else if (!SetMachineParameter(name, value))
+	    ok = FALSE;
+    }
+    fclose(file);
+    return ok;
+}
+
+//----------------------------------------------------------------------
+// CheckMachineConfig
+// 	Once all the parameters have been set, check the limits that
+//	involve more than one of them, and so can't be checked as each
+//	is set.  Print what is wrong, and return FALSE, if anything is.
+//
+//	The file system has such limits: the disk must be made of
+//	whole cylinder groups, or the tracks past the last group could
+//	never be allocated; and the free sector map must fit in a file.
+//	There can be at most MaxCPUs processors, and more than one only
+//	matters to user programs (cf. Machine::Run).
+//----------------------------------------------------------------------
+
+bool
+CheckMachineConfig()
+{
+    bool ok = TRUE;
+
+    if (NumCPUs > MaxCPUs) {
+	printf("NumCPUs (%d) can be at most %d\n", NumCPUs, MaxCPUs);
+	ok = FALSE;
+    }
+#ifndef USER_PROGRAM
+    if (NumCPUs > 1) {
+	printf("NumCPUs (%d) must be 1: only user programs run on "
+	    "more than one processor\n", NumCPUs);
+	ok = FALSE;
+    }
+#endif
+#ifdef FILESYS
+    if (NumTracks % TracksPerGroup != 0) {
+	printf("NumTracks (%d) must be a multiple of %d, the tracks "
+	    "in a cylinder group\n", NumTracks, TracksPerGroup);
+	ok = FALSE;
+    }
+    if (NumSectors > (int) MaxFileSize * BitsInByte) {
+	printf("A disk of %d sectors is too big: the free sector map "
+	    "can cover at most %d\n", NumSectors, 
+	    (int) MaxFileSize * BitsInByte);
+	ok = FALSE;
+    }
+#endif
+    return ok;
+}
+
+//----------------------------------------------------------------------
+// PrintMachineConfig
+// 	Print all the parameters, so that the statistics of a run can
+//	be told apart from those of a run on another machine.  Nothing
+//	is printed if the defaults were used throughout.
+//----------------------------------------------------------------------
+
+void
+PrintMachineConfig()
+{
+    if (!changed)
+	return;
+    printf("Machine:");
+    for (int i = 0; i < NumParameters; i++)
+	printf(" %s=%d", parameters[i].name, *parameters[i].value);
+    printf("\n");
+}
@@ -0,0 +1,51 @@
+// config.h
+//	The geometry and timing of the simulated machine: how much
+//	physical memory it has, how big its TLB and its disk are, and
+//	how long each kind of operation takes.
+//
+//	These used to be compile-time constants (cf. machine.h, disk.h
+//	and stats.h); they are now variables, with the same names and
+//	the same defaults, so that they can be changed at boot without
+//	recompiling Nachos:
+//
+//		nachos -set NumPhysPages=32 -set TLBSize=8 ...
+//		nachos -geom small.geom ...
+//
+//	A geometry file has one "name value" pair per line; anything
+//	after a '#' is a comment.  The parameters must be set before
+//	the machine is built (cf. Initialize in threads/system.cc), and
+//	once they all are, CheckMachineConfig makes sure that they fit
+//	together.
+//
+//	The page size (which is the sector size) can't be changed this
+//	way: the layout of file headers and directories on disk, and
+//	the size of many kernel buffers, are derived from it.  Note too
+//	that a disk formatted with one geometry can't be read with
+//	another; use "-f" after changing SectorsPerTrack or NumTracks.
+//	The file system also limits the geometry: the disk is made of
+//	whole cylinder groups, and its free sector map must fit in one
+//	file (cf. filesys/filehdr.h).
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "copyright.h"
+#include "utility.h"
+
+extern bool SetMachineParameter(char *name, int value);
+					// set one parameter; FALSE if
+					// there is no such parameter, or
+					// the value is out of range
+extern bool SetMachineParameter(char *setting);
+					// the same, from "name=value"
+extern bool ReadMachineConfig(char *fileName);
+					// set the parameters in a file
+extern bool CheckMachineConfig();	// do the parameters, as set,
+					// make a machine that works?
+extern void PrintMachineConfig();	// print them, if any were set
+
+#endif // CONFIG_H
@@ -255,7 +255,8 @@ Disk::ComputeLatency(int newSector, bool writing)
 //----------------------------------------------------------------------
 // Disk::UpdateLast
 //   	Keep track of the most recently requested sector.  So we can know
-//	what is in the track buffer.
+//	what is in the track buffer.  Also account for how far the head
+//	had to move, so that layout policies can be compared.
 //----------------------------------------------------------------------
 
 void
@@ -264,8 +265,11 @@ Disk::UpdateLast(int newSector)
     int rotate;
     int seek = TimeToSeek(newSector, &rotate);
     
-    if (seek != 0)
+    if (seek != 0) {
 	bufferInit = stats->totalTicks + seek + rotate;
+	stats->numDiskSeeks++;
+	stats->diskSeekDistance += seek / SeekTime;
+    }
     lastSector = newSector;
     DEBUG('d', "Updating last sector = %d, %d\n", lastSector, bufferInit);
 }
@@ -47,8 +47,9 @@
 // The track buffer simulation can be disabled by compiling with -DNOTRACKBUF
 
 #define SectorSize 		128	// number of bytes per disk sector
-#define SectorsPerTrack 	32	// number of sectors per disk track 
-#define NumTracks 		32	// number of tracks per disk
+extern int SectorsPerTrack;		// number of sectors per disk track 
+extern int NumTracks;			// number of tracks per disk
+					// (both set at boot, cf. config.h)
 #define NumSectors 		(SectorsPerTrack * NumTracks)
 					// total # of sectors per disk
 
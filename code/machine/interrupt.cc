@@ -23,12 +23,15 @@
 #include "copyright.h"
 #include "interrupt.h"
 #include "system.h"
+#include "config.h"
+#include "synchprof.h"
 
 // String definitions for debugging messages
 
 static char *intLevelNames[] = { "off", "on"};
 static char *intTypeNames[] = { "timer", "disk", "console write", 
-			"console read", "network send", "network recv"};
+			"console read", "network send", "network recv",
+			"timeout"};
 
 //----------------------------------------------------------------------
 // PendingInterrupt::PendingInterrupt
@@ -64,6 +67,7 @@ Interrupt::Interrupt()
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
+    timerWanted = FALSE;
 }
 
 //----------------------------------------------------------------------
@@ -173,7 +177,11 @@ Interrupt::OneTick()
 					// for a context switch, ok to do it now
 	yieldOnReturn = FALSE;
  	status = SystemMode;		// yield is a kernel routine
+	if (schedTrace != NULL)
+	    schedTrace->Preempting(TRUE);
 	currentThread->Yield();     // RR scheduler
+	if (schedTrace != NULL)		// in case nobody else was ready
+	    schedTrace->Preempting(FALSE);
 	status = old;
     }
 }
@@ -212,6 +220,9 @@ Interrupt::Idle()
 {
     DEBUG('i', "Machine idling; checking for interrupts.\n");
     status = IdleMode;
+#ifdef USER_PROGRAM
+    frameTable->ZeroIdleFrames();	// the CPU has nothing better to do
+#endif
     if (CheckIfDue(TRUE)) {		// check for any pending interrupts
     	while (CheckIfDue(FALSE))	// check for any other pending 
 	    ;				// interrupts
@@ -241,7 +252,15 @@ void
 Interrupt::Halt()
 {
     printf("Machine halting!\n\n");
+    PrintMachineConfig();	// cf. machine/config.h
     stats->Print();
+#ifdef USER_PROGRAM
+    frameTable->Print();	// cf. userprog/frametable.h
+    swapArea->Print();
+#endif
+#ifdef SYNCH_PROFILE
+    SynchProfile::PrintAll();	// cf. threads/synchprof.h
+#endif
     Cleanup();     // Never returns.
 }
 
@@ -311,15 +330,18 @@ Interrupt::CheckIfDue(bool advanceClock)
 	return FALSE;
     }
 
-// Check if there is nothing more to do, and if so, quit
+// Check if there is nothing more to do, and if so, quit -- unless
+// some thread is sleeping until the timer goes off
     if ((status == IdleMode) && (toOccur->type == TimerInt) 
-				&& pending->IsEmpty()) {
+				&& pending->IsEmpty() && !timerWanted) {
 	 pending->SortedInsert(toOccur, when);
 	 return FALSE;
     }
 
     DEBUG('i', "Invoking interrupt handler for the %s at time %d\n", 
 			intTypeNames[toOccur->type], toOccur->when);
+    if (schedTrace != NULL)
+	schedTrace->InterruptCalled(toOccur->type);
 #ifdef USER_PROGRAM
     if (machine != NULL)
     	machine->DelayedLoad(0, 0);
@@ -48,9 +48,11 @@ enum MachineStatus {IdleMode, SystemMode, UserMode};
 
 // IntType records which hardware device generated an interrupt.
 // In Nachos, we support a hardware timer device, a disk, a console
-// display and keyboard, and a network.
+// display and keyboard, and a network.  TimeoutInt is not a device:
+// it is a one-shot kernel timeout (cf. Condition::TimedWait), which,
+// unlike the timer, keeps an idle Nachos from halting while it is pending.
 enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt, 
-				NetworkSendInt, NetworkRecvInt};
+				NetworkSendInt, NetworkRecvInt, TimeoutInt};
 
 // The following class defines an interrupt that is scheduled
 // to occur in the future.  The internal data structures are
@@ -94,6 +96,10 @@ class Interrupt {
     
     void YieldOnReturn();		// cause a context switch on return 
 					// from an interrupt handler
+    bool InHandler() { return inHandler; }	// are we in a handler?
+    void SetTimerWanted(bool wanted) { timerWanted = wanted; }
+					// some thread is asleep until a
+					// timer interrupt, so don't halt
 
     MachineStatus getStatus() { return status; } // idle, kernel, user
     void setStatus(MachineStatus st) { status = st; }
@@ -112,6 +118,8 @@ class Interrupt {
     
     void OneTick();       		// Advance simulated time
       void Exec();
+    void ChangeLevel(IntStatus old, 	// SetLevel, without advancing the
+	IntStatus now);  		// simulated time (cf. Machine::Run)
   private:
     IntStatus level;		// are interrupts enabled or disabled?
     List *pending;		// the list of interrupts scheduled
@@ -120,14 +128,13 @@ class Interrupt {
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
     MachineStatus status;	// idle, kernel mode, user mode
+    bool timerWanted;		// TRUE if a sleeping thread needs the
+				// timer to wake it up
 
     // these functions are internal to the interrupt simulation code
 
     bool CheckIfDue(bool advanceClock); // Check if an interrupt is supposed
 					// to occur now
-
-    void ChangeLevel(IntStatus old, 	// SetLevel, without advancing the
-	IntStatus now);  		// simulated time
 };
 
 #endif // INTERRRUPT_H
@@ -57,20 +57,30 @@ Machine::Machine(bool debug)
 {
     int i;
 
-    for (i = 0; i < NumTotalRegs; i++)
-        registers[i] = 0;
+    cpuRegisters = new int[NumCPUs * NumTotalRegs];
+    for (i = 0; i < NumCPUs * NumTotalRegs; i++)
+        cpuRegisters[i] = 0;
     mainMemory = new char[MemorySize];
     for (i = 0; i < MemorySize; i++)
       	mainMemory[i] = 0;
 #ifdef USE_TLB
-    tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++)
-	tlb[i].valid = FALSE;
-    pageTable = NULL;
+    cpuTLB = new TranslationEntry[NumCPUs * TLBSize];
+    for (i = 0; i < NumCPUs * TLBSize; i++)
+	cpuTLB[i].valid = FALSE;
 #else	// use linear page table
-    tlb = NULL;
-    pageTable = NULL;
+    cpuTLB = NULL;
 #endif
+    cpuPageTable = new TranslationEntry *[NumCPUs];
+    cpuPageTableSize = new unsigned int[NumCPUs];
+    for (i = 0; i < NumCPUs; i++) {
+	cpuPageTable[i] = NULL;
+	cpuPageTableSize[i] = 0;
+    }
+    cpu = 0;
+    registers = cpuRegisters;
+    tlb = cpuTLB;
+    pageTable = NULL;
+    pageTableSize = 0;
 
     singleStep = debug;
     CheckEndian();
@@ -84,8 +94,51 @@ Machine::Machine(bool debug)
 Machine::~Machine()
 {
     delete [] mainMemory;
-    if (tlb != NULL)
-        delete [] tlb;
+    delete [] cpuRegisters;
+    if (cpuTLB != NULL)
+        delete [] cpuTLB;
+    delete [] cpuPageTable;
+    delete [] cpuPageTableSize;
+}
+
+//----------------------------------------------------------------------
+// Machine::SelectCPU
+// 	Simulate processor "which" from now on: its registers, its TLB
+//	and its page table become the machine's.  Those of the processor
+//	we were simulating are kept for when it is selected again.
+//
+//	Called by the scheduler, when it moves on to another processor
+//	(cf. threads/scheduler.h).
+//----------------------------------------------------------------------
+
+void
+Machine::SelectCPU(int which)
+{
+    ASSERT((which >= 0) && (which < NumCPUs));
+    if (which == cpu)
+	return;
+    cpuPageTable[cpu] = pageTable;
+    cpuPageTableSize[cpu] = pageTableSize;
+    cpu = which;
+    registers = &cpuRegisters[cpu * NumTotalRegs];
+    tlb = TLBOf(cpu);
+    pageTable = cpuPageTable[cpu];
+    pageTableSize = cpuPageTableSize[cpu];
+}
+
+//----------------------------------------------------------------------
+// Machine::TLBOf
+// 	Return the TLB of processor "which", so that the kernel can drop
+//	translations from it while another processor is being simulated;
+//	NULL if there are no TLBs.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+Machine::TLBOf(int which)
+{
+    if (cpuTLB == NULL)
+	return NULL;
+    return &cpuTLB[which * TLBSize];
 }
 
 //----------------------------------------------------------------------
@@ -32,9 +32,13 @@
 					// the disk sector size, for
 					// simplicity
 
-#define NumPhysPages    64
+extern int NumPhysPages;		// frames of physical memory
 #define MemorySize 	(NumPhysPages * PageSize)
-#define TLBSize		4		// if there is a TLB, make it small
+extern int TLBSize;			// if there is a TLB, make it small
+extern int NumCPUs;			// processors sharing the memory
+extern int CPUQuantum;			// instructions per processor per turn
+					// (all set at boot, cf. config.h)
+#define MaxCPUs		16		// the most NumCPUs can be
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -146,6 +150,8 @@ class Machine {
     void Debugger();		// invoke the user program debugger
     void DumpState();		// print the user CPU and memory state 
 
+    void SelectCPU(int which);	// Simulate processor "which" from now on
+    TranslationEntry *TLBOf(int which);	// processor "which"'s TLB, or NULL
 
 // Data structures -- all of these are accessible to Nachos kernel code.
 // "public" for convenience.
@@ -155,7 +161,8 @@ class Machine {
 
     char *mainMemory;		// physical memory to store user program,
 				// code and data, while executing
-    int registers[NumTotalRegs]; // CPU registers, for executing user programs
+    int *registers;		// CPU registers, for executing user programs
+				// (those of the processor being simulated)
 
 
 // NOTE: the hardware translation of virtual addresses in the user program
@@ -172,9 +179,14 @@ class Machine {
 // 
 // For simplicity, both the page table pointer and the TLB pointer are
 // public.  However, while there can be multiple page tables (one per address
-// space, stored in memory), there is only one TLB (implemented in hardware).
-// Thus the TLB pointer should be considered as *read-only*, although 
-// the contents of the TLB are free to be modified by the kernel software.
+// space, stored in memory), there is only one TLB per processor (implemented
+// in hardware).  Thus the TLB pointer should be considered as *read-only*,
+// although the contents of the TLB are free to be modified by the kernel
+// software.
+//
+// When there is more than one processor (NumCPUs), the registers, the TLB
+// and the page table pointer are all those of the processor being simulated;
+// SelectCPU switches to another one.  Main memory is shared.
 
     TranslationEntry *tlb;		// this pointer should be considered 
 					// "read-only" to Nachos kernel code
@@ -183,6 +195,12 @@ class Machine {
     unsigned int pageTableSize;
 
   private:
+    int cpu;			// the processor being simulated
+    int *cpuRegisters;		// every processor's registers, in a row
+    TranslationEntry *cpuTLB;	// every processor's TLB, or NULL
+    TranslationEntry **cpuPageTable;	// the page table of each processor,
+    unsigned int *cpuPageTableSize;	// while it isn't being simulated
+
     bool singleStep;		// drop back into the debugger after each
 				// simulated instruction
     int runUntilTime;		// drop back into the debugger when simulated
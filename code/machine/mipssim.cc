@@ -25,12 +25,21 @@ static void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
 //
 //	This routine is re-entrant, in that it can be called multiple
 //	times concurrently -- one for each thread executing user code.
+//
+//	If there is more than one processor, they are all simulated here,
+//	on the one host thread, in turns: after CPUQuantum instructions,
+//	the next busy processor gets a turn (cf. threads/scheduler.h).
+//	Only the instructions of the first busy processor advance the
+//	clock, so that simulated time goes by once per round, as if the
+//	processors ran side by side.
 //----------------------------------------------------------------------
 
 void
 Machine::Run()
 {
     Instruction *instr = new Instruction;  // storage for decoded instruction
+    bool preempted;
+    int turn = 0;			// instructions run in this turn
 	/*printf("Starting thread \"%s\" at time %d\n",
 		currentThread->getName(), stats->totalTicks);
  interrupt->setStatus(UserMode);*/
@@ -48,7 +57,25 @@ Machine::Run()
 		if(ct==30){
 			int y=0;
 		}
-	interrupt->OneTick();
+	if ((NumCPUs == 1) || scheduler->LeadsRound())
+	    interrupt->OneTick();
+	else
+	    stats->userTicks += UserTick;
+	if ((NumCPUs > 1) && (++turn >= CPUQuantum)) {
+	    turn = 0;				// the next processor's turn
+	    interrupt->ChangeLevel(IntOn, IntOff);
+	    interrupt->setStatus(SystemMode);
+	    preempted = scheduler->NextCPU();
+	    interrupt->ChangeLevel(IntOff, IntOn);
+	    if (preempted) {			// a time slice, cf. OneTick
+		if (schedTrace != NULL)
+		    schedTrace->Preempting(TRUE);
+		currentThread->Yield();
+		if (schedTrace != NULL)
+		    schedTrace->Preempting(FALSE);
+	    }
+	    interrupt->setStatus(UserMode);
+	}
 	if (singleStep && (runUntilTime <= stats->totalTicks))
 	  Debugger();
     }
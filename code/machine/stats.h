@@ -30,6 +30,8 @@ class Statistics {
 
     int numDiskReads;		// number of disk read requests
     int numDiskWrites;		// number of disk write requests
+    int numDiskSeeks;		// number of requests that moved the head
+    int diskSeekDistance;	// total number of tracks the head moved
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
@@ -48,13 +50,15 @@ class Statistics {
 // Since Nachos kernel code is directly executed, and the time spent
 // in the kernel measured by the number of calls to enable interrupts,
 // these time constants are none too exact.
+//
+// They can be changed at boot, cf. config.h.
 
-#define UserTick 	1	// advance for each user-level instruction 
-#define SystemTick 	10 	// advance each time interrupts are enabled
-#define RotationTime 	500 	// time disk takes to rotate one sector
-#define SeekTime 	500    	// time disk takes to seek past one track
-#define ConsoleTime 	100	// time to read or write one character
-#define NetworkTime 	100   	// time to send or receive one packet
-#define TimerTicks 	100    	// (average) time between timer interrupts
+extern int UserTick;		// advance for each user-level instruction 
+extern int SystemTick;	 	// advance each time interrupts are enabled
+extern int RotationTime; 	// time disk takes to rotate one sector
+extern int SeekTime;	    	// time disk takes to seek past one track
+extern int ConsoleTime;		// time to read or write one character
+extern int NetworkTime;	   	// time to send or receive one packet
+extern int TimerTicks;	    	// (average) time between timer interrupts
 
 #endif // STATS_H
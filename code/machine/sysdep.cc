@@ -472,6 +472,22 @@ Exit(int exitCode)
     exit(exitCode);
 }
 
+//----------------------------------------------------------------------
+// WallClock
+// 	Return the host's wall-clock time, in microseconds.  Only used
+//	to report how long a benchmark really took, next to the
+//	simulated tick counts.
+//----------------------------------------------------------------------
+
+double
+WallClock()
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000.0 + tv.tv_usec;
+}
+
 //----------------------------------------------------------------------
 // RandomInit
 // 	Initialize the pseudo-random number generator.  We use the
@@ -47,6 +47,9 @@ extern void Delay(int seconds);
 // Initialize system so that cleanUp routine is called when user hits ctl-C
 extern void CallOnUserAbort(VoidNoArgFunctionPtr cleanUp);
 
+// Host wall-clock time in microseconds, for benchmark reports
+extern double WallClock();
+
 // Initialize the pseudo random number generator
 extern void RandomInit(unsigned seed);
 extern int Random();
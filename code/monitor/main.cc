@@ -8,7 +8,8 @@
 //
 // 	Most of this file is not needed until later assignments.
 //
-// Usage: nachos -d <debugflags> -rs <random seed #>
+// Usage: nachos -d <debugflags> -rs <random seed #> -trace <trace file>
+//		-rbench
 //		-s -x <nachos file> -c <consoleIn> <consoleOut>
 //		-f -cp <unix file> <nachos file>
 //		-p <nachos file> -r <nachos file> -l -D -t
@@ -18,7 +19,11 @@
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -trace records context switches, and writes them to <trace file>
+//	as Chrome trace-event JSON when Nachos stops (cf. trace.h)
 //    -z prints the copyright message
+//    -rbench times the monitor ring buffer with different ring sizes,
+//	instead of running the producers and consumers
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
@@ -55,7 +60,8 @@
 
 // External functions used by this file
 
-extern void ProdCons(void), Copy(char *unixFile, char *nachosFile);
+extern void ProdCons(void), RingBenchmark(void);
+extern void Copy(char *unixFile, char *nachosFile);
 extern void Print(char *file), PerformanceTest(void);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
 extern void MailTest(int networkID);
@@ -85,7 +91,13 @@ main(int argc, char **argv)
     (void) Initialize(argc, argv);
     
 #ifdef THREADS
-    ProdCons();
+    for (argCount = 1; argCount < argc; argCount++)
+	if (!strcmp(argv[argCount], "-rbench"))	// ring buffer benchmark
+	    break;
+    if (argCount < argc)
+	RingBenchmark();
+    else
+	ProdCons();
 #endif
 
     for (argc--, argv++; argc > 0; argc -= argCount, argv += argCount) {
@@ -148,16 +148,102 @@ Ring::Get(slot *message)
 	mutex->V();
 }
 
+//----------------------------------------------------------------------
+// Ring::PutBatch
+// 	Put up to "n" messages into the empty slots, with one trip
+//	through the monitor.  If the ring is full, wait until a consumer
+//	has made room; then put as many as fit, and return how many that
+//	was.
+//
+//	Each consumer signalled takes what it can and, if anything is
+//	left, signals the next waiting consumer in turn, so one batch
+//	can wake several of them.  Likewise, if there is still room
+//	after we are done, we pass the monitor on to the next waiting
+//	producer.
+//
+//	"messages" -- the messages to be put in the buffer, in order
+//	"n" -- how many there are
+//----------------------------------------------------------------------
+
+int
+Ring::PutBatch(slot *messages, int n)
+{
+    int i;
+
+    mutex->P();
+
+    if (current == size)
+	notfull->Wait(mutex, next, &next_count);
+
+    if (n > size - current)
+	n = size - current;
+    for (i = 0; i < n; i++) {
+	buffer[in] = messages[i];
+	in = (in + 1) % size;
+    }
+    current += n;
+
+    notempty->Signal(next, &next_count);
+    if (current < size)
+	notfull->Signal(next, &next_count);
+
+    if (next_count > 0)
+	next->V();
+    else
+	mutex->V();
+    return n;
+}
+
+//----------------------------------------------------------------------
+// Ring::GetBatch
+// 	Get up to "n" messages from the full slots, oldest first, with
+//	one trip through the monitor.  If the ring is empty, wait until
+//	a producer has put something in; then take as many as there
+//	are, and return how many that was.
+//
+//	"messages" -- where to put the messages from the buffer
+//	"n" -- how many there is room for
+//----------------------------------------------------------------------
+
+int
+Ring::GetBatch(slot *messages, int n)
+{
+    int i;
+
+    mutex->P();
+
+    if (current == 0)
+	notempty->Wait(mutex, next, &next_count);
+
+    if (n > current)
+	n = current;
+    for (i = 0; i < n; i++) {
+	messages[i] = buffer[out];
+	out = (out + 1) % size;
+    }
+    current -= n;
+
+    notfull->Signal(next, &next_count);
+    if (current > 0)
+	notempty->Signal(next, &next_count);
+
+    if (next_count > 0)
+	next->V();
+    else
+	mutex->V();
+    return n;
+}
+
 int
 Ring::Empty()
 {
-// to be implemented
+    return current == 0;
 }
 
 int
 Ring::Full()
 {
-// to be implemented
+    return current == size;
 }
 
 
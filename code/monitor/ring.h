@@ -12,6 +12,11 @@
 //
 // The constructor (initializer) for the ring burrer is passed with an
 // integer for the size of the buffer (the number of slots). 
+//
+// PutBatch and GetBatch enter the monitor once for a whole batch of
+// messages: they wait (once) until there is room or something to get,
+// move as many messages as they can, up to "n", and return how many
+// they moved.
 
 // class of the slot in the ring-buffer
 
@@ -35,6 +40,9 @@ class Ring {
     void Put(slot *message); // Put a message the next empty slot.
     
     void Get(slot *message); // Get a message from the next  full slot.
+
+    int PutBatch(slot *messages, int n); // Put up to n messages.
+    int GetBatch(slot *messages, int n); // Get up to n messages.
                                             
     int Full();       // Returns non-0 if the ring is full, 0 otherwise.
     int Empty();      // Returns non-0 if the ring is empty, 0 otherwise.
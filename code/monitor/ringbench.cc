@@ -0,0 +1,124 @@
+// ringbench.cc
+//	Throughput benchmark for the monitor ring buffer: one producer
+//	thread sends RingBenchMsgs messages to one consumer thread, for
+//	each of a few ring sizes, two ways:
+//
+//	"hoare"          -- one message at a time, with Put and Get
+//	"hoare-batched"  -- up to RingBenchBatch messages at a time, with
+//			    PutBatch and GetBatch, so the threads go
+//			    through the monitor once per batch
+//
+//	The numbers can be set against those of "nachos -rbench" in
+//	../lab3, which runs the same test on the semaphore ring.  The
+//	consumer checks that the messages arrive in order.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "synch.h"
+#include "ring.h"
+
+#define RingBenchMsgs	20000	// messages sent in each run
+#define RingBenchBatch	16	// most messages moved at a time
+
+static int ringSizes[] = { 1, 4, 16, 64 };
+#define NumRingSizes	(int) (sizeof(ringSizes) / sizeof(int))
+
+static Ring *benchRing;
+static Semaphore *benchDone;		// V'ed by each thread when done
+static int outOfOrder;			// # of messages the consumer
+					// didn't expect
+
+//----------------------------------------------------------------------
+// BenchProducer
+//	Send RingBenchMsgs messages, numbered in order.  "batched" is
+//	whether to send them with PutBatch rather than Put.
+//----------------------------------------------------------------------
+
+static void
+BenchProducer(_int batched)
+{
+    slot batch[RingBenchBatch];
+    int sent = 0, n, i;
+
+    while (sent < RingBenchMsgs) {
+	n = RingBenchMsgs - sent;
+	if (n > RingBenchBatch)
+	    n = RingBenchBatch;
+	if (!batched)
+	    n = 1;
+	for (i = 0; i < n; i++) {
+	    batch[i].thread_id = 0;
+	    batch[i].value = sent + i;
+	}
+	if (batched)
+	    sent += benchRing->PutBatch(batch, n);
+	else {
+	    benchRing->Put(batch);
+	    sent++;
+	}
+    }
+    benchDone->V();
+}
+
+//----------------------------------------------------------------------
+// BenchConsumer
+//	Receive RingBenchMsgs messages, and count those out of order.
+//----------------------------------------------------------------------
+
+static void
+BenchConsumer(_int batched)
+{
+    slot batch[RingBenchBatch];
+    int received = 0, n, i;
+
+    while (received < RingBenchMsgs) {
+	if (batched)
+	    n = benchRing->GetBatch(batch, RingBenchBatch);
+	else {
+	    benchRing->Get(batch);
+	    n = 1;
+	}
+	for (i = 0; i < n; i++)
+	    if (batch[i].value != received + i)
+		outOfOrder++;
+	received += n;
+    }
+    benchDone->V();
+}
+
+//----------------------------------------------------------------------
+// RingBenchmark
+//	Time both workloads with every ring size.  Invoked by "-rbench".
+//----------------------------------------------------------------------
+
+void
+RingBenchmark()
+{
+    int batched, i, startTicks;
+    double startWall;
+
+    benchDone = new Semaphore("ring bench done", 0);
+    for (batched = 0; batched <= 1; batched++)
+	for (i = 0; i < NumRingSizes; i++) {
+	    benchRing = new Ring(ringSizes[i]);
+	    outOfOrder = 0;
+
+	    startTicks = stats->totalTicks;
+	    startWall = WallClock();
+	    (new Thread("ring producer"))->Fork(BenchProducer, batched);
+	    (new Thread("ring consumer"))->Fork(BenchConsumer, batched);
+	    benchDone->P();
+	    benchDone->P();
+	    printf("BENCH workload=ring-%s ringsize=%d msgs=%d errors=%d "
+		"ticks=%d wall_us=%d\n", batched ? "hoare-batched" : "hoare",
+		ringSizes[i], RingBenchMsgs, outOfOrder,
+		stats->totalTicks - startTicks,
+		(int) (WallClock() - startWall));
+	    delete benchRing;
+	}
+    delete benchDone;
+}
@@ -38,6 +38,9 @@ Semaphore::Semaphore(char* debugName, int initialValue)
     name = debugName;
     value = initialValue;
     queue = new List;
+#ifdef SYNCH_PROFILE
+    profile = SynchProfile::Find("semaphore", name);
+#endif
 }
 
 //----------------------------------------------------------------------
@@ -65,6 +68,10 @@ void
 Semaphore::P()
 {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	// disable interrupts
+#ifdef SYNCH_PROFILE
+    int waitStart = stats->totalTicks;
+    bool contended = (bool) (value == 0);
+#endif
     printf("当前状态p：");
     queue->getall();
     while (value == 0) { 			// semaphore not available
@@ -75,6 +82,9 @@ Semaphore::P()
     } 
     value--; 					// semaphore available, 
 						// consume its value
+#ifdef SYNCH_PROFILE
+    profile->Acquired(contended, stats->totalTicks - waitStart);
+#endif
     
     (void) interrupt->SetLevel(oldLevel);	// re-enable interrupts
 }
@@ -115,6 +125,9 @@ Lock::Lock(char* debugName)
     name = debugName;
     owner = NULL;
     lock = new Semaphore(name,1);
+#ifdef SYNCH_PROFILE
+    profile = SynchProfile::Find("lock", name);
+#endif
 }
 
 
@@ -137,9 +150,17 @@ Lock::~Lock()
 void Lock::Acquire() 
 {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);  // disable interrupts
+#ifdef SYNCH_PROFILE
+    int waitStart = stats->totalTicks;
+    bool contended = (bool) (owner != NULL);
+#endif
 
     lock->P();                            // procure the semaphore
     owner = currentThread;                // record the new owner of the lock
+#ifdef SYNCH_PROFILE
+    profile->Acquired(contended, stats->totalTicks - waitStart);
+    acquiredAt = stats->totalTicks;
+#endif
     (void) interrupt->SetLevel(oldLevel); // re-enable interrupts
 }
 
@@ -155,6 +176,9 @@ void Lock::Release()
     // Ensure: a) lock is BUSY  b) this thread is the same one that acquired it.
     ASSERT(currentThread == owner);        
     owner = NULL;                          // clear the owner
+#ifdef SYNCH_PROFILE
+    profile->Released(stats->totalTicks - acquiredAt);
+#endif
     lock->V();                             // vanquish the semaphore
     (void) interrupt->SetLevel(oldLevel);
 }
@@ -185,6 +209,9 @@ Condition::Condition(char* debugName)
     name = debugName;
     queue = new List;
     lock = NULL;
+#ifdef SYNCH_PROFILE
+    profile = SynchProfile::Find("condition", name);
+#endif
 }
 
 //----------------------------------------------------------------------
@@ -210,6 +237,9 @@ Condition::~Condition()
 void Condition::Wait(Lock* conditionLock) 
 { 
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
+#ifdef SYNCH_PROFILE
+    int waitStart = stats->totalTicks;
+#endif
 
     ASSERT(conditionLock->isHeldByCurrentThread());  // check pre-condition
     if(queue->IsEmpty()) {
@@ -220,6 +250,9 @@ void Condition::Wait(Lock* conditionLock)
     conditionLock->Release();      // release the lock
     currentThread->Sleep();        // goto sleep
     conditionLock->Acquire();      // awaken: re-acquire the lock
+#ifdef SYNCH_PROFILE
+    profile->Acquired(TRUE, stats->totalTicks - waitStart);
+#endif
     (void) interrupt->SetLevel(oldLevel);
 }
 
@@ -20,6 +20,7 @@
 #include "copyright.h"
 #include "thread.h"
 #include "list.h"
+#include "synchprof.h"
 
 
 // The following class defines a "semaphore" whose value is a non-negative
@@ -50,6 +51,9 @@ class Semaphore {
     char* name;        // useful for debugging
     int value;         // semaphore value, always >= 0
     List *queue;       // threads waiting in P() for the value to be > 0
+#ifdef SYNCH_PROFILE
+    SynchProfile *profile;	// contention counters (cf. synchprof.h)
+#endif
 };
 
 // The following class defines a "lock".  A lock can be BUSY or FREE.
@@ -78,10 +82,21 @@ class Lock {
 					// checking in Release, and in
 					// Condition variable ops below.
 
+    // Thread::RecomputePriority asks these; the monitor locks don't
+    // take part in priority donation, so they never have waiters
+    // to lend a priority, nor are they on their owner's list.
+    Thread *getOwner() { return owner; }
+    Lock *getNextHeld() { return NULL; }
+    int getWaiterPriority() { return MinPriority; }
+
   private:
     char* name;				// for debugging
     Thread *owner;                      // remember who acquired the lock
     Semaphore *lock;                    // use semaphore for the actual lock
+#ifdef SYNCH_PROFILE
+    SynchProfile *profile;		// contention counters
+    int acquiredAt;			// when "owner" got the lock
+#endif
 };
 
 // The following class defines a "condition variable".  A condition
@@ -136,6 +151,9 @@ class Condition {
     List* queue;  // threads waiting on the condition
     Lock* lock;   // debugging aid:  used to check correctness of
                   // arguments to Wait, Signal and Broacast
+#ifdef SYNCH_PROFILE
+    SynchProfile *profile;	// contention counters (cf. synchprof.h)
+#endif
 };
 
 
@@ -193,8 +193,9 @@ PostOffice::PostOffice(NetworkAddress addr, double reliability,
 
 
 // Finally, create a thread whose sole job is to wait for incoming messages,
-//   and put them in the right mailbox. 
-    Thread *t = new Thread("postal worker");
+//   and put them in the right mailbox.  It runs ahead of ordinary threads,
+//   so that incoming packets are not left sitting in the network buffer.
+    Thread *t = new Thread("postal worker", KernelPriority);
 
     t->Fork(PostalHelper, (_int) this);
 }
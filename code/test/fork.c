@@ -0,0 +1,46 @@
+/* fork.c
+ *	Simple program to test the Fork system call.
+ *
+ *	The child starts out sharing every page with the parent; each
+ *	of them then writes to the global array, which gives it its own
+ *	copy of the page.  Each checks that it doesn't see the other's
+ *	writes, and exits with 0 if all is well.
+ */
+
+#include "syscall.h"
+
+#define N 64
+
+int data[N];
+
+void
+child()
+{
+    int i, bad = 0;
+
+    for (i = 0; i < N; i++)
+	data[i] = -i;
+    Yield();			/* let the parent write its copy */
+    for (i = 0; i < N; i++)
+	if (data[i] != -i)
+	    bad++;
+    Exit(bad);
+}
+
+int
+main()
+{
+    int i, bad = 0;
+    SpaceId kid;
+
+    for (i = 0; i < N; i++)
+	data[i] = i;
+    kid = Fork(child);
+    Yield();			/* let the child write its copy */
+    for (i = 0; i < N; i++)
+	data[i] += N;
+    for (i = 0; i < N; i++)
+	if (data[i] != i + N)
+	    bad++;
+    Exit(bad + Join(kid));
+}
@@ -0,0 +1,98 @@
+/* ioring.c
+ *	Simple program to test the Submit system call.
+ *
+ *	Open a file, append Chunks chunks of letters to it, close it and
+ *	open it again, and read the chunks back, all through the rings
+ *	of an IoRing, with one Submit per batch of requests.  A read of
+ *	a file that isn't open must fail without spoiling the rest of
+ *	its batch.  Exits with the number of things that went wrong.
+ */
+
+#include "syscall.h"
+
+#define Chunks		8
+#define ChunkSize	32
+
+IoRing ring;
+char data[Chunks * ChunkSize], back[Chunks * ChunkSize];
+int bad = 0;
+
+static void
+Queue(int op, int fd, char *buffer, int size, int tag)
+{
+    IoRequest *request = &ring.sq[ring.sqTail % IoRingSize];
+
+    request->op = op;
+    request->fd = fd;
+    request->buffer = (int) buffer;
+    request->size = size;
+    request->tag = tag;
+    ring.sqTail++;
+}
+
+/* The result of the next completion, which should be for "tag" */
+static int
+Reap(int tag)
+{
+    IoCompletion *completion;
+
+    if (ring.cqHead == ring.cqTail) {
+	bad++;
+	return -1;
+    }
+    completion = &ring.cq[ring.cqHead % IoRingSize];
+    ring.cqHead++;
+    if (completion->tag != tag)
+	bad++;
+    return completion->result;
+}
+
+int
+main()
+{
+    OpenFileId fd;
+    int i;
+
+    for (i = 0; i < Chunks * ChunkSize; i++)
+	data[i] = 'a' + i % 26;
+    Create("ringdata");
+
+    Queue(IoOpen, 0, "ringdata", 0, 100);
+    if (Submit(&ring) != 1 || (fd = Reap(100)) < 0)
+	Exit(-1);
+
+    for (i = 0; i < Chunks; i++)
+	Queue(IoWrite, fd, &data[i * ChunkSize], ChunkSize, i);
+    if (Submit(&ring) != Chunks)
+	bad++;
+    for (i = 0; i < Chunks; i++)
+	if (Reap(i) != ChunkSize)
+	    bad++;
+
+    Queue(IoClose, fd, 0, 0, 200);
+    Queue(IoOpen, 0, "ringdata", 0, 201);
+    if (Submit(&ring) != 2 || Reap(200) != 0 || (fd = Reap(201)) < 0)
+	Exit(-1);
+
+    for (i = 0; i < Chunks; i++) {
+	if (i == Chunks / 2)
+	    Queue(IoRead, 9, back, ChunkSize, 300);	/* not open */
+	Queue(IoRead, fd, &back[i * ChunkSize], ChunkSize, i);
+    }
+    if (Submit(&ring) != Chunks + 1)
+	bad++;
+    for (i = 0; i < Chunks; i++) {
+	if (i == Chunks / 2 && Reap(300) != -1)
+	    bad++;
+	if (Reap(i) != ChunkSize)
+	    bad++;
+    }
+    for (i = 0; i < Chunks * ChunkSize; i++)
+	if (back[i] != data[i])
+	    bad++;
+
+    Queue(IoClose, fd, 0, 0, 400);
+    Submit(&ring);
+    Reap(400);
+    Exit(bad);
+}
@@ -0,0 +1,49 @@
+/* mmap.c
+ *	Simple program to test the Mmap and Munmap system calls.
+ *
+ *	Write a file of letters in reverse order, map it, and sort the
+ *	letters in place, in the mapping.  Then unmap the file, which
+ *	writes it back, and map it again to check that the sorted
+ *	letters made it to the file.  Exits with 0 if all is well.
+ */
+
+#include "syscall.h"
+
+#define N 300
+
+char buffer[N];
+
+int
+main()
+{
+    OpenFileId fd;
+    char *p, tmp;
+    int i, j, bad = 0;
+
+    for (i = 0; i < N; i++)
+	buffer[i] = 'z' - i % 26;
+    Create("mmapdata");
+    fd = Open("mmapdata");
+    Write(buffer, N, fd);
+
+    p = Mmap(fd, N);
+    Close(fd);			/* the mapping stays */
+    if (p == 0)
+	Exit(-1);
+    for (i = 0; i < N - 1; i++)
+	for (j = 0; j < N - 1 - i; j++)
+	    if (p[j] > p[j + 1]) {
+		tmp = p[j];
+		p[j] = p[j + 1];
+		p[j + 1] = tmp;
+	    }
+    if (Munmap(p) != 0)
+	Exit(-1);
+
+    fd = Open("mmapdata");
+    p = Mmap(fd, N);
+    for (i = 0; i < N - 1; i++)
+	if (p[i] > p[i + 1])
+	    bad++;
+    Exit(bad);
+}
@@ -130,6 +130,38 @@ Yield:
 	j	$31
 	.end Yield
 
+	.globl Sleep
+	.ent	Sleep
+Sleep:
+	addiu $2,$0,SC_Sleep
+	syscall
+	j	$31
+	.end Sleep
+
+	.globl Mmap
+	.ent	Mmap
+Mmap:
+	addiu $2,$0,SC_Mmap
+	syscall
+	j	$31
+	.end Mmap
+
+	.globl Munmap
+	.ent	Munmap
+Munmap:
+	addiu $2,$0,SC_Munmap
+	syscall
+	j	$31
+	.end Munmap
+
+	.globl Submit
+	.ent	Submit
+Submit:
+	addiu $2,$0,SC_Submit
+	syscall
+	j	$31
+	.end Submit
+
 /* dummy function to keep gcc happy */
         .globl  __main
         .ent    __main
@@ -0,0 +1,201 @@
+// alarm.cc
+//	Routines to put threads to sleep for a while, and to wake them
+//	up again from the timer interrupt handler.
+//
+//	The timer interrupts once every TimerTicks (on average), so that
+//	is the resolution of the alarm clock: a thread that asks to sleep
+//	for "howLong" ticks is woken on the first timer interrupt at or
+//	after the time it asked for.  Time in the wheel is counted in
+//	these timer ticks, not in simulated ticks.
+//
+//	The timer device is only started the first time a thread goes
+//	to sleep (unless it is already running for time-slicing), so
+//	Nachos runs that never sleep see no timer interrupts at all.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "alarm.h"
+#include "system.h"
+
+#define AlarmSlotMask	(AlarmSlots - 1)
+
+//----------------------------------------------------------------------
+// AlarmInterruptHandler
+//	Interrupt handler for the timer device, when the timer has been
+//	started by the alarm clock rather than for time-slicing.  We
+//	only context switch if a thread we woke up is more urgent than
+//	the one that was interrupted.
+//
+//	"dummy" is because every interrupt handler takes one argument.
+//----------------------------------------------------------------------
+
+static void
+AlarmInterruptHandler(_int dummy)
+{
+#ifdef USER_PROGRAM
+    frameTable->TimerTick();		// sample the use bits
+#endif
+    if (alarmClock->Tick() && interrupt->getStatus() != IdleMode)
+	interrupt->YieldOnReturn();
+}
+
+//----------------------------------------------------------------------
+// Alarm::Alarm
+//	Initialize the alarm clock, with an empty wheel.
+//----------------------------------------------------------------------
+
+Alarm::Alarm()
+{
+    for (int level = 0; level < AlarmLevels; level++)
+	for (int slot = 0; slot < AlarmSlots; slot++)
+	    wheel[level][slot] = NULL;
+    current = 0;
+    numSleepers = 0;
+}
+
+//----------------------------------------------------------------------
+// Alarm::Insert
+//	Put a sleeping thread in its slot.  The further away its time is,
+//	the higher the level it goes in; a thread due more than the whole
+//	wheel away goes in the top level, and is moved down later.
+//
+//	"entry" is the sleeper; entry->when must not be before "current".
+//----------------------------------------------------------------------
+
+void
+Alarm::Insert(AlarmEntry *entry)
+{
+    unsigned int delta = entry->when - current;
+    int level, slot;
+
+    for (level = 0; level < AlarmLevels - 1; level++)
+	if (delta < (1U << ((level + 1) * AlarmSlotBits)))
+	    break;
+    slot = (entry->when >> (level * AlarmSlotBits)) & AlarmSlotMask;
+    entry->next = wheel[level][slot];
+    wheel[level][slot] = entry;
+}
+
+//----------------------------------------------------------------------
+// Alarm::Cascade
+//	The slots below "level" have wrapped around; take the slot of
+//	"level" that covers the time we have just reached, and spread its
+//	sleepers out over the lower levels.
+//
+//	Returns TRUE if this level has wrapped around too, so that the
+//	level above it needs to be cascaded as well.
+//----------------------------------------------------------------------
+
+bool
+Alarm::Cascade(int level)
+{
+    int slot = (current >> (level * AlarmSlotBits)) & AlarmSlotMask;
+    AlarmEntry *entry = wheel[level][slot];
+    AlarmEntry *next;
+
+    wheel[level][slot] = NULL;
+    for (; entry != NULL; entry = next) {
+	next = entry->next;
+	Insert(entry);
+    }
+    return (bool) (slot == 0);
+}
+
+//----------------------------------------------------------------------
+// Alarm::Tick
+//	Called from the timer interrupt handler, with interrupts off.
+//	Catch the wheel up with the simulated time, waking every thread
+//	whose time has come.  The timer may be late, or may have been
+//	running slowly, so we may need to go over more than one slot.
+//
+//	Returns TRUE if one of the threads we woke up is more urgent than
+//	the current thread, so the caller should context switch.
+//----------------------------------------------------------------------
+
+bool
+Alarm::Tick()
+{
+    unsigned int now = stats->totalTicks / TimerTicks;
+    bool preempt = FALSE;
+    AlarmEntry *entry;
+    int slot, level;
+
+    ASSERT(interrupt->getLevel() == IntOff);
+    while (numSleepers > 0 && (int) (now - current) >= 0) {
+	slot = current & AlarmSlotMask;
+	for (level = 1; slot == 0 && level < AlarmLevels; level++)
+	    if (!Cascade(level))
+		break;
+	for (entry = wheel[0][slot]; entry != NULL; entry = entry->next) {
+	    DEBUG('t', "Alarm waking up thread \"%s\"\n",
+		entry->thread->getName());
+	    scheduler->ReadyToRun(entry->thread);
+	    if (entry->thread->getPriority() < currentThread->getPriority())
+		preempt = TRUE;
+	    numSleepers--;
+	}
+	wheel[0][slot] = NULL;
+	current++;
+    }
+    if (numSleepers == 0)
+	interrupt->SetTimerWanted(FALSE);
+    return preempt;
+}
+
+//----------------------------------------------------------------------
+// Alarm::StartTimer
+//	Start the timer device, unless it is running already (for
+//	time-slicing, or because a thread has slept before).  As long as
+//	no one is asleep, the timer doesn't keep an idle Nachos from
+//	halting (cf. Interrupt::SetTimerWanted).
+//----------------------------------------------------------------------
+
+void
+Alarm::StartTimer()
+{
+    if (timer == NULL)
+	timer = new Timer(AlarmInterruptHandler, 0, FALSE);
+}
+
+//----------------------------------------------------------------------
+// Alarm::WaitUntil
+//	Put the current thread to sleep for at least "howLong" ticks of
+//	simulated time.  Other threads run in the meantime; if there are
+//	none, simulated time skips ahead to the next timer interrupt.
+//
+//	The sleeper's entry in the wheel lives on its own stack, since it
+//	can't go away before the thread is woken up.
+//
+//	"howLong" is the number of ticks to sleep; if it is not positive,
+//	we return right away.
+//----------------------------------------------------------------------
+
+void
+Alarm::WaitUntil(int howLong)
+{
+    IntStatus oldLevel;
+    AlarmEntry entry;
+
+    if (howLong <= 0)
+	return;
+    oldLevel = interrupt->SetLevel(IntOff);
+    if (numSleepers == 0)		// nothing to catch up on
+	current = stats->totalTicks / TimerTicks;
+    entry.thread = currentThread;
+    entry.when = (stats->totalTicks + howLong + TimerTicks - 1) / TimerTicks;
+    if ((int) (entry.when - current) < 0)
+	entry.when = current;
+    Insert(&entry);
+    numSleepers++;
+
+    StartTimer();
+    interrupt->SetTimerWanted(TRUE);
+
+    DEBUG('t', "Thread \"%s\" sleeping until timer tick %d\n",
+	currentThread->getName(), entry.when);
+    currentThread->Sleep();
+    (void) interrupt->SetLevel(oldLevel);
+}
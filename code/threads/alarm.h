@@ -0,0 +1,67 @@
+// alarm.h
+//	Data structures for a software alarm clock.
+//
+//	A thread calls WaitUntil to go to sleep for (at least) a given
+//	number of ticks of simulated time; the timer interrupt handler
+//	wakes it up again once that much time has gone by.
+//
+//	Sleeping threads are kept in a hierarchical timer wheel, so that
+//	putting a thread to sleep and handling a timer interrupt take
+//	(nearly) constant time, no matter how many threads are asleep.
+//	The wheel has AlarmLevels levels of AlarmSlots slots each; a
+//	slot at level 0 holds the threads due on one timer tick, a slot
+//	at level 1 those due in one run of AlarmSlots ticks, and so on.
+//	Whenever level 0 wraps around, the next slot up is emptied into
+//	the levels below it.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef ALARM_H
+#define ALARM_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "thread.h"
+
+#define AlarmSlotBits	6
+#define AlarmSlots	(1 << AlarmSlotBits)	// slots per level
+#define AlarmLevels	4			// levels in the wheel
+
+// One sleeping thread, waiting in a slot of the wheel.  These live on
+// the sleeping thread's own stack, in WaitUntil.
+
+class AlarmEntry {
+  public:
+    Thread *thread;		// who to wake up
+    unsigned int when;		// timer tick to wake it on
+    AlarmEntry *next;		// next sleeper in the same slot
+};
+
+// The following class defines the alarm clock.
+
+class Alarm {
+  public:
+    Alarm();			// initialize the alarm clock, no sleepers
+    ~Alarm() {}
+
+    void WaitUntil(int howLong);	// put the current thread to sleep
+					// for "howLong" ticks
+    bool Tick();		// called by the timer interrupt handler;
+				// wake up any thread whose time has come
+    int NumSleepers() { return numSleepers; }
+    void StartTimer();		// start the timer device, if it isn't
+				// running already
+
+  private:
+    AlarmEntry *wheel[AlarmLevels][AlarmSlots];
+    unsigned int current;	// next timer tick to look at
+    int numSleepers;		// # of threads in the wheel
+
+    void Insert(AlarmEntry *entry);	// put "entry" in its slot
+    bool Cascade(int level);	// move a slot of "level" to the levels
+				// below; TRUE if it wrapped around
+};
+
+#endif // ALARM_H
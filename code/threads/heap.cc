@@ -0,0 +1,261 @@
+// heap.cc
+//
+//     	Routines to manage a binary heap of "things".
+//
+//	The heap is kept in an array: the children of elements[i] are
+//	elements[2i+1] and elements[2i+2], and no element comes out
+//	before its parent.  The array is doubled whenever it fills up.
+//
+//     	NOTE: Mutual exclusion must be provided by the caller.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "heap.h"
+
+#define InitialHeapSlots	16
+
+//----------------------------------------------------------------------
+// Heap::Heap
+//	Initialize a heap, empty to start with.
+//----------------------------------------------------------------------
+
+Heap::Heap()
+{
+    numSlots = InitialHeapSlots;
+    elements = new HeapElement[numSlots];
+    numItems = 0;
+    nextSeq = 0;
+}
+
+//----------------------------------------------------------------------
+// Heap::~Heap
+//	De-allocate the heap.  As with List, the items themselves are
+//	not de-allocated.
+//----------------------------------------------------------------------
+
+Heap::~Heap()
+{
+    delete [] elements;
+}
+
+//----------------------------------------------------------------------
+// Heap::Less
+//	Return TRUE if elements[i] should be removed before elements[j]:
+//	it has a smaller key, or the same key and a smaller sub-key, or
+//	both the same and was inserted earlier.
+//----------------------------------------------------------------------
+
+bool
+Heap::Less(int i, int j)
+{
+    if (elements[i].key != elements[j].key)
+	return (bool) (elements[i].key < elements[j].key);
+    if (elements[i].subKey != elements[j].subKey)
+	return (bool) (elements[i].subKey < elements[j].subKey);
+    return (bool) ((int) (elements[i].seq - elements[j].seq) < 0);
+}
+
+void
+Heap::Swap(int i, int j)
+{
+    HeapElement tmp = elements[i];
+
+    elements[i] = elements[j];
+    elements[j] = tmp;
+}
+
+//----------------------------------------------------------------------
+// Heap::SiftUp, Heap::SiftDown
+//	Restore the heap order after elements[i] has been put in place,
+//	by moving it up towards the root or down towards the leaves.
+//----------------------------------------------------------------------
+
+void
+Heap::SiftUp(int i)
+{
+    int parent;
+
+    while (i > 0) {
+	parent = (i - 1) / 2;
+	if (!Less(i, parent))
+	    break;
+	Swap(i, parent);
+	i = parent;
+    }
+}
+
+void
+Heap::SiftDown(int i)
+{
+    int child;
+
+    while ((child = 2 * i + 1) < numItems) {
+	if (child + 1 < numItems && Less(child + 1, child))
+	    child++;			// the smaller of the two children
+	if (!Less(child, i))
+	    break;
+	Swap(i, child);
+	i = child;
+    }
+}
+
+//----------------------------------------------------------------------
+// Heap::Insert
+//      Put an "item" into the heap, to come out after any item with a
+//	smaller key, or with the same keys that is already in the heap.
+//
+//	"item" is the thing to put in the heap.
+//	"sortKey" is its priority; smaller keys come out first.
+//	"subKey" orders items whose "sortKey" is the same.
+//----------------------------------------------------------------------
+
+void
+Heap::Insert(void *item, int sortKey, int subKey)
+{
+    HeapElement *bigger;
+    int i;
+
+    if (numItems == numSlots) {		// full, so double the array
+	bigger = new HeapElement[2 * numSlots];
+	for (i = 0; i < numItems; i++)
+	    bigger[i] = elements[i];
+	delete [] elements;
+	elements = bigger;
+	numSlots *= 2;
+    }
+    elements[numItems].key = sortKey;
+    elements[numItems].subKey = subKey;
+    elements[numItems].seq = nextSeq++;
+    elements[numItems].item = item;
+    numItems++;
+    SiftUp(numItems - 1);
+}
+
+//----------------------------------------------------------------------
+// Heap::Min
+//      Return the item with the smallest key, without removing it.
+//
+//	Returns NULL if the heap is empty.  Otherwise, if "keyPtr" is
+//	not NULL, its key is stored in *keyPtr.
+//----------------------------------------------------------------------
+
+void *
+Heap::Min(int *keyPtr)
+{
+    if (numItems == 0)
+	return NULL;
+    if (keyPtr != NULL)
+	*keyPtr = elements[0].key;
+    return elements[0].item;
+}
+
+//----------------------------------------------------------------------
+// Heap::RemoveMin
+//      Remove the item with the smallest key from the heap, and
+//	return it.  Returns NULL if the heap is empty.
+//
+//	"keyPtr" if not NULL, gets the key of the removed item.
+//----------------------------------------------------------------------
+
+void *
+Heap::RemoveMin(int *keyPtr)
+{
+    void *item = Min(keyPtr);
+
+    if (item == NULL)
+	return NULL;
+    elements[0] = elements[--numItems];
+    SiftDown(0);
+    return item;
+}
+
+//----------------------------------------------------------------------
+// Heap::Find
+//	Return the index of "item" in the heap, or -1 if it isn't there.
+//	This takes a linear search, so Remove and Update are meant for
+//	the unusual case, not for the normal path.
+//----------------------------------------------------------------------
+
+int
+Heap::Find(void *item)
+{
+    for (int i = 0; i < numItems; i++)
+	if (elements[i].item == item)
+	    return i;
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// Heap::Remove
+//      Take "item" out of the heap, wherever it is.
+//
+//	Returns FALSE if "item" is not in the heap.
+//----------------------------------------------------------------------
+
+bool
+Heap::Remove(void *item)
+{
+    int i = Find(item);
+
+    if (i < 0)
+	return FALSE;
+    elements[i] = elements[--numItems];
+    if (i < numItems) {
+	SiftUp(i);
+	SiftDown(i);
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Heap::Update
+//      Give "item" a new key, and move it to its new place in the heap.
+//	Its sub-key and its place among items with the same keys are
+//	kept.
+//
+//	Returns FALSE if "item" is not in the heap.
+//----------------------------------------------------------------------
+
+bool
+Heap::Update(void *item, int sortKey)
+{
+    int i = Find(item);
+
+    if (i < 0)
+	return FALSE;
+    elements[i].key = sortKey;
+    SiftUp(i);
+    SiftDown(i);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Heap::AddToKeys
+//      Add "delta" to the key of every item.  Since every key moves
+//	by the same amount, the heap stays in order.  This lets a caller
+//	whose keys only ever grow pull them back before they overflow.
+//----------------------------------------------------------------------
+
+void
+Heap::AddToKeys(int delta)
+{
+    for (int i = 0; i < numItems; i++)
+	elements[i].key += delta;
+}
+
+//----------------------------------------------------------------------
+// Heap::Mapcar
+//	Apply a function to each item in the heap, in array order.
+//
+//	"func" is the procedure to apply to each item.
+//----------------------------------------------------------------------
+
+void
+Heap::Mapcar(VoidFunctionPtr func)
+{
+    for (int i = 0; i < numItems; i++)
+	(*func)((_int) elements[i].item);
+}
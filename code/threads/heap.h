@@ -0,0 +1,74 @@
+// heap.h
+//	Data structures to manage a priority queue of "things", kept as
+//	a binary heap.
+//
+//	Like a List, a Heap can hold any type of data structure as an
+//	item, each with an integer key; but instead of walking a chain
+//	of elements, the smallest key can be removed in O(log n) time.
+//	Items may also carry a second key, compared only when the first
+//	keys are equal.  Items with equal keys come out in the order they
+//	were inserted, so a Heap whose keys are all the same is just a
+//	FIFO queue.
+//
+//	The heap grows as needed, so there is no limit on the number
+//	of items it can hold.
+//
+//     	NOTE: Mutual exclusion must be provided by the caller.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef HEAP_H
+#define HEAP_H
+
+#include "copyright.h"
+#include "utility.h"
+
+// The following class defines one slot in the heap.  "seq" records
+// when the item was inserted, to break ties between equal keys.
+
+class HeapElement {
+  public:
+    int key;			// sort key, smallest comes out first
+    int subKey;			// second sort key, for equal keys
+    unsigned int seq;		// insertion order, for equal keys
+    void *item;			// pointer to the item in the heap
+};
+
+// The following class defines a "heap" -- a priority queue of items,
+// ordered by increasing key, then sub-key, then insertion order.
+
+class Heap {
+  public:
+    Heap();			// initialize the heap, empty
+    ~Heap();			// de-allocate the heap
+
+    void Insert(void *item, int sortKey, int subKey = 0);
+					// Put item into the heap
+    void *RemoveMin(int *keyPtr);	// Remove the item with the
+					// smallest key; NULL if empty
+    void *Min(int *keyPtr);		// Same, but leave it in the heap
+    bool Remove(void *item);		// Take "item" out, wherever it is
+    bool Update(void *item, int sortKey);	// Change the key of "item"
+    void AddToKeys(int delta);		// Add "delta" to every key
+    bool IsEmpty() { return (bool) (numItems == 0); }
+    int NumInHeap() { return numItems; }
+
+    void Mapcar(VoidFunctionPtr func);	// Apply "func" to every item,
+					// in no particular order
+
+  private:
+    HeapElement *elements;	// elements[0] is the minimum
+    int numItems;		// # of elements in use
+    int numSlots;		// # of elements allocated
+    unsigned int nextSeq;	// stamp for the next insertion
+
+    int Find(void *item);	// index of "item", or -1
+    bool Less(int i, int j);	// should elements[i] come out first?
+    void Swap(int i, int j);
+    void SiftUp(int i);		// move elements[i] towards the root
+    void SiftDown(int i);	// move elements[i] towards the leaves
+};
+
+#endif // HEAP_H
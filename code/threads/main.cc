@@ -8,7 +8,9 @@
 //
 // 	Most of this file is not needed until later assignments.
 //
-// Usage: nachos -d <debugflags> -rs <random seed #>
+// Usage: nachos -d <debugflags> -rs <random seed #> -trace <trace file>
+//		-sched <priority|lottery|stride>
+//		-geom <geometry file> -set <name>=<value>
 //		-s -x <nachos file> -c <consoleIn> <consoleOut>
 //		-f -cp <unix file> <nachos file>
 //		-p <nachos file> 
@@ -23,8 +25,23 @@
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -trace records context switches, and writes them to <trace file>
+//	as Chrome trace-event JSON when Nachos stops (cf. trace.h)
+//    -sched picks the scheduling policy: priority (the default),
+//	lottery or stride (cf. scheduler.h)
+//    -geom sets the size and speed of the simulated machine from a
+//	file of "name value" lines, and -set sets one of them, e.g.
+//	"-set NumPhysPages=32"; later settings win (cf. machine/config.h)
 //    -z prints the copyright message
 //
+//  THREADS
+//    -sbench times many threads contending for one semaphore
+//    -pri shows priority donation through a lock
+//    -sstress stress-tests readers/writers locks, barriers and latches
+//    -tbench times forking and finishing lots of threads
+//    -share shows the CPU shares of threads with different priorities
+//    -alarm puts lots of threads to sleep for a while
+//
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
 //    -x runs a user program
@@ -38,6 +55,7 @@
 //    -l lists the contents of the Nachos directory
 //    -D prints the contents of the entire file system 
 //    -t tests the performance of the Nachos file system
+//    -bench runs the file system benchmark (on a freshly formatted disk)
 //
 //  NETWORK
 //    -n sets the network reliability
@@ -62,11 +80,14 @@
 
 // External functions used by this file
 
-extern void ThreadTest(void), Copy(char *unixFile, char *nachosFile);
+extern void ThreadTest(void), PriorityTest(void), ForkBenchmark(void);
+extern void AlarmTest(void), ShareTest(void);
+extern void Copy(char *unixFile, char *nachosFile);
 extern void Print(char *file), PerformanceTest(void);
+extern void FileSystemBenchmark(void);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
 extern void MailTest(int networkID);
-extern void SynchTest(void);
+extern void SynchTest(void), SynchBenchmark(void), SynchStress(void);
 
 //----------------------------------------------------------------------
 // main
@@ -101,6 +122,20 @@ main(int argc, char **argv)
 	argCount = 1;
         if (!strcmp(*argv, "-z"))               // print copyright
             printf (copyright);
+#ifdef THREADS
+        if (!strcmp(*argv, "-sbench"))		// semaphore benchmark
+            SynchBenchmark();
+        else if (!strcmp(*argv, "-pri"))	// priority donation
+            PriorityTest();
+        else if (!strcmp(*argv, "-sstress"))	// RWLock/Barrier/Latch
+            SynchStress();
+        else if (!strcmp(*argv, "-tbench"))	// fork/finish benchmark
+            ForkBenchmark();
+        else if (!strcmp(*argv, "-alarm"))	// sleeping threads
+            AlarmTest();
+        else if (!strcmp(*argv, "-share"))	// CPU shares
+            ShareTest();
+#endif // THREADS
 #ifdef USER_PROGRAM
         if (!strcmp(*argv, "-x")) {        	// run a user program
 	    ASSERT(argc > 1);
@@ -141,6 +176,8 @@ DEBUG('f', "Opening filesss sa\n");
             fileSystem->Print();
 	} else if (!strcmp(*argv, "-t")) {	// performance test
             PerformanceTest();
+	} else if (!strcmp(*argv, "-bench")) {	// file system benchmark
+            FileSystemBenchmark();
 	}else if(!strcmp(*argv,"-ld")) {
 		ASSERT(argc>1);
 		fileSystem->ListDir(*(argv+1));
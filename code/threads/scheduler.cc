@@ -4,15 +4,16 @@
 //
 // 	These routines assume that interrupts are already disabled.
 //	If interrupts are disabled, we can assume mutual exclusion
-//	(since we are on a uniprocessor).
+//	(since only one processor is simulated at a time, cf. scheduler.h).
 //
 // 	NOTE: We can't use Locks to provide mutual exclusion here, since
 // 	if we needed to wait for a lock, and the lock was busy, we would 
 //	end up calling FindNextToRun(), and that would put us in an 
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
+// 	Threads are run in priority order (cf. thread.h), and FIFO among
+//	threads of the same priority -- unless a proportional-share
+//	policy was asked for (cf. scheduler.h).
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -21,15 +22,36 @@
 #include "copyright.h"
 #include "scheduler.h"
 #include "system.h"
+#include "machine.h"			// for NumCPUs
+
+#define InitialPoolSlots	16
 
 //----------------------------------------------------------------------
 // Scheduler::Scheduler
-// 	Initialize the list of ready but not running threads to empty.
+// 	Initialize the lists of ready but not running threads to empty,
+//	one for each processor.  All the processors but the first (which
+//	the main thread is on) start out idle.
+//
+//	"schedPolicy" is how to choose among the ready threads.
 //----------------------------------------------------------------------
 
-Scheduler::Scheduler()
+Scheduler::Scheduler(SchedPolicy schedPolicy)
 { 
-    readyList = new List; 
+    policy = schedPolicy;
+    queue = new ReadyQueue[NumCPUs];
+    running = new Thread *[NumCPUs];
+    preempt = new bool[NumCPUs];
+    for (int i = 0; i < NumCPUs; i++) {
+	queue[i].heap = new Heap;
+	queue[i].poolSlots = InitialPoolSlots;
+	queue[i].pool = new Thread *[InitialPoolSlots];
+	queue[i].poolSize = queue[i].totalTickets = 0;
+	queue[i].globalPass = 0;
+	running[i] = NULL;
+	preempt[i] = FALSE;
+    }
+    numReady = 0;
+    cpu = 0;
     #ifdef USER_PROGRAM
 
     terminal=new List;
@@ -39,12 +61,18 @@ Scheduler::Scheduler()
 
 //----------------------------------------------------------------------
 // Scheduler::~Scheduler
-// 	De-allocate the list of ready threads.
+// 	De-allocate the lists of ready threads.
 //----------------------------------------------------------------------
 
 Scheduler::~Scheduler()
 { 
-    delete readyList; 
+    for (int i = 0; i < NumCPUs; i++) {
+	delete queue[i].heap;
+	delete [] queue[i].pool;
+    }
+    delete [] queue;
+    delete [] running;
+    delete [] preempt;
     #ifdef USER_PROGRAM
 
     delete terminal;
@@ -55,7 +83,10 @@ Scheduler::~Scheduler()
 //----------------------------------------------------------------------
 // Scheduler::ReadyToRun
 // 	Mark a thread as ready, but not running.
-//	Put it on the ready list, for later scheduling onto the CPU.
+//	Put it on a ready list, for later scheduling onto a CPU: that of
+//	the processor it last ran on, unless that processor is busy and
+//	another is idle, in which case the idle one gets it.  A thread
+//	that is giving up its processor, but not blocking, stays put.
 //
 //	"thread" is the thread to be put on the ready list.
 //----------------------------------------------------------------------
@@ -65,9 +96,71 @@ Scheduler::ReadyToRun (Thread *thread)
 {
     DEBUG('t', "Putting thread %s on ready list.\n", thread->getName());
 
+    bool wasRunning = (bool) (thread->getStatus() == RUNNING);
+    ReadyQueue *q;
+    Thread **bigger;
+
+    if (!wasRunning && Running(thread->cpu) != NULL)
+	for (int i = 0; i < NumCPUs; i++)
+	    if (Running(i) == NULL) {
+		thread->cpu = i;
+		break;
+	    }
+    q = &queue[thread->cpu];
+    numReady++;
     thread->setStatus(READY);
-    readyList->Append((void *)thread);
-    //readyList->SortedInsert((void *)thread,thread->get_this_priority());
+    if (schedTrace != NULL)
+	schedTrace->Ready(thread);
+    switch (policy) {
+      case PriorityPolicy:
+	q->heap->Insert((void *)thread, thread->getPriority());
+	break;
+      case LotteryPolicy:
+	if (q->poolSize == q->poolSlots) {	// full, so double the pool
+	    bigger = new Thread *[2 * q->poolSlots];
+	    for (int i = 0; i < q->poolSize; i++)
+		bigger[i] = q->pool[i];
+	    delete [] q->pool;
+	    q->pool = bigger;
+	    q->poolSlots *= 2;
+	}
+	thread->tickets = Tickets(thread);
+	q->pool[q->poolSize++] = thread;
+	q->totalTickets += thread->tickets;
+	break;
+      case StridePolicy:
+	// A thread that was asleep (or is new) starts out level with
+	// the others, so it can't make up for the time it was away.
+	if (!wasRunning || thread->pass < q->globalPass)
+	    thread->pass = q->globalPass;
+	thread->tickets = Tickets(thread);
+	q->heap->Insert((void *)thread, thread->pass);
+	break;
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Tickets
+// 	Return the number of tickets "thread" holds: those that go with
+//	its priority, plus those of any user program waiting in Join for
+//	it to finish.
+//----------------------------------------------------------------------
+
+int
+Scheduler::Tickets (Thread *thread)
+{
+    int tickets = TicketsFor(thread->getPriority());
+
+#ifdef USER_PROGRAM
+    if (thread->space != NULL)
+	for (ListElement *ptr = waiting->getfirst(); ptr != NULL;
+		ptr = ptr->next) {
+	    Thread *joiner = (Thread *) ptr->item;
+	    if (joiner->waitSpaceId() == thread->userProgramId())
+		tickets += TicketsFor(joiner->getPriority());
+	}
+#endif
+    return (tickets > 0) ? tickets : 1;		// in case of a bad priority
 }
 void 
 Scheduler::putinwaitting(Thread* thread){
@@ -87,7 +180,181 @@ Scheduler::putinwaitting(Thread* thread){
 Thread *
 Scheduler::FindNextToRun ()
 {
-    return (Thread *)readyList->Remove();
+    return Take(cpu);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::QueueSize
+// 	Return the number of threads on the ready list of processor
+//	"which".
+//----------------------------------------------------------------------
+
+int
+Scheduler::QueueSize (int which)
+{
+    if (policy == LotteryPolicy)
+	return queue[which].poolSize;
+    return queue[which].heap->NumInHeap();
+}
+
+//----------------------------------------------------------------------
+// Scheduler::QueueFor
+// 	Return the processor whose ready list "which" should take its
+//	next thread from: its own, unless that is empty and another isn't,
+//	in which case the longest.
+//----------------------------------------------------------------------
+
+int
+Scheduler::QueueFor (int which)
+{
+    int longest = which;
+
+    if (numReady == QueueSize(which))		// nothing to take elsewhere
+	return which;
+    if (QueueSize(which) == 0)
+	for (int i = 0; i < NumCPUs; i++)
+	    if (QueueSize(i) > QueueSize(longest))
+		longest = i;
+    return longest;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Take
+// 	FindNextToRun, on behalf of processor "which", which may be
+//	another one than the current thread's.
+//----------------------------------------------------------------------
+
+Thread *
+Scheduler::Take (int which)
+{
+    ReadyQueue *q = &queue[QueueFor(which)];
+    Thread *thread;
+
+    switch (policy) {
+      case LotteryPolicy:
+	thread = DrawLottery(q);
+	break;
+      case StridePolicy:
+	thread = NextStride(q);
+	break;
+      default:
+	thread = (Thread *)q->heap->RemoveMin(NULL);
+	break;
+    }
+    if (thread != NULL)
+	numReady--;
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::DrawLottery
+// 	Draw a ticket at random out of all those held by the threads in
+//	"q", and take the thread holding it out of the pool.  Returns NULL
+//	if the pool is empty.
+//----------------------------------------------------------------------
+
+Thread *
+Scheduler::DrawLottery (ReadyQueue *q)
+{
+    Thread *winner;
+    int ticket, i;
+
+    if (q->poolSize == 0)
+	return NULL;
+    ticket = Random() % q->totalTickets;
+    for (i = 0; ticket >= q->pool[i]->tickets; i++)
+	ticket -= q->pool[i]->tickets;
+    winner = q->pool[i];
+    q->pool[i] = q->pool[--q->poolSize];	// order in the pool doesn't
+					// matter
+    q->totalTickets -= winner->tickets;
+    return winner;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::NextStride
+// 	Take the thread in "q" with the lowest pass, and charge it one
+//	stride for the time slice it is about to get.  Returns NULL if
+//	no thread is ready.
+//
+//	Passes only grow, so once they get big we pull every one back
+//	by the same amount; threads that aren't ready get a fresh pass
+//	when they are, so only the ready list needs changing.
+//----------------------------------------------------------------------
+
+static int rebaseBy;			// how far NextStride pulls back
+
+static void
+RebasePass(_int arg)
+{
+    ((Thread *) arg)->pass -= rebaseBy;
+}
+
+Thread *
+Scheduler::NextStride (ReadyQueue *q)
+{
+    Thread *thread = (Thread *)q->heap->RemoveMin(NULL);
+
+    if (thread == NULL)
+	return NULL;
+    q->globalPass = thread->pass;
+    if (q->globalPass >= StrideRebase) {
+	rebaseBy = q->globalPass;
+	q->heap->AddToKeys(-rebaseBy);
+	q->heap->Mapcar((VoidFunctionPtr) RebasePass);
+	thread->pass = q->globalPass = 0;
+    }
+    thread->pass += StrideOne / thread->tickets;
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::FindNextToRun
+// 	Like FindNextToRun(), but only return the next thread if it is at
+//	least as urgent as "priority"; otherwise leave it on the ready list
+//	and return NULL.  Used by Thread::Yield, so that yielding never
+//	hands the CPU to a less urgent thread.
+//----------------------------------------------------------------------
+
+Thread *
+Scheduler::FindNextToRun (int priority)
+{
+    Heap *readyList = queue[QueueFor(cpu)].heap;
+    int nextPriority;
+
+    if (IsProportional())
+	return FindNextToRun();
+    if (readyList->Min(&nextPriority) == NULL || nextPriority > priority)
+	return NULL;
+    numReady--;
+    return (Thread *)readyList->RemoveMin(NULL);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Reprioritize
+// 	Move a thread that is on the ready list to the place its new
+//	priority calls for.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Reprioritize (Thread *thread)
+{
+    ReadyQueue *q = &queue[thread->cpu];
+    int tickets;
+
+    switch (policy) {
+      case PriorityPolicy:
+	q->heap->Update((void *)thread, thread->getPriority());
+	break;
+      case LotteryPolicy:
+	tickets = Tickets(thread);
+	q->totalTickets += tickets - thread->tickets;
+	thread->tickets = tickets;
+	break;
+      case StridePolicy:
+	thread->tickets = Tickets(thread);	// takes effect next stride
+	break;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -107,24 +374,101 @@ Scheduler::FindNextToRun ()
 void
 Scheduler::Run (Thread *nextThread)
 {
-    Thread *oldThread = currentThread;
-    
-#ifdef USER_PROGRAM			// ignore until running user programs 
+    nextThread->setStatus(RUNNING);	    // nextThread is now running
+    nextThread->cpu = cpu;		    // on our processor
+    Dispatch(nextThread, cpu);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Relinquish
+// 	Give up the processor, because the current thread is blocked or
+//	done.  Run the next thread on our ready list, or on another's if
+//	ours is empty.  If no thread at all is ready, but another
+//	processor is busy, leave ours idle and go on with that one;
+//	otherwise, wait for an interrupt to make some thread ready.
+//
+//	Returns when the current thread is run again, if ever.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Relinquish ()
+{
+    Thread *nextThread;
+    int which;
+
+    ASSERT(interrupt->getLevel() == IntOff);
+    for (;;) {
+	if ((nextThread = FindNextToRun()) != NULL) {
+	    Run(nextThread);
+	    return;
+	}
+	for (which = 0; which < NumCPUs; which++)
+	    if ((which != cpu) && (running[which] != NULL)) {
+		DEBUG('t', "Processor %d is idle\n", cpu);
+		Dispatch(running[which], which);
+		return;
+	    }
+	interrupt->Idle();	// no one to run, wait for an interrupt
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Dispatch
+// 	Switch to "nextThread", which is running (or about to run) on
+//	processor "which", saving the user state of the current thread,
+//	if it has any, and restoring it once the current thread runs
+//	again.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Dispatch (Thread *nextThread, int which)
+{
+#ifdef USER_PROGRAM			// ignore until running user programs
     if (currentThread->space != NULL) {	// if this thread is a user program,
         currentThread->SaveUserState(); // save the user's CPU registers
 	    currentThread->space->SaveState();
     }
 #endif
-    
+
+    DEBUG('t', "Switching from thread \"%s\" to thread \"%s\"\n",
+	  currentThread->getName(), nextThread->getName());
+    if (schedTrace != NULL)
+	schedTrace->Switch(currentThread, nextThread);
+
+    Switch(nextThread, which);
+
+#ifdef USER_PROGRAM
+    if (currentThread->space != NULL) {		// if there is an address space
+        currentThread->RestoreUserState();     // to restore, do it.
+	    currentThread->space->RestoreState();
+    }
+#endif
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Switch
+// 	Make processor "which" the one being simulated, and SWITCH to
+//	"nextThread" on it.  The processor we leave keeps the current
+//	thread if it is still running; otherwise it is idle.
+//
+//	Returns when the current thread is switched back to.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Switch (Thread *nextThread, int which)
+{
+    Thread *oldThread = currentThread;
+
     oldThread->CheckOverflow();		    // check if the old thread
 					                    // had an undetected stack overflow
 
+    running[cpu] = (oldThread->getStatus() == RUNNING) ? oldThread : NULL;
+    cpu = which;
+#ifdef USER_PROGRAM
+    machine->SelectCPU(which);		    // its registers and TLB
+#endif
     currentThread = nextThread;		    // switch to the next thread
-    currentThread->setStatus(RUNNING);      // nextThread is now running
-    
-    DEBUG('t', "Switching from thread \"%s\" to thread \"%s\"\n",
-	  oldThread->getName(), nextThread->getName());
-    
+
     // void SWITCH( thread *t1, thread *t2 )
 	//This is a machine-dependent assembly language routine defined
     // in switch.s.  You may have to think
@@ -132,7 +476,7 @@ Scheduler::Run (Thread *nextThread)
     // of view of the thread and from the perspective of the "outside world".
 
     SWITCH(oldThread, nextThread);
-    
+
     DEBUG('t', "Now in thread \"%s\"\n", currentThread->getName());
 
     // If the old thread gave up the processor because it was finishing,
@@ -143,13 +487,88 @@ Scheduler::Run (Thread *nextThread)
         delete threadToBeDestroyed;
 	    threadToBeDestroyed = NULL;
     }
-    
-#ifdef USER_PROGRAM
-    if (currentThread->space != NULL) {		// if there is an address space
-        currentThread->RestoreUserState();     // to restore, do it.
-	    currentThread->space->RestoreState();
-    }
-#endif
+}
+
+//----------------------------------------------------------------------
+// Scheduler::NextCPU
+// 	Go on to simulate the next processor that has something to do:
+//	one that is busy, or an idle one with a thread ready to run.  The
+//	current thread keeps its processor, and stays suspended in here
+//	until that processor's turn comes round again.
+//
+//	Called by Machine::Run at the end of each turn, with
+//	interrupts disabled.  Returns TRUE if this processor was asked
+//	to yield in the meantime (cf. PreemptOthers).
+//----------------------------------------------------------------------
+
+bool
+Scheduler::NextCPU ()
+{
+    Thread *nextThread = NULL;
+    int which;
+    bool preempted;
+
+    for (which = (cpu + 1) % NumCPUs; which != cpu;
+		which = (which + 1) % NumCPUs)
+	if ((running[which] != NULL) || (numReady > 0
+		&& (nextThread = Take(which)) != NULL))
+	    break;
+    if (nextThread != NULL) {		// an idle processor gets a thread
+	nextThread->setStatus(RUNNING);
+	nextThread->cpu = which;
+	DEBUG('t', "Starting thread \"%s\" on processor %d\n",
+	    nextThread->getName(), which);
+	Switch(nextThread, which);
+    } else if (which != cpu)
+	Switch(running[which], which);
+    preempted = preempt[cpu];
+    preempt[cpu] = FALSE;
+    return preempted;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::LeadsRound
+// 	Return TRUE if the current thread's processor is the first of
+//	the busy ones: simulated time advances when it runs an
+//	instruction, and it takes the device interrupts.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::LeadsRound ()
+{
+    for (int i = 0; i < cpu; i++)
+	if (running[i] != NULL)
+	    return FALSE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::PreemptOthers
+// 	Ask every busy processor but ours to yield, the next time it is
+//	simulated.  Called from the timer interrupt handler, which only
+//	runs on one of them.
+//----------------------------------------------------------------------
+
+void
+Scheduler::PreemptOthers ()
+{
+    for (int i = 0; i < NumCPUs; i++)
+	if ((i != cpu) && (running[i] != NULL))
+	    preempt[i] = TRUE;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Running
+// 	Return the thread running on processor "which", or NULL if the
+//	processor is idle.
+//----------------------------------------------------------------------
+
+Thread *
+Scheduler::Running (int which)
+{
+    if (which != cpu)
+	return running[which];
+    return (currentThread->getStatus() == RUNNING) ? currentThread : NULL;
 }
 
 //----------------------------------------------------------------------
@@ -160,8 +579,16 @@ Scheduler::Run (Thread *nextThread)
 void
 Scheduler::Print()
 {
-    printf("Ready list contents:\n");
-    readyList->Mapcar((VoidFunctionPtr) ThreadPrint);
+    for (int c = 0; c < NumCPUs; c++) {
+	if (NumCPUs > 1)
+	    printf("Processor %d:\n", c);
+	printf("Ready list contents:\n");
+	if (policy == LotteryPolicy)
+	    for (int i = 0; i < queue[c].poolSize; i++)
+		queue[c].pool[i]->Print();
+	else
+	    queue[c].heap->Mapcar((VoidFunctionPtr) ThreadPrint);
+    }
 }
 
 #ifdef USER_PROGRAM
@@ -11,27 +11,120 @@
 
 #include "copyright.h"
 #include "list.h"
+#include "heap.h"
 #include "thread.h"
 
+// Scheduling policies, chosen with -sched when Nachos starts:
+//
+//	PriorityPolicy -- most urgent thread first, round robin among
+//		threads of the same priority (the default)
+//	LotteryPolicy -- each thread holds tickets, and the next thread
+//		is drawn at random in proportion to its tickets
+//	StridePolicy -- the deterministic version of the lottery: each
+//		thread advances its "pass" by StrideOne / tickets every
+//		time it is picked, and the lowest pass goes next
+//
+// A thread's tickets come from its priority: TicketsFor(MinPriority)
+// is 1, TicketsFor(MaxPriority) is 100.  A user program waiting in
+// Join lends its tickets to the program it waits for.  Tickets are
+// counted each time a thread is put on the ready list.
+
+enum SchedPolicy { PriorityPolicy, LotteryPolicy, StridePolicy };
+
+#define TicketsFor(priority)	(MinPriority + 1 - (priority))
+#define StrideOne	(1 << 12)	// pass added per pick, for 1 ticket
+#define StrideRebase	(1 << 30)	// pull passes back once they get here
+
+// There may be more than one processor (cf. NumCPUs in machine/machine.h).
+// This is a simulation on one host thread: the processors take turns,
+// they never run at the same time, and adding processors doesn't make
+// Nachos itself any faster.  Each turn is CPUQuantum user instructions,
+// after which the next busy processor gets its turn (cf. Machine::Run);
+// simulated time only advances during the first busy processor's turn,
+// so a round takes as long as if they had run side by side.  Whenever a processor is not the one being simulated, the thread
+// on it is suspended in NextCPU; so there is still one currentThread, and
+// kernel code, which only ever runs on the processor being simulated,
+// still gets mutual exclusion from disabling interrupts -- as if the
+// kernel had one big lock.
+//
+// Each processor has its own ready list.  A thread goes back on the list
+// of the processor it last ran on, unless that one is busy and another
+// is idle; a processor with nothing on its list takes a thread from the
+// longest list.  Device interrupts are taken by the lowest-numbered busy
+// processor; when the timer goes off, it asks the others to yield too.
+
+// The threads that are ready to run on one processor.
+
+struct ReadyQueue {
+    Heap *heap;			// queue of threads that are ready to run,
+				// but not running: most urgent first, or
+				// lowest pass first for StridePolicy
+    Thread **pool;		// LotteryPolicy's ready threads
+    int poolSize;		// # of threads in "pool"
+    int poolSlots;		// # of slots allocated in "pool"
+    int totalTickets;		// tickets of all the threads in "pool"
+    int globalPass;		// StridePolicy's virtual time: the pass
+				// of the last thread picked
+};
+
 // The following class defines the scheduler/dispatcher abstraction -- 
 // the data structures and operations needed to keep track of which 
 // thread is running, and which threads are ready but not running.
 
 class Scheduler {
   public:
-    Scheduler();			// Initialize list of ready threads 
+    Scheduler(SchedPolicy schedPolicy = PriorityPolicy);
+					// Initialize list of ready threads 
     ~Scheduler();			// De-allocate ready list
 
     void ReadyToRun(Thread* thread);	// Thread can be dispatched.
     void putinwaitting(Thread* thread);	// Thread can be put in waiting list.
     Thread* FindNextToRun();		// Dequeue first thread on the ready 
 					// list, if any, and return thread.
+    Thread* FindNextToRun(int priority);	// Same, but only if it is
+					// at least as urgent as "priority"
+    void Reprioritize(Thread* thread);	// A ready thread's priority changed
     void Run(Thread* nextThread);	// Cause nextThread to start running
+    void Relinquish();			// The current thread is blocked or
+					// done: run another, or leave this
+					// processor idle
     void Print();			// Print contents of ready list
+    bool IsProportional() { return (bool) (policy != PriorityPolicy); }
+					// lottery or stride?
+    int Tickets(Thread* thread);	// "thread"'s tickets, with any it
+					// has been lent
+
+    bool NextCPU();			// Simulate the next processor; TRUE
+					// if, by the time this one is
+					// simulated again, it was asked to
+					// yield
+    bool LeadsRound();			// Is this the first busy processor?
+    void PreemptOthers();		// Ask the other busy processors
+					// to yield
+    Thread *Running(int which);		// The thread running on processor
+					// "which", NULL if it is idle
     //List *getlist(){return readyList;}
   private:
-    List *readyList;  		// queue of threads that are ready to run,
-				// but not running
+    SchedPolicy policy;
+    ReadyQueue *queue;		// the ready list of each processor
+    int numReady;		// # of threads on all of them
+    int cpu;			// processor the current thread is on
+    Thread **running;		// thread on each of the other processors,
+				// NULL if it is idle
+    bool *preempt;		// processor has been asked to yield
+
+    int QueueSize(int which);	// # of threads on "which"'s ready list
+    int QueueFor(int which);	// "which", or if its ready list is empty,
+				// the processor with the longest one
+    Thread *Take(int which);	// FindNextToRun, for processor "which"
+    Thread *DrawLottery(ReadyQueue *q);	// pick and remove a thread from
+					// q->pool
+    Thread *NextStride(ReadyQueue *q);	// pick and remove the lowest pass
+    void Dispatch(Thread *nextThread, int which);
+				// Run "nextThread" on processor "which"
+    void Switch(Thread *nextThread, int which);
+				// The same, but without saving and
+				// restoring the user state
 #ifdef USER_PROGRAM
     //新加终止队列和等待队列
 private:
@@ -41,7 +134,6 @@ private:
 public:
     List*getwaitinglist(){return waiting;}
     List*getterminallist(){return terminal;}
-    List *getreadylist(){return readyList;}
     void deleteterminal(int spaceid);
 #endif
 };
@@ -24,6 +24,31 @@
 #include "copyright.h"
 #include "synch.h"
 #include "system.h"
+
+//----------------------------------------------------------------------
+// Preempt
+// 	Called after "woken" has been put on the ready list: if it is more
+//	urgent than the current thread, give it the CPU now rather than at
+//	the next time slice.  From an interrupt handler that means
+//	switching on the way out of the handler.
+//
+//	Otherwise we only switch if the caller had interrupts enabled.
+//	If it had them disabled, it is in the middle of something that
+//	must stay atomic (Condition::Wait releasing its lock, for one),
+//	and the switch has to wait for the next Yield.
+//----------------------------------------------------------------------
+
+static void
+Preempt(Thread *woken, IntStatus oldLevel)
+{
+    if (woken == NULL || woken->getPriority() >= currentThread->getPriority())
+	return;
+    if (interrupt->InHandler())
+	interrupt->YieldOnReturn();
+    else if (oldLevel == IntOn)
+	currentThread->Yield();
+}
+
 //----------------------------------------------------------------------
 // Semaphore::Semaphore
 // 	Initialize a semaphore, so that it can be used for synchronization.
@@ -36,7 +61,10 @@ Semaphore::Semaphore(char* debugName, int initialValue)
 {
     name = debugName;
     value = initialValue;
-    queue = new List;
+    queue = new Heap;
+#ifdef SYNCH_PROFILE
+    profile = SynchProfile::Find("semaphore", name);
+#endif
 }
 
 //----------------------------------------------------------------------
@@ -64,13 +92,22 @@ void
 Semaphore::P()
 {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	// disable interrupts
+#ifdef SYNCH_PROFILE
+    int waitStart = stats->totalTicks;
+    bool contended = (bool) (value == 0);
+#endif
     
     while (value == 0) { 			// semaphore not available
-	queue->Append((void *)currentThread);	// so go to sleep
+	queue->Insert((void *)currentThread,	// so go to sleep
+		currentThread->getPriority(), currentThread->times);
+	currentThread->waitQueue = queue;
 	currentThread->Sleep();
     } 
     value--; 					// semaphore available, 
 						// consume its value
+#ifdef SYNCH_PROFILE
+    profile->Acquired(contended, stats->totalTicks - waitStart);
+#endif
     
     (void) interrupt->SetLevel(oldLevel);	// re-enable interrupts
 }
@@ -81,6 +118,12 @@ Semaphore::P()
 //	As with P(), this operation must be atomic, so we need to disable
 //	interrupts.  Scheduler::ReadyToRun() assumes that threads
 //	are disabled when it is called.
+//
+//	We wake the most urgent waiter.  Among equally urgent ones, to be
+//	fair, we wake the one that has done the fewest V()s
+//	(Thread::times), oldest first among equals.  A thread's count
+//	only changes while it runs, so the key it was queued with in P()
+//	is still right, and the heap finds it in O(log n).
 //----------------------------------------------------------------------
 
 void
@@ -88,36 +131,15 @@ Semaphore::V()
 {
     Thread *thread;
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
-    //-------------------------------------------------------
-    //新添内容
-    Thread *arr[100];
-    Thread *answ=NULL;
-    int nums=0,mintimeval=10000;
-    while(1){
-        thread=(Thread *)queue->Remove();
-        if(thread==NULL)break;
-        mintimeval=min(mintimeval,thread->times);
-        arr[nums++]=thread;
-    }
-    bool gain=false;
-    for(int i=0;i<nums;i++){
-        if(arr[i]->times==mintimeval&&(!gain)){
-            gain=true;
-            answ=arr[i];
-            continue;
-        }
-        queue->Append(arr[i]);
-    }
+
+    thread = (Thread *)queue->RemoveMin(NULL);
     currentThread->times++;
-    thread=answ;
-    //delete[]arr;
-    //-------------------------------------------------------
-    
-   
-    //thread = (Thread *)queue->Remove();
-    if (thread != NULL)	   // make thread ready, consuming the V immediately
+    if (thread != NULL) {  // make thread ready, consuming the V immediately
+	thread->waitQueue = NULL;
 	scheduler->ReadyToRun(thread);
+    }
     value++;
+    Preempt(thread, oldLevel);
     (void) interrupt->SetLevel(oldLevel);
 }
 
@@ -129,15 +151,17 @@ Semaphore::V()
 //	"debugName" is an arbitrary name, useful for debugging.
 //----------------------------------------------------------------------
 
-
 Lock::Lock(char* debugName) 
 {
     name = debugName;
     owner = NULL;
-    lock = new Semaphore(name,1);
+    waiters = new Heap;
+    nextHeld = NULL;
+#ifdef SYNCH_PROFILE
+    profile = SynchProfile::Find("lock", name);
+#endif
 }
 
-
 //----------------------------------------------------------------------
 // Lock::~Lock
 // 	De-allocate lock, when no longer needed.  As with semaphore,
@@ -145,37 +169,79 @@ Lock::Lock(char* debugName)
 //----------------------------------------------------------------------
 Lock::~Lock() 
 {
-    delete lock;
+    delete waiters;
 }
 
 //----------------------------------------------------------------------
 // Lock::Acquire
-//      Use a binary semaphore to implement the lock.  Record which 
-//      thread acquired the lock in order to assure that only the
-//      same thread releases it.
+//      Wait until the lock is free, then record that the current thread
+//      owns it, so that only the same thread releases it.
+//
+//      While we wait, the owner runs with our priority if that is
+//      more urgent than its own (Thread::RecomputePriority passes it on
+//      if the owner is waiting for some other lock).  Once we have the
+//      lock, we in turn inherit from whoever is still waiting for it.
 //----------------------------------------------------------------------
 void Lock::Acquire() 
 {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);  // disable interrupts
+#ifdef SYNCH_PROFILE
+    int waitStart = stats->totalTicks;
+    bool contended = (bool) (owner != NULL);
+#endif
 
-    lock->P();                            // procure the semaphore
+    ASSERT(owner != currentThread);	  // no recursive locking
+    while (owner != NULL) {		  // lock is busy, so go to sleep
+	currentThread->waitingFor = this;
+	waiters->Insert((void *)currentThread, currentThread->getPriority());
+	currentThread->waitQueue = waiters;
+	owner->RecomputePriority();	  // lend the owner our priority
+	currentThread->Sleep();
+    }
+    currentThread->waitingFor = NULL;
     owner = currentThread;                // record the new owner of the lock
+    nextHeld = currentThread->locksHeld;
+    currentThread->locksHeld = this;
+    currentThread->RecomputePriority();
+#ifdef SYNCH_PROFILE
+    profile->Acquired(contended, stats->totalTicks - waitStart);
+    acquiredAt = stats->totalTicks;
+#endif
     (void) interrupt->SetLevel(oldLevel); // re-enable interrupts
 }
 
 //----------------------------------------------------------------------
 // Lock::Release
-//      Set the lock to be free (i.e. vanquish the semaphore).  Check
-//      that the currentThread is allowed to release this lock.
+//      Set the lock to be free, and wake up the most urgent waiter.
+//      Check that the currentThread is allowed to release this lock.
+//      Whatever priority the waiters lent us through this lock goes
+//      back.
 //----------------------------------------------------------------------
 void Lock::Release() 
 {
+    Thread *thread;
+    Lock **held;
     IntStatus oldLevel = interrupt->SetLevel(IntOff);  // disable interrupts
 
     // Ensure: a) lock is BUSY  b) this thread is the same one that acquired it.
     ASSERT(currentThread == owner);        
+    for (held = &currentThread->locksHeld; *held != this;
+	    held = &(*held)->nextHeld)
+	ASSERT(*held != NULL);
+    *held = nextHeld;
+    nextHeld = NULL;
     owner = NULL;                          // clear the owner
-    lock->V();                             // vanquish the semaphore
+    currentThread->RecomputePriority();
+#ifdef SYNCH_PROFILE
+    profile->Released(stats->totalTicks - acquiredAt);
+#endif
+
+    thread = (Thread *)waiters->RemoveMin(NULL);
+    if (thread != NULL) {
+	thread->waitQueue = NULL;
+	scheduler->ReadyToRun(thread);
+    }
+    Preempt(thread, oldLevel);
     (void) interrupt->SetLevel(oldLevel);
 }
 
@@ -193,6 +259,20 @@ bool Lock::isHeldByCurrentThread()
     return(result);
 }
 
+//----------------------------------------------------------------------
+// Lock::getWaiterPriority
+//      Return the priority of the most urgent thread waiting for the
+//      lock, or MinPriority if no one is waiting.
+//----------------------------------------------------------------------
+int Lock::getWaiterPriority()
+{
+    int waiterPriority;
+
+    if (waiters->Min(&waiterPriority) == NULL)
+	return MinPriority;
+    return waiterPriority;
+}
+
 //----------------------------------------------------------------------
 // Condition::Condition
 // 	Initialize a condition variable, so that it can be used for 
@@ -203,8 +283,11 @@ bool Lock::isHeldByCurrentThread()
 Condition::Condition(char* debugName) 
 { 
     name = debugName;
-    queue = new List;
+    queue = new Heap;
     lock = NULL;
+#ifdef SYNCH_PROFILE
+    profile = SynchProfile::Find("condition", name);
+#endif
 }
 
 //----------------------------------------------------------------------
@@ -230,16 +313,24 @@ Condition::~Condition()
 void Condition::Wait(Lock* conditionLock) 
 { 
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
+#ifdef SYNCH_PROFILE
+    int waitStart = stats->totalTicks;
+#endif
 
     ASSERT(conditionLock->isHeldByCurrentThread());  // check pre-condition
     if(queue->IsEmpty()) {
 	lock = conditionLock;  // helps to enforce pre-condition
     } 
     ASSERT(lock == conditionLock); // another pre-condition
-    queue->Append(currentThread);  // add this thread to the waiting list
+    queue->Insert(currentThread,   // add this thread to the waiting list
+	currentThread->getPriority());
+    currentThread->waitQueue = queue;
     conditionLock->Release();      // release the lock
     currentThread->Sleep();        // goto sleep
     conditionLock->Acquire();      // awaken: re-acquire the lock
+#ifdef SYNCH_PROFILE
+    profile->Acquired(TRUE, stats->totalTicks - waitStart);
+#endif
     (void) interrupt->SetLevel(oldLevel);
 }
 
@@ -258,7 +349,8 @@ void Condition::Signal(Lock* conditionLock)
     ASSERT(conditionLock->isHeldByCurrentThread());
     if(!queue->IsEmpty()) {
 	ASSERT(lock == conditionLock);
-	nextThread = (Thread *)queue->Remove();
+	nextThread = (Thread *)queue->RemoveMin(NULL);	// most urgent first
+	nextThread->waitQueue = NULL;
 	scheduler->ReadyToRun(nextThread);      // wake up the thread
     } 
     (void) interrupt->SetLevel(oldLevel);
@@ -279,9 +371,497 @@ void Condition::Broadcast(Lock* conditionLock)
     ASSERT(conditionLock->isHeldByCurrentThread());
     if(!queue->IsEmpty()) {
 	ASSERT(lock == conditionLock);
-	while(nextThread = (Thread *)queue->Remove()) {
+	while(nextThread = (Thread *)queue->RemoveMin(NULL)) {
+	    nextThread->waitQueue = NULL;
 	    scheduler->ReadyToRun(nextThread);  // wake up the thread
 	}
     } 
     (void) interrupt->SetLevel(oldLevel);
 }
+
+//----------------------------------------------------------------------
+// WaitTimeout
+//	A pending timeout for Condition::TimedWait.  The timeout interrupt
+//	and the waiting thread each look at it once, in either order;
+//	whichever comes second deletes it.
+//----------------------------------------------------------------------
+
+class WaitTimeout {
+  public:
+    Thread *thread;		// who is waiting
+    Heap *queue;		// the condition's wait queue
+    bool expired;		// the timeout interrupt has gone off
+    bool timedOut;		// ... and found the thread still waiting
+    bool waiterDone;		// the thread has woken up and left
+};
+
+static void
+ConditionTimeout(_int arg)
+{
+    WaitTimeout *timeout = (WaitTimeout *) arg;
+
+    timeout->expired = TRUE;
+    if (timeout->waiterDone) {		// signalled long ago
+	delete timeout;
+	return;
+    }
+    if (timeout->queue->Remove(timeout->thread)) {
+	timeout->timedOut = TRUE;
+	timeout->thread->waitQueue = NULL;
+	scheduler->ReadyToRun(timeout->thread);
+    }					// else signalled, but not run yet
+}
+
+//----------------------------------------------------------------------
+// Condition::TimedWait
+//
+//      Like Wait, but also wake up after "timeout" ticks if no one has
+//      signalled us by then.  Returns FALSE if we timed out.
+//
+//      We can't take the timeout interrupt back once it is scheduled, so
+//      if we are signalled first, the interrupt just finds nothing to
+//      do when it goes off.  It isn't a TimerInt, so that an otherwise
+//      idle Nachos waits for it instead of halting.
+//----------------------------------------------------------------------
+bool Condition::TimedWait(Lock* conditionLock, int timeout)
+{
+    WaitTimeout *pending;
+    bool signalled;
+    IntStatus oldLevel;
+
+    if (timeout == WaitForever) {
+	Wait(conditionLock);
+	return TRUE;
+    }
+    if (timeout <= 0)
+	return FALSE;
+
+    oldLevel = interrupt->SetLevel(IntOff);
+    ASSERT(conditionLock->isHeldByCurrentThread());  // check pre-condition
+    if(queue->IsEmpty()) {
+	lock = conditionLock;  // helps to enforce pre-condition
+    } 
+    ASSERT(lock == conditionLock); // another pre-condition
+
+#ifdef SYNCH_PROFILE
+    int waitStart = stats->totalTicks;
+#endif
+    pending = new WaitTimeout;
+    pending->thread = currentThread;
+    pending->queue = queue;
+    pending->expired = pending->timedOut = pending->waiterDone = FALSE;
+    interrupt->Schedule(ConditionTimeout, (_int) pending, timeout, TimeoutInt);
+
+    queue->Insert(currentThread, currentThread->getPriority());
+    currentThread->waitQueue = queue;
+    conditionLock->Release();      // release the lock
+    currentThread->Sleep();        // goto sleep
+
+    signalled = (bool) !pending->timedOut;
+    if (pending->expired)
+	delete pending;
+    else
+	pending->waiterDone = TRUE;
+    conditionLock->Acquire();      // awaken: re-acquire the lock
+#ifdef SYNCH_PROFILE
+    profile->Acquired(TRUE, stats->totalTicks - waitStart);
+#endif
+    (void) interrupt->SetLevel(oldLevel);
+    return signalled;
+}
+
+//----------------------------------------------------------------------
+// Deadline, WaitUntil
+//	Helpers for the timed acquires below, which may have to wait on
+//	a condition more than once.  Deadline turns a timeout into the
+//	tick at which we give up; WaitUntil waits on "cond" until then,
+//	returning FALSE if the deadline passed.
+//----------------------------------------------------------------------
+
+static int
+Deadline(int timeout)
+{
+    if (timeout == WaitForever)
+	return WaitForever;
+    return stats->totalTicks + timeout;
+}
+
+static bool
+WaitUntil(Condition *cond, Lock *conditionLock, int deadline)
+{
+    if (deadline == WaitForever) {
+	cond->Wait(conditionLock);
+	return TRUE;
+    }
+    return cond->TimedWait(conditionLock, deadline - stats->totalTicks);
+}
+
+//----------------------------------------------------------------------
+// RWLock::RWLock
+// 	Initialize a readers/writers lock, so that it can be used for
+//	synchronization.  The lock is built out of a Lock protecting the
+//	reader count and writer, and condition variables to wait on.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+RWLock::RWLock(char* debugName)
+{
+    name = debugName;
+    mutex = new Lock(debugName);
+    readOk = new Condition(debugName);
+    writeOk = new Condition(debugName);
+    upgradeOk = new Condition(debugName);
+    readers = waitingWriters = 0;
+    writer = upgrader = NULL;
+    numReads = numWrites = numReadWaits = numWriteWaits = 0;
+    numUpgrades = numTimeouts = 0;
+}
+
+//----------------------------------------------------------------------
+// RWLock::~RWLock
+// 	De-allocate a readers/writers lock.  As with Lock, assume no one
+//	is still holding or waiting for it.
+//----------------------------------------------------------------------
+
+RWLock::~RWLock()
+{
+    delete mutex;
+    delete readOk;
+    delete writeOk;
+    delete upgradeOk;
+}
+
+//----------------------------------------------------------------------
+// RWLock::WakeWaiters
+//      Called with the mutex held, after the lock's state changes: wake
+//      up whoever may now go.  A reader waiting to upgrade goes first,
+//      once it is the last reader; then a waiting writer, once no one
+//      holds the lock; and readers only when no writer is waiting.
+//      Waking someone who then finds they still can't go is harmless,
+//      as everyone re-checks in a loop.
+//----------------------------------------------------------------------
+
+void
+RWLock::WakeWaiters()
+{
+    if (upgrader != NULL) {
+	if (readers == 1)
+	    upgradeOk->Signal(mutex);
+    } else if (writer == NULL && waitingWriters > 0) {
+	if (readers == 0)
+	    writeOk->Signal(mutex);
+    } else if (writer == NULL)
+	readOk->Broadcast(mutex);
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReadAcquire/ReadRelease
+//      Join or leave the set of threads reading under the lock.  A
+//      reader has to wait while a writer holds the lock, or is waiting
+//      for it (including a reader waiting to upgrade).  The last
+//      reader out lets a waiting writer in.
+//
+//	"timeout" is how many ticks to wait before giving up, in which
+//	case ReadAcquire returns FALSE.
+//----------------------------------------------------------------------
+
+bool
+RWLock::ReadAcquire(int timeout)
+{
+    int deadline = Deadline(timeout);
+
+    mutex->Acquire();
+    if (writer != NULL || waitingWriters > 0 || upgrader != NULL)
+	numReadWaits++;
+    while (writer != NULL || waitingWriters > 0 || upgrader != NULL) {
+	if (!WaitUntil(readOk, mutex, deadline)
+		&& (writer != NULL || waitingWriters > 0 || upgrader != NULL)) {
+	    numTimeouts++;
+	    mutex->Release();
+	    return FALSE;
+	}
+    }
+    readers++;
+    numReads++;
+    mutex->Release();
+    return TRUE;
+}
+
+void
+RWLock::ReadRelease()
+{
+    mutex->Acquire();
+    ASSERT(readers > 0);
+    readers--;
+    WakeWaiters();
+    mutex->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::WriteAcquire/WriteRelease
+//      Take or give up the lock for exclusive use.  On release, the
+//      next waiting writer goes first; only if there is none are the
+//      waiting readers let in, all at once.
+//
+//	"timeout" is how many ticks to wait before giving up, in which
+//	case WriteAcquire returns FALSE.
+//----------------------------------------------------------------------
+
+bool
+RWLock::WriteAcquire(int timeout)
+{
+    int deadline = Deadline(timeout);
+
+    mutex->Acquire();
+    if (writer != NULL || readers > 0 || upgrader != NULL)
+	numWriteWaits++;
+    waitingWriters++;
+    while (writer != NULL || readers > 0 || upgrader != NULL) {
+	if (!WaitUntil(writeOk, mutex, deadline)
+		&& (writer != NULL || readers > 0 || upgrader != NULL)) {
+	    waitingWriters--;
+	    numTimeouts++;
+	    WakeWaiters();		// readers may have been waiting on us
+	    mutex->Release();
+	    return FALSE;
+	}
+    }
+    waitingWriters--;
+    writer = currentThread;
+    numWrites++;
+    mutex->Release();
+    return TRUE;
+}
+
+void
+RWLock::WriteRelease()
+{
+    mutex->Acquire();
+    ASSERT(writer == currentThread);
+    writer = NULL;
+    WakeWaiters();
+    mutex->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::Upgrade
+//      Turn the current thread's read lock into a write lock, without
+//      letting any writer in between: wait for the other readers to
+//      leave (new ones are held off meanwhile).
+//
+//      Two readers both waiting to upgrade would wait for each other
+//      forever, so only one may do so; if another reader already is,
+//      return FALSE at once, still holding the read lock.
+//----------------------------------------------------------------------
+
+bool
+RWLock::Upgrade()
+{
+    mutex->Acquire();
+    ASSERT(readers > 0 && writer == NULL);
+    if (upgrader != NULL) {
+	mutex->Release();
+	return FALSE;
+    }
+    numUpgrades++;
+    if (readers > 1)
+	numWriteWaits++;
+    upgrader = currentThread;
+    while (readers > 1)
+	upgradeOk->Wait(mutex);
+    upgrader = NULL;
+    readers--;
+    writer = currentThread;
+    numWrites++;
+    mutex->Release();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// RWLock::Downgrade
+//      Turn the current thread's write lock into a read lock, letting
+//      in the readers that are waiting (unless a writer is waiting
+//      too).
+//----------------------------------------------------------------------
+
+void
+RWLock::Downgrade()
+{
+    mutex->Acquire();
+    ASSERT(writer == currentThread);
+    writer = NULL;
+    readers++;
+    numReads++;
+    WakeWaiters();
+    mutex->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::isWriteHeldByCurrentThread
+//----------------------------------------------------------------------
+
+bool
+RWLock::isWriteHeldByCurrentThread()
+{
+    return (bool) (writer == currentThread);
+}
+
+//----------------------------------------------------------------------
+// RWLock::PrintStats
+//      Print how often the lock was taken, and how often that meant
+//      waiting.
+//----------------------------------------------------------------------
+
+void
+RWLock::PrintStats()
+{
+    printf("RWLock %s: %d reads (%d waited), %d writes (%d waited), "
+	"%d upgrades, %d timeouts\n", name, numReads, numReadWaits,
+	numWrites, numWriteWaits, numUpgrades, numTimeouts);
+}
+
+//----------------------------------------------------------------------
+// Barrier::Barrier
+// 	Initialize a barrier for "parties" threads.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+Barrier::Barrier(char* debugName, int numParties)
+{
+    ASSERT(numParties > 0);
+    name = debugName;
+    mutex = new Lock(debugName);
+    allHere = new Condition(debugName);
+    parties = numParties;
+    arrived = round = 0;
+    numWaits = numBlocked = numTimeouts = 0;
+}
+
+Barrier::~Barrier()
+{
+    delete mutex;
+    delete allHere;
+}
+
+//----------------------------------------------------------------------
+// Barrier::Wait
+// 	Arrive at the barrier, and wait for the rest of this round's
+//	threads.  The last one to arrive wakes the others and starts the
+//	next round.  Rounds are numbered, so that a thread woken late
+//	can't mistake the next round for its own.
+//
+//	"timeout" is how many ticks to wait before giving up, in which
+//	case we leave the round and return FALSE.
+//----------------------------------------------------------------------
+
+bool
+Barrier::Wait(int timeout)
+{
+    int deadline = Deadline(timeout);
+    int myRound;
+
+    mutex->Acquire();
+    numWaits++;
+    myRound = round;
+    if (++arrived == parties) {		// we're the last one
+	arrived = 0;
+	round++;
+	allHere->Broadcast(mutex);
+	mutex->Release();
+	return TRUE;
+    }
+    numBlocked++;
+    while (round == myRound) {
+	if (!WaitUntil(allHere, mutex, deadline) && round == myRound) {
+	    arrived--;
+	    numTimeouts++;
+	    mutex->Release();
+	    return FALSE;
+	}
+    }
+    mutex->Release();
+    return TRUE;
+}
+
+void
+Barrier::PrintStats()
+{
+    printf("Barrier %s: %d rounds, %d waits (%d blocked), %d timeouts\n",
+	name, round, numWaits, numBlocked, numTimeouts);
+}
+
+//----------------------------------------------------------------------
+// Latch::Latch
+// 	Initialize a countdown latch, closed until "count" CountDowns
+//	have been done.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+Latch::Latch(char* debugName, int initialCount)
+{
+    ASSERT(initialCount >= 0);
+    name = debugName;
+    mutex = new Lock(debugName);
+    open = new Condition(debugName);
+    count = initialCount;
+    numWaits = numBlocked = numTimeouts = 0;
+}
+
+Latch::~Latch()
+{
+    delete mutex;
+    delete open;
+}
+
+//----------------------------------------------------------------------
+// Latch::CountDown
+// 	Decrement the count, opening the latch if it gets to zero.
+//	Counting down an open latch does nothing.
+//----------------------------------------------------------------------
+
+void
+Latch::CountDown()
+{
+    mutex->Acquire();
+    if (count > 0 && --count == 0)
+	open->Broadcast(mutex);
+    mutex->Release();
+}
+
+//----------------------------------------------------------------------
+// Latch::Wait
+// 	Wait for the latch to open.
+//
+//	"timeout" is how many ticks to wait before giving up, in which
+//	case we return FALSE.
+//----------------------------------------------------------------------
+
+bool
+Latch::Wait(int timeout)
+{
+    int deadline = Deadline(timeout);
+
+    mutex->Acquire();
+    numWaits++;
+    if (count > 0)
+	numBlocked++;
+    while (count > 0) {
+	if (!WaitUntil(open, mutex, deadline) && count > 0) {
+	    numTimeouts++;
+	    mutex->Release();
+	    return FALSE;
+	}
+    }
+    mutex->Release();
+    return TRUE;
+}
+
+void
+Latch::PrintStats()
+{
+    printf("Latch %s: %d waits (%d blocked), %d timeouts\n", name,
+	numWaits, numBlocked, numTimeouts);
+}
@@ -20,6 +20,12 @@
 #include "copyright.h"
 #include "thread.h"
 #include "list.h"
+#include "heap.h"
+#include "synchprof.h"
+
+// Timeouts for the timed waits below are in ticks of simulated time
+// (stats->totalTicks).  A timeout of WaitForever never expires.
+#define WaitForever	-1
 
 // The following class defines a "semaphore" whose value is a non-negative
 // integer.  The semaphore has only two operations P() and V():
@@ -48,7 +54,12 @@ class Semaphore {
   private:
     char* name;        // useful for debugging
     int value;         // semaphore value, always >= 0
-    List *queue;       // threads waiting in P() for the value to be > 0
+    Heap *queue;       // threads waiting in P() for the value to be > 0,
+		       // most urgent first, then whoever has done the
+		       // fewest V()s
+#ifdef SYNCH_PROFILE
+    SynchProfile *profile;	// contention counters (cf. synchprof.h)
+#endif
 };
 
 // The following class defines a "lock".  A lock can be BUSY or FREE.
@@ -62,6 +73,11 @@ class Semaphore {
 // In addition, by convention, only the thread that acquired the lock
 // may release it.  As with semaphores, you can't read the lock value
 // (because the value might change immediately after you read it).  
+//
+// A thread waiting in Acquire lends its priority to the holder of the
+// lock (and on down, if the holder is itself waiting for another lock),
+// so that a less urgent holder can't keep it waiting behind threads of
+// middling priority.
 
 class Lock {
   public:
@@ -77,10 +93,22 @@ class Lock {
 					// checking in Release, and in
 					// Condition variable ops below.
 
+    // for priority donation, cf. Thread::RecomputePriority
+    Thread *getOwner() { return owner; }
+    Lock *getNextHeld() { return nextHeld; }
+    int getWaiterPriority();		// priority of the most urgent
+					// waiter, MinPriority if none
+
   private:
     char* name;				// for debugging
     Thread *owner;                      // remember who acquired the lock
-    Semaphore *lock;                    // use semaphore for the actual lock
+    Heap *waiters;                      // threads waiting in Acquire,
+					// most urgent first
+    Lock *nextHeld;			// next lock held by "owner"
+#ifdef SYNCH_PROFILE
+    SynchProfile *profile;		// contention counters
+    int acquiredAt;			// when "owner" got the lock
+#endif
 };
 
 // The following class defines a "condition variable".  A condition
@@ -101,6 +129,11 @@ class Lock {
 // In other words, mutual exclusion must be enforced among threads calling
 // the condition variable operations.
 //
+// TimedWait() is like Wait(), except that the thread is also woken,
+// and TimedWait() returns FALSE, if no one has signalled it after
+// "timeout" ticks of simulated time.  A timeout of WaitForever is the
+// same as Wait().
+//
 // In Nachos, condition variables are assumed to obey *Mesa*-style
 // semantics.  When a Signal or Broadcast wakes up another thread,
 // it simply puts the thread on the ready list, and it is the responsibility
@@ -130,10 +163,133 @@ class Condition {
     void Broadcast(Lock *conditionLock);// the currentThread for all of 
 					// these operations
 
+    bool TimedWait(Lock *conditionLock, int timeout);
+					// Wait, but give up after "timeout"
+					// ticks; FALSE if we timed out
+
   private:
     char* name;
-    List* queue;  // threads waiting on the condition
+    Heap* queue;  // threads waiting on the condition, most urgent first
     Lock* lock;   // debugging aid:  used to check correctness of
                   // arguments to Wait, Signal and Broacast
+#ifdef SYNCH_PROFILE
+    SynchProfile *profile;	// contention counters (cf. synchprof.h)
+#endif
+};
+
+// The following class defines a "readers/writers lock".  Any number of
+// threads may hold it for reading at the same time, but a thread holding
+// it for writing excludes everyone else:
+//
+//	ReadAcquire -- wait until no one is writing or waiting to write,
+//		then join the readers
+//	ReadRelease -- leave the readers
+//
+//	WriteAcquire -- wait until no one is reading or writing
+//	WriteRelease -- let the next writer, or all waiting readers, in
+//
+//	Upgrade -- turn our read lock into a write lock, once the other
+//		readers have left
+//	Downgrade -- turn our write lock into a read lock, letting the
+//		other readers in
+//
+// The lock prefers writers: once a writer is waiting, new readers wait
+// behind it, so a steady stream of readers can't starve writers.  (So
+// a thread must not read-acquire a lock it already holds for reading.)
+// Only one reader at a time may wait to upgrade; if a second one
+// tries, Upgrade returns FALSE at once, and that reader has to release
+// its read lock and WriteAcquire instead.
+//
+// The acquire operations take an optional timeout (cf. WaitForever),
+// and return FALSE if they gave up without the lock.  Only the thread
+// that write-acquired the lock may write-release it.
+
+class RWLock {
+  public:
+    RWLock(char* debugName);		// initialize lock to be FREE
+    ~RWLock();				// deallocate lock
+    char* getName() { return name; }	// debugging assist
+
+    bool ReadAcquire(int timeout = WaitForever);
+    void ReadRelease();
+    bool WriteAcquire(int timeout = WaitForever);
+    void WriteRelease();
+    bool Upgrade();			// reader -> writer
+    void Downgrade();			// writer -> reader
+
+    bool isWriteHeldByCurrentThread();	// true if the current thread
+					// holds the lock for writing
+    void PrintStats();			// print the contention counters
+
+  private:
+    char* name;				// for debugging
+    Lock *mutex;			// protects the fields below
+    Condition *readOk;			// readers wait here for writers
+    Condition *writeOk;			// writers wait here for everyone
+    Condition *upgradeOk;		// the upgrader waits here for the
+					// other readers to leave
+    int readers;			// # of threads holding it to read
+    int waitingWriters;			// # of threads waiting to write
+    Thread *writer;			// thread holding it to write, if any
+    Thread *upgrader;			// reader waiting to upgrade, if any
+
+    int numReads, numWrites;		// successful acquires,
+    int numReadWaits, numWriteWaits;	// how many of those had to wait,
+    int numUpgrades, numTimeouts;	// and how many acquires gave up
+
+    void WakeWaiters();			// let in whoever can go now
+};
+
+// The following class defines a "barrier": a meeting point for a fixed
+// number of threads ("parties").  Each thread calls Wait(), which
+// returns once all of them have arrived.  The barrier then resets
+// itself for the next round.
+//
+// If Wait() times out, the thread is taken back off the barrier (the
+// round still needs "parties" threads) and Wait() returns FALSE.
+
+class Barrier {
+  public:
+    Barrier(char* debugName, int parties);
+    ~Barrier();
+    char* getName() { return name; }
+
+    bool Wait(int timeout = WaitForever);
+    void PrintStats();
+
+  private:
+    char* name;
+    Lock *mutex;			// protects the fields below
+    Condition *allHere;			// waiting for the round to fill up
+    int parties;			// # of threads per round
+    int arrived;			// # in the current round so far
+    int round;				// # of rounds completed
+
+    int numWaits, numBlocked, numTimeouts;	// contention counters
 };
+
+// The following class defines a "countdown latch".  The latch starts
+// at a count; CountDown() decrements it, and Wait() waits until it
+// reaches zero.  Once open, the latch stays open.
+
+class Latch {
+  public:
+    Latch(char* debugName, int count);
+    ~Latch();
+    char* getName() { return name; }
+
+    void CountDown();
+    bool Wait(int timeout = WaitForever);
+    int getCount() { return count; }
+    void PrintStats();
+
+  private:
+    char* name;
+    Lock *mutex;			// protects the fields below
+    Condition *open;			// waiting for the count to hit zero
+    int count;
+
+    int numWaits, numBlocked, numTimeouts;	// contention counters
+};
+
 #endif // SYNCH_H
@@ -0,0 +1,131 @@
+// synchprof.cc
+//	Routines to count contention on the synchronization objects, and
+//	to print the counts when Nachos halts.  Only compiled in with
+//	-DSYNCH_PROFILE.
+//
+//	The counters are only touched with interrupts off (from inside
+//	the synchronization routines), so they need no locking of their
+//	own.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "synchprof.h"
+
+#ifdef SYNCH_PROFILE
+
+SynchProfile *SynchProfile::all = NULL;
+
+//----------------------------------------------------------------------
+// SynchProfile::SynchProfile
+//	Make an empty set of counters, and add it to the list of them
+//	all.  We keep our own copy of the name, since the object it came
+//	from may not outlive us.
+//----------------------------------------------------------------------
+
+SynchProfile::SynchProfile(char *profKind, char *profName)
+{
+    kind = profKind;
+    name = new char[strlen(profName) + 1];
+    strcpy(name, profName);
+    acquires = contended = totalWait = maxWait = 0;
+    releases = totalHold = maxHold = 0;
+    next = all;
+    all = this;
+}
+
+//----------------------------------------------------------------------
+// SynchProfile::Find
+//	Return the counters for objects of kind "kind" named "name",
+//	making them if this is the first such object.  Called when a
+//	synchronization object is made; a linear search is fine for that.
+//----------------------------------------------------------------------
+
+SynchProfile *
+SynchProfile::Find(char *kind, char *name)
+{
+    SynchProfile *prof;
+
+    if (name == NULL)
+	name = "(unnamed)";
+    for (prof = all; prof != NULL; prof = prof->next)
+	if (!strcmp(prof->kind, kind) && !strcmp(prof->name, name))
+	    return prof;
+    return new SynchProfile(kind, name);
+}
+
+//----------------------------------------------------------------------
+// SynchProfile::Acquired, SynchProfile::Released
+//	Count one acquire (P, Acquire, or the end of a Wait), and one
+//	release of a lock.
+//
+//	"contended" is TRUE if the thread had to go to sleep first.
+//	"waitTicks" is how long it was asleep; "holdTicks" how long the
+//	lock was held.
+//----------------------------------------------------------------------
+
+void
+SynchProfile::Acquired(bool wasContended, int waitTicks)
+{
+    acquires++;
+    if (wasContended)
+	contended++;
+    totalWait += waitTicks;
+    if (waitTicks > maxWait)
+	maxWait = waitTicks;
+}
+
+void
+SynchProfile::Released(int holdTicks)
+{
+    releases++;
+    totalHold += holdTicks;
+    if (holdTicks > maxHold)
+	maxHold = holdTicks;
+}
+
+//----------------------------------------------------------------------
+// SynchProfile::PrintAll
+//	Print one line for each set of counters that was ever used,
+//	sorted by the total time threads spent waiting, most first.
+//----------------------------------------------------------------------
+
+void
+SynchProfile::PrintAll()
+{
+    SynchProfile *prof, **sorted, *tmp;
+    int n = 0, i, j;
+
+    for (prof = all; prof != NULL; prof = prof->next)
+	if (prof->acquires > 0)
+	    n++;
+    if (n == 0)
+	return;
+    sorted = new SynchProfile *[n];
+    for (i = 0, prof = all; prof != NULL; prof = prof->next)
+	if (prof->acquires > 0)
+	    sorted[i++] = prof;
+    for (i = 1; i < n; i++)			// insertion sort
+	for (j = i; j > 0 && sorted[j]->totalWait > sorted[j - 1]->totalWait;
+		j--) {
+	    tmp = sorted[j];
+	    sorted[j] = sorted[j - 1];
+	    sorted[j - 1] = tmp;
+	}
+
+    printf("Synchronization: kind, name, acquires, contended, "
+	"wait total/max, hold total/max\n");
+    for (i = 0; i < n; i++) {
+	prof = sorted[i];
+	printf("  %-9s %-20s %8d %8d %10d/%-8d", prof->kind, prof->name,
+	    prof->acquires, prof->contended, prof->totalWait, prof->maxWait);
+	if (prof->releases > 0)
+	    printf(" %10d/%d", prof->totalHold, prof->maxHold);
+	printf("\n");
+    }
+    delete [] sorted;
+}
+
+#endif // SYNCH_PROFILE
@@ -0,0 +1,60 @@
+// synchprof.h
+//	Data structures for profiling contention on semaphores, locks
+//	and condition variables.
+//
+//	For every synchronization object we count how often it was taken,
+//	how often the taker had to wait, and how long (in ticks of
+//	simulated time) it waited and, for locks, held on.  Objects with
+//	the same debug name share one set of counters, so that, say, all
+//	the locks of the open file table show up as one line.  The totals
+//	are printed when Nachos halts, after the statistics.
+//
+//	Profiling is a compile-time option: build with -DSYNCH_PROFILE
+//	(cf. Makefile.common).  Without it, none of this is compiled, and
+//	the synchronization routines are exactly as they were.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SYNCHPROF_H
+#define SYNCHPROF_H
+
+#include "copyright.h"
+#include "utility.h"
+
+#ifdef SYNCH_PROFILE
+
+// The following class defines the counters kept for one kind of
+// synchronization object ("semaphore", "lock", ...) and one name.
+
+class SynchProfile {
+  public:
+    static SynchProfile *Find(char *kind, char *name);
+				// the counters for "kind" and "name",
+				// made (all zero) the first time
+    static void PrintAll();	// print every set of counters, the most
+				// waited-for first
+
+    void Acquired(bool contended, int waitTicks);
+				// taken, after waiting "waitTicks" ticks
+    void Released(int holdTicks);	// let go, after "holdTicks" ticks
+
+  private:
+    SynchProfile(char *kind, char *name);
+
+    char *kind;			// "semaphore", "lock", ...
+    char *name;			// debug name of the objects counted
+    int acquires;		// # of times taken
+    int contended;		// # of those that had to wait
+    int totalWait, maxWait;	// ticks spent waiting
+    int releases;		// # of times let go (locks only)
+    int totalHold, maxHold;	// ticks between taking and letting go
+    SynchProfile *next;		// next in the list of all counters
+
+    static SynchProfile *all;	// every set of counters made so far
+};
+
+#endif // SYNCH_PROFILE
+
+#endif // SYNCHPROF_H
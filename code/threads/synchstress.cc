@@ -0,0 +1,128 @@
+// synchstress.cc
+//	Stress test for the readers/writers locks, barriers and latches
+//	of synch.h, run with "-sstress".
+//
+//	(This is kept apart from synchtest.cc, which is also built with
+//	the monitor assignment's own synch.h.)
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "synch.h"
+
+//----------------------------------------------------------------------
+// SynchStress
+//      Stress test for RWLock, Barrier and Latch.  StressThreads
+//      threads share a table of StressSlots counters guarded by an
+//      RWLock.  Writers bump every counter, yielding in between; readers
+//      check, also yielding, that all the counters agree.  Some readers
+//      upgrade and write; some acquires are timed, and may give up.
+//      After each round, everyone meets at a Barrier; main waits on a
+//      Latch for all of them to finish.  Prints a "BENCH" line, then the
+//      contention counters.
+//----------------------------------------------------------------------
+
+#define StressThreads	16
+#define StressRounds	10
+#define StressSlots	8
+#define StressTimeout	200		// ticks, for the timed acquires
+
+static RWLock *stressLock;
+static Barrier *stressBarrier;
+static Latch *stressDone;
+static int stressTable[StressSlots];
+static int stressErrors, stressOps;
+
+static void
+StressRead()
+{
+    for (int i = 1; i < StressSlots; i++) {
+	if (stressTable[i] != stressTable[0])
+	    stressErrors++;
+	if (i % 2 == 0)
+	    currentThread->Yield();
+    }
+}
+
+static void
+StressWrite()
+{
+    for (int i = 0; i < StressSlots; i++) {
+	stressTable[i]++;
+	if (i % 2 == 0)
+	    currentThread->Yield();
+    }
+}
+
+static void
+StressThread(_int which)
+{
+    for (int round = 0; round < StressRounds; round++) {
+	switch (Random() % 8) {
+	  case 0:				// write
+	    stressLock->WriteAcquire();
+	    StressWrite();
+	    stressLock->WriteRelease();
+	    break;
+	  case 1:				// read, then write
+	    stressLock->ReadAcquire();
+	    StressRead();
+	    if (stressLock->Upgrade()) {
+		StressWrite();
+		stressLock->WriteRelease();
+	    } else
+		stressLock->ReadRelease();
+	    break;
+	  case 2:				// write, then read
+	    if (stressLock->WriteAcquire(StressTimeout)) {
+		StressWrite();
+		stressLock->Downgrade();
+		StressRead();
+		stressLock->ReadRelease();
+	    }
+	    break;
+	  case 3:				// impatient read
+	    if (stressLock->ReadAcquire(StressTimeout)) {
+		StressRead();
+		stressLock->ReadRelease();
+	    }
+	    break;
+	  default:				// read
+	    stressLock->ReadAcquire();
+	    StressRead();
+	    stressLock->ReadRelease();
+	    break;
+	}
+	stressOps++;
+	stressBarrier->Wait();
+    }
+    stressDone->CountDown();
+}
+
+void
+SynchStress()
+{
+    int startTicks = stats->totalTicks;
+    double startWall = WallClock();
+
+    stressLock = new RWLock("stress table");
+    stressBarrier = new Barrier("stress round", StressThreads);
+    stressDone = new Latch("stress done", StressThreads);
+    stressErrors = stressOps = 0;
+    for (int i = 0; i < StressThreads; i++)
+	(new Thread("stress"))->Fork(StressThread, i);
+    stressDone->Wait();
+
+    printf("BENCH workload=rwstress threads=%d ops=%d errors=%d ticks=%d "
+	"wall_us=%d\n", StressThreads, stressOps, stressErrors,
+	stats->totalTicks - startTicks, (int) (WallClock() - startWall));
+    stressLock->PrintStats();
+    stressBarrier->PrintStats();
+    stressDone->PrintStats();
+    delete stressLock;
+    delete stressBarrier;
+    delete stressDone;
+}
@@ -143,3 +143,48 @@ SynchTest()
 	ts[i]->Fork(SynchThread, i);
     }
 }
+
+//----------------------------------------------------------------------
+// SynchBenchmark
+//      Fork SemBenchThreads threads that all take turns on one
+//      semaphore, SemBenchRounds times each.  Each thread yields while
+//      it holds the semaphore, so nearly everyone else piles up waiting
+//      in P(), and every V() has to pick the next thread out of a long
+//      queue.  Prints one "BENCH" line, like the file system benchmark.
+//----------------------------------------------------------------------
+
+#define SemBenchThreads	400
+#define SemBenchRounds	8
+
+static Semaphore *benchMutex;		// the semaphore everyone fights over
+static Semaphore *benchDone;		// V'ed by each thread when done
+
+static void
+SemContender(_int which)
+{
+    for (int i = 0; i < SemBenchRounds; i++) {
+	benchMutex->P();
+	currentThread->Yield();		// let the others queue up
+	benchMutex->V();
+    }
+    benchDone->V();
+}
+
+void
+SynchBenchmark()
+{
+    int i, startTicks = stats->totalTicks;
+    double startWall = WallClock();
+
+    benchMutex = new Semaphore("bench mutex", 1);
+    benchDone = new Semaphore("bench done", 0);
+    for (i = 0; i < SemBenchThreads; i++)
+	(new Thread("contender"))->Fork(SemContender, i);
+    for (i = 0; i < SemBenchThreads; i++)
+	benchDone->P();
+    printf("BENCH workload=semaphore threads=%d ops=%d ticks=%d wall_us=%d\n",
+	SemBenchThreads, SemBenchThreads * SemBenchRounds,
+	stats->totalTicks - startTicks, (int) (WallClock() - startWall));
+    delete benchMutex;
+    delete benchDone;
+}
@@ -7,6 +7,7 @@
 
 #include "copyright.h"
 #include "system.h"
+#include "config.h"
 
 // This defines *all* of the global data structures used by Nachos.
 // These are all initialized and de-allocated by this file.
@@ -18,6 +19,9 @@ Interrupt *interrupt;			// interrupt status
 Statistics *stats;			// performance metrics
 Timer *timer;				// the hardware timer device,
 					// for invoking context switches
+SchedTrace *schedTrace;			// scheduler trace, NULL unless
+					// asked for with -trace
+Alarm *alarmClock;			// threads sleeping for a while
 
 
 
@@ -43,6 +47,10 @@ Machine *machine;	// user program memory and registers
 */
 BitMap* GlobalFreeMap;//全局空闲块管理
 BitMap* GlobalSpaceId;//管理全局空间标识
+FrameTable *frameTable;
+TextCache *textCache;
+ImageCache *imageCache;
+SwapArea *swapArea;
 int gh;
 #endif
 
@@ -69,14 +77,25 @@ extern void Cleanup();
 //	if the interrupted thread called Yield at the point it is 
 //	was interrupted.
 //
+//	Any thread whose sleep is over is woken up first, so that it
+//	can be chosen to run next.
+//
+//	The interrupt only goes to one processor, so the others (if there
+//	are others) are asked to yield as well.
+//
 //	"dummy" is because every interrupt handler takes one argument,
 //		whether it needs it or not.
 //----------------------------------------------------------------------
 static void
 TimerInterruptHandler(_int dummy)
 {
+#ifdef USER_PROGRAM
+    frameTable->TimerTick();		// sample the use bits
+#endif
+    alarmClock->Tick();
     if (interrupt->getStatus() != IdleMode)
 	interrupt->YieldOnReturn();
+    scheduler->PreemptOthers();
 }
 
 //----------------------------------------------------------------------
@@ -95,6 +114,8 @@ Initialize(int argc, char **argv)
     int argCount;
     char* debugArgs = "";
     bool randomYield = FALSE;
+    char *traceFile = NULL;
+    SchedPolicy policy = PriorityPolicy;
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
@@ -123,6 +144,28 @@ Initialize(int argc, char **argv)
 						// number generator
 	    randomYield = TRUE;
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-sched")) {
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "lottery"))
+		policy = LotteryPolicy;
+	    else if (!strcmp(*(argv + 1), "stride"))
+		policy = StridePolicy;
+	    else if (strcmp(*(argv + 1), "priority"))
+		printf("Unknown scheduling policy %s, using priority\n",
+		    *(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-trace")) {
+	    ASSERT(argc > 1);
+	    traceFile = *(argv + 1);		// trace the scheduler
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-geom")) {
+	    ASSERT(argc > 1);
+	    ReadMachineConfig(*(argv + 1));	// cf. machine/config.h
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-set")) {
+	    ASSERT(argc > 1);
+	    SetMachineParameter(*(argv + 1));	// "name=value"
+	    argCount = 2;
 	}
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))   //running user program step by step
@@ -149,10 +192,18 @@ Initialize(int argc, char **argv)
 #endif
     }
 
+    if (!CheckMachineConfig()) {		// cf. machine/config.h
+	printf("Bad machine geometry, giving up\n");
+	Exit(1);
+    }
+
     DebugInit(debugArgs);			// initialize DEBUG messages
     stats = new Statistics();			// collect statistics
+    if (traceFile != NULL)
+	schedTrace = new SchedTrace(traceFile);
     interrupt = new Interrupt;			// start up interrupt handling
-    scheduler = new Scheduler();		// initialize the ready queue
+    scheduler = new Scheduler(policy);		// initialize the ready queue
+    alarmClock = new Alarm();			// nobody asleep yet
     if (randomYield)				// start the timer (if needed)
 	timer = new Timer(TimerInterruptHandler, 0, randomYield);
 
@@ -171,6 +222,11 @@ Initialize(int argc, char **argv)
     machine = new Machine(debugUserProg);	// this must come first
     GlobalFreeMap = new BitMap(NumPhysPages);//全局空闲块管理
     GlobalSpaceId = new BitMap(NumPhysPages);//管理全局空间标识
+    frameTable = new FrameTable(NumPhysPages);
+    textCache = new TextCache;
+    imageCache = new ImageCache;
+    swapArea = new SwapArea("SWAP");
+    alarmClock->StartTimer();			// to sample the use bits
     gh=1000;
 #endif
 
@@ -200,6 +256,10 @@ Cleanup()
 #endif
     
 #ifdef USER_PROGRAM
+    delete swapArea;
+    delete imageCache;
+    delete textCache;
+    delete frameTable;
     delete machine;
 #endif
 
@@ -211,7 +271,9 @@ Cleanup()
     delete synchDisk;
 #endif
     
+    delete schedTrace;				// writes out the trace
     delete timer;
+    delete alarmClock;
     delete scheduler;
     delete interrupt;
     
@@ -15,6 +15,8 @@
 #include "interrupt.h"
 #include "stats.h"
 #include "timer.h"
+#include "trace.h"
+#include "alarm.h"
 
 /*新建头文件*/
 //#include"bitmap.h"
@@ -43,6 +45,8 @@ extern Scheduler *scheduler;			// the ready list
 extern Interrupt *interrupt;			// interrupt status
 extern Statistics *stats;			// performance metrics
 extern Timer *timer;				// the hardware alarm clock
+extern SchedTrace *schedTrace;			// scheduler trace, if any
+extern Alarm *alarmClock;			// sleeping threads
 
 
 /*#ifndef USER_PROGRAMs
@@ -58,6 +62,14 @@ extern BitMap* GlobalSpaceId;;//管理全局空间标识
 extern Machine* machine;	// user program memory and registers
 extern BitMap* GlobalFreeMap;;//全局空闲块管理
 extern BitMap* GlobalSpaceId;;//管理全局空间标识
+#include "frametable.h"
+#include "textcache.h"
+#include "imagecache.h"
+#include "swap.h"
+extern FrameTable *frameTable;	// reference counts of the frames
+extern TextCache *textCache;	// code pages shared between processes
+extern ImageCache *imageCache;	// recently run executables, for Exec
+extern SwapArea *swapArea;	// where pages go when memory is full
 extern int gh;
 #endif
 
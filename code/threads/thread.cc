@@ -30,6 +30,7 @@
 //	Thread::Fork.
 //
 //	"threadName" is an arbitrary string, useful for debugging.
+//	"newpriority" is how urgent the thread is (cf. thread.h).
 //----------------------------------------------------------------------
 
 /*Thread::Thread(char* threadName)
@@ -47,7 +48,7 @@ Thread::Thread(char* threadName,int newpriority)
 {
 
     name = threadName;
-    //priority=newpriority;
+    priority = effectivePriority = newpriority;
     stackTop = NULL;
     stack = NULL;
     status = JUST_CREATED;
@@ -73,7 +74,7 @@ Thread::~Thread()
 
     ASSERT(this != currentThread);
     if (stack != NULL)
-		DeallocBoundedArray((char *) stack, StackSize * sizeof(_int));
+		FreeThreadStack((char *) stack);
 }
 
 //----------------------------------------------------------------------
@@ -203,9 +204,12 @@ Thread::Finish ()
 //	If so, put the thread on the end of the ready list, so that
 //	it will eventually be re-scheduled.
 //
-//	NOTE: returns immediately if no other thread on the ready queue.
-//	Otherwise returns when the thread eventually works its way
-//	to the front of the ready list and gets re-scheduled.
+//	NOTE: returns immediately if no other thread on the ready queue
+//	is at least as urgent as this one.  Otherwise returns when the
+//	thread eventually works its way to the front of the ready list
+//	and gets re-scheduled.  Under the lottery and stride schedulers,
+//	this thread goes back on the ready list and takes its chances
+//	with the others, so it may be picked again straight away.
 //
 //	NOTE: we disable interrupts, so that looking at the thread
 //	on the front of the ready list, and switching to it, can be done
@@ -225,10 +229,19 @@ Thread::Yield ()
     
     DEBUG('t', "Yielding thread \"%s\"\n", getName());
     
-    nextThread = scheduler->FindNextToRun();
-    if (nextThread != NULL) {
+    if (scheduler->IsProportional()) {	// we are in the draw too
 	scheduler->ReadyToRun(this);
-	scheduler->Run(nextThread);
+	nextThread = scheduler->FindNextToRun();
+	if (nextThread != this)
+	    scheduler->Run(nextThread);
+	else
+	    setStatus(RUNNING);
+    } else {
+	nextThread = scheduler->FindNextToRun(effectivePriority);
+	if (nextThread != NULL) {
+	    scheduler->ReadyToRun(this);
+	    scheduler->Run(nextThread);
+	}
     }
     (void) interrupt->SetLevel(oldLevel);
 }
@@ -241,10 +254,11 @@ Thread::Yield ()
 //	back on the ready queue, so that it can be re-scheduled.
 //
 //	NOTE: if there are no threads on the ready queue, that means
-//	we have no thread to run.  "Interrupt::Idle" is called
+//	we have no thread to run.  If another processor is busy, we go on
+//	with it; otherwise "Interrupt::Idle" is called
 //	to signify that we should idle the CPU until the next I/O interrupt
 //	occurs (the only thing that could cause a thread to become
-//	ready to run).
+//	ready to run).  Cf. Scheduler::Relinquish.
 //
 //	NOTE: we assume interrupts are already disabled, because it
 //	is called from the synchronization routines which must
@@ -255,8 +269,6 @@ Thread::Yield ()
 void
 Thread::Sleep ()
 {
-    Thread *nextThread;
-    
     ASSERT(this == currentThread);
     ASSERT(interrupt->getLevel() == IntOff);
     
@@ -266,10 +278,60 @@ Thread::Sleep ()
     #ifdef USER_PROGRAM
     //scheduler->putinwaitting(this);
     #endif
-    while ((nextThread = scheduler->FindNextToRun()) == NULL)
-	interrupt->Idle();	// no one to run, wait for an interrupt
-        
-    scheduler->Run(nextThread); // returns when we've been signalled
+    scheduler->Relinquish();	// returns when we've been signalled
+}
+
+//----------------------------------------------------------------------
+// Thread::setPriority
+// 	Change how urgent this thread is.  Any priority donated to it
+//	through the Locks it holds still applies.
+//----------------------------------------------------------------------
+
+void
+Thread::setPriority(int newPriority)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(newPriority >= MaxPriority && newPriority <= MinPriority);
+    priority = newPriority;
+    RecomputePriority();
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Thread::RecomputePriority
+// 	Work out the priority this thread should run at: its own, or
+//	that of the most urgent thread waiting for a Lock it holds,
+//	whichever is more urgent.
+//
+//	If that changes, the thread is moved to its new place in whatever
+//	queue it is on, and if it is itself blocked on a Lock, the holder
+//	of that Lock is recomputed in turn -- so priority flows down a
+//	chain of nested Locks, and flows back once the Locks are released.
+//
+//	Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+void
+Thread::RecomputePriority()
+{
+    int newPriority = priority;
+    Lock *held;
+
+    for (held = locksHeld; held != NULL; held = held->getNextHeld())
+	newPriority = min(newPriority, held->getWaiterPriority());
+    if (newPriority == effectivePriority)
+	return;
+
+    DEBUG('t', "Thread \"%s\" priority %d -> %d\n", name,
+	effectivePriority, newPriority);
+    effectivePriority = newPriority;
+    if (status == READY)
+	scheduler->Reprioritize(this);
+    else if (waitQueue != NULL)
+	waitQueue->Update(this, effectivePriority);
+    if (waitingFor != NULL && waitingFor->getOwner() != NULL)
+	waitingFor->getOwner()->RecomputePriority();
 }
 
 //----------------------------------------------------------------------
@@ -300,7 +362,7 @@ void ThreadPrint(_int arg){ Thread *t = (Thread *)arg; t->Print(); }
 void
 Thread::StackAllocate (VoidFunctionPtr func, _int arg)
 {
-    stack = (int *) AllocBoundedArray(StackSize * sizeof(_int));
+    stack = (int *) AllocThreadStack();
 
 #ifdef HOST_SNAKE
     // HP stack works from low addresses to high addresses
@@ -483,12 +545,7 @@ void Thread::Terminated(){
     ASSERT(interrupt->getLevel()==IntOff);
     this->status=TERMINATED;
     terminal->Append((void*)this);
-    Thread*nextrun=scheduler->FindNextToRun();
-    while(nextrun==NULL){
-        interrupt->Idle();
-        nextrun=scheduler->FindNextToRun();
-    }
-    scheduler->Run(nextrun);
+    scheduler->Relinquish();
 }
 
 #endif
\ No newline at end of file
@@ -57,12 +57,28 @@
 #define StackSize	(sizeof(_int) * 1024)	// in words
 
 
+// Thread priorities.  A smaller number is more urgent: the ready list
+// and the wait queues of Semaphore, Lock and Condition hand out the
+// CPU (or the resource) in priority order, first come first served
+// among equals.
+#define MaxPriority	0	// most urgent
+#define KernelPriority	10	// latency-sensitive kernel threads
+#define DefaultPriority	50
+#define MinPriority	99	// least urgent
+
 // Thread state
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED,TERMINATED };
 
 // external function, dummy routine whose sole job is to call Thread::Print
 extern void ThreadPrint(_int arg);	 
 
+// Thread stacks are recycled rather than freed (cf. threadpool.cc)
+extern char *AllocThreadStack();
+extern void FreeThreadStack(char *stack);
+
+class Lock;
+class Heap;
+
 // The following class defines a "thread control block" -- which
 // represents a single thread of execution.
 //
@@ -80,19 +96,38 @@ class Thread {
     // THEY MUST be in this position for SWITCH to work.
     int* stackTop;			 // the current stack pointer
     _int machineState[MachineStateSize];  // all registers except for stackTop
-    int priority;
+    int priority;			// priority the thread asked for
+    int effectivePriority;		// priority it runs at, which may be
+					// better if it holds a Lock that a
+					// more urgent thread is waiting for
 
   public:
     int times=0;
-    Thread(char* debugName,int cur_priority=0);	
+    Lock *waitingFor=NULL;		// Lock we are blocked on, if any
+    Lock *locksHeld=NULL;		// Locks we hold, linked through
+					// Lock::nextHeld
+    Heap *waitQueue=NULL;		// queue we are asleep on, if any
+    int traceId=0;			// our number in the scheduler trace,
+					// 0 until we show up in it
+    int tickets=0;			// our share of the CPU, under the
+					// lottery and stride schedulers
+    int pass=0;				// stride scheduler's virtual time
+    int cpu=0;				// processor we run on, or whose
+					// ready list we are on
+    Thread(char* debugName,int cur_priority=DefaultPriority);	
     //Thread(char* debugName);		// initialize a Thread 
     ~Thread(); 				// deallocate a Thread
 					// NOTE -- thread being deleted
 					// must not be running when delete 
 					// is called
+    static void *operator new(size_t size);	// recycle Thread objects
+    static void operator delete(void *ptr);	// (cf. threadpool.cc)
     int get_this_priority(){
       return priority;
     }
+    int getPriority() { return effectivePriority; }
+    void setPriority(int newPriority);		// change our own priority
+    void RecomputePriority();			// re-collect donations
     // basic thread operations
     //void my_Fork(my_VoidFunctionPtr func, _int arg); 
     void Fork(VoidFunctionPtr func, _int arg); 	// Make thread run (*func)(arg)
@@ -105,6 +140,7 @@ class Thread {
     void CheckOverflow();   			// Check if thread has 
 						// overflowed its stack
     void setStatus(ThreadStatus st) { status = st; }
+    ThreadStatus getStatus() { return status; }
     char* getName() { return (name); }
     void Print() { printf("%s, ", name); }
 
@@ -138,6 +174,7 @@ class Thread {
     int waitExitCode() { return waitProcessExitCode; }
     int setWaitExitCode(int tmpCode) { waitProcessExitCode = tmpCode; }
     int setWaitSpaceId(int tmpCode) { waitProcessSpaceId = tmpCode; }
+    int waitSpaceId() { return waitProcessSpaceId; }
     int setExitCode(int tmpCode) { exitCode = tmpCode; }
     AddrSpace *space;			// User code this thread is running.
 #endif
@@ -0,0 +1,119 @@
+// threadpool.cc
+//	Recycling of thread execution stacks and thread control blocks.
+//
+//	Allocating a stack with AllocBoundedArray costs a trip through
+//	the host's allocator, plus two mprotect system calls to set up
+//	the guard pages around it; freeing it costs two more.  Programs
+//	that fork and finish lots of short-lived threads pay that every
+//	time.  So instead of freeing a dead thread's stack, we keep it
+//	(guard pages and all) for the next thread to be forked, and do the
+//	same with the Thread objects themselves.
+//
+//	Each pool is capped, so that a burst of threads doesn't keep its
+//	memory tied up forever: beyond the cap, we free as before.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "thread.h"
+#include "system.h"
+
+#define MaxPooledStacks		64
+#define MaxPooledThreads	64
+
+#define StackBytes	(StackSize * sizeof(_int))
+
+static char *freeStacks[MaxPooledStacks];	// stacks ready for reuse
+static int numFreeStacks = 0;
+
+// Free Thread objects are chained through their first word.
+static void *freeThreads = NULL;
+static int numFreeThreads = 0;
+
+//----------------------------------------------------------------------
+// AllocThreadStack
+// 	Return a thread execution stack of StackSize words, with guard
+//	pages on either side: a recycled one if we have one, otherwise
+//	a fresh one from AllocBoundedArray.
+//----------------------------------------------------------------------
+
+char *
+AllocThreadStack()
+{
+    char *stack = NULL;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (numFreeStacks > 0)
+	stack = freeStacks[--numFreeStacks];
+    (void) interrupt->SetLevel(oldLevel);
+
+    if (stack == NULL)
+	stack = AllocBoundedArray(StackBytes);
+    return stack;
+}
+
+//----------------------------------------------------------------------
+// FreeThreadStack
+// 	Give back a stack from AllocThreadStack, keeping it for the next
+//	thread if the pool has room.
+//----------------------------------------------------------------------
+
+void
+FreeThreadStack(char *stack)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (numFreeStacks < MaxPooledStacks) {
+	freeStacks[numFreeStacks++] = stack;
+	stack = NULL;
+    }
+    (void) interrupt->SetLevel(oldLevel);
+
+    if (stack != NULL)
+	DeallocBoundedArray(stack, StackBytes);
+}
+
+//----------------------------------------------------------------------
+// Thread::operator new, Thread::operator delete
+// 	Allocate and free the storage for Thread objects, from a free
+//	list of dead ones when possible.  The constructor and destructor
+//	still run as usual.
+//----------------------------------------------------------------------
+
+void *
+Thread::operator new(size_t size)
+{
+    void *ptr = NULL;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(size == sizeof(Thread));
+    if (freeThreads != NULL) {
+	ptr = freeThreads;
+	freeThreads = *(void **) ptr;
+	numFreeThreads--;
+    }
+    (void) interrupt->SetLevel(oldLevel);
+
+    if (ptr == NULL)
+	ptr = ::operator new(size);
+    return ptr;
+}
+
+void
+Thread::operator delete(void *ptr)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (numFreeThreads < MaxPooledThreads) {
+	*(void **) ptr = freeThreads;
+	freeThreads = ptr;
+	numFreeThreads++;
+	ptr = NULL;
+    }
+    (void) interrupt->SetLevel(oldLevel);
+
+    if (ptr != NULL)
+	::operator delete(ptr);
+}
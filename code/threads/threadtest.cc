@@ -11,6 +11,7 @@
 
 #include "copyright.h"
 #include "system.h"
+#include "synch.h"
 
 //----------------------------------------------------------------------
 // SimpleThread
@@ -51,3 +52,214 @@ ThreadTest()
     SimpleThread(0);
 }
 
+
+//----------------------------------------------------------------------
+// PriorityTest
+// 	Show priority donation through a Lock.  A low-priority thread
+//	takes the lock; then a high-priority thread wants it, while
+//	medium-priority threads would keep the CPU busy.  The low thread
+//	should borrow the high priority, get out of the lock, and let the
+//	high thread finish before any of the medium ones run.
+//----------------------------------------------------------------------
+
+#define NumMediumThreads	3
+
+static Lock *priorityLock;
+static Semaphore *priorityDone;
+
+static void
+LowThread(_int arg)
+{
+    priorityLock->Acquire();
+    ((Semaphore *) arg)->V();		// tell main we have the lock
+    for (int i = 0; i < 3; i++) {
+	printf("*** low thread in lock, running at priority %d\n",
+	    currentThread->getPriority());
+	currentThread->Yield();
+    }
+    priorityLock->Release();
+    printf("*** low thread released lock, back to priority %d\n",
+	currentThread->getPriority());
+    priorityDone->V();
+}
+
+static void
+MediumThread(_int which)
+{
+    for (int i = 0; i < 3; i++) {
+	printf("*** medium thread %d looped %d times\n", (int) which, i);
+	currentThread->Yield();
+    }
+    priorityDone->V();
+}
+
+static void
+HighThread(_int arg)
+{
+    printf("*** high thread wants the lock\n");
+    priorityLock->Acquire();
+    printf("*** high thread got the lock\n");
+    priorityLock->Release();
+    priorityDone->V();
+}
+
+void
+PriorityTest()
+{
+    Semaphore *haveLock = new Semaphore("low has lock", 0);
+    int i;
+
+    DEBUG('t', "Entering PriorityTest");
+    priorityLock = new Lock("priority lock");
+    priorityDone = new Semaphore("priority done", 0);
+
+    (new Thread("low", DefaultPriority + 10))->Fork(LowThread,
+	(_int) haveLock);
+    haveLock->P();
+    for (i = 0; i < NumMediumThreads; i++)
+	(new Thread("medium", DefaultPriority - 10))->Fork(MediumThread, i);
+    (new Thread("high", DefaultPriority - 30))->Fork(HighThread, 0);
+
+    for (i = 0; i < NumMediumThreads + 2; i++)
+	priorityDone->P();
+    delete haveLock;
+    delete priorityLock;
+    delete priorityDone;
+}
+
+//----------------------------------------------------------------------
+// ForkBenchmark
+// 	Fork and finish ForkBenchThreads threads that do nothing, at most
+//	ForkBenchBatch of them alive at a time, and report how many we got
+//	through per second of host time.  This is almost all Thread::Fork,
+//	Thread::Finish and the context switches in between.
+//----------------------------------------------------------------------
+
+#define ForkBenchThreads	10000
+#define ForkBenchBatch		32
+
+static Semaphore *forkBenchDone;
+
+static void
+EmptyThread(_int which)
+{
+    forkBenchDone->V();
+}
+
+void
+ForkBenchmark()
+{
+    int i, j, startTicks = stats->totalTicks;
+    double startWall = WallClock(), elapsed;
+
+    forkBenchDone = new Semaphore("fork bench", 0);
+    for (i = 0; i < ForkBenchThreads; i += ForkBenchBatch) {
+	for (j = 0; j < ForkBenchBatch; j++)
+	    (new Thread("empty"))->Fork(EmptyThread, i + j);
+	for (j = 0; j < ForkBenchBatch; j++)
+	    forkBenchDone->P();
+    }
+    elapsed = WallClock() - startWall;
+    printf("BENCH workload=forkfinish threads=%d ticks=%d wall_us=%d "
+	"threads_per_sec=%d\n", i, stats->totalTicks - startTicks,
+	(int) elapsed, (int) (i * 1000000.0 / (elapsed > 0 ? elapsed : 1)));
+    delete forkBenchDone;
+}
+
+//----------------------------------------------------------------------
+// AlarmTest
+// 	Put AlarmTestThreads threads to sleep for different lengths of
+//	time, from a few ticks to long enough to need every level of the
+//	alarm clock's wheel, and check that none of them wakes up before
+//	its time, or more than a couple of timer interrupts after it.
+//----------------------------------------------------------------------
+
+#define AlarmTestThreads	1000
+#define AlarmTestMaxSleep	(AlarmSlots * AlarmSlots * AlarmSlots * TimerTicks)
+
+static Semaphore *alarmDone;
+static int alarmEarly, alarmLate;
+
+static void
+Sleeper(_int howLong)
+{
+    int deadline = stats->totalTicks + howLong;
+
+    alarmClock->WaitUntil(howLong);
+    if (stats->totalTicks < deadline)
+	alarmEarly++;
+    else if (stats->totalTicks > deadline + 2 * TimerTicks)
+	alarmLate++;
+    alarmDone->V();
+}
+
+void
+AlarmTest()
+{
+    int i, howLong, startTicks = stats->totalTicks;
+    double startWall = WallClock();
+
+    alarmDone = new Semaphore("alarm test", 0);
+    alarmEarly = alarmLate = 0;
+    for (i = 0; i < AlarmTestThreads; i++) {
+	if (i % 10 == 0)		// a few that go to the top levels
+	    howLong = 1 + Random() % AlarmTestMaxSleep;
+	else
+	    howLong = 1 + Random() % (AlarmSlots * TimerTicks * 4);
+	(new Thread("sleeper"))->Fork(Sleeper, howLong);
+    }
+    for (i = 0; i < AlarmTestThreads; i++)
+	alarmDone->P();
+    printf("BENCH workload=alarm threads=%d early=%d late=%d ticks=%d "
+	"wall_us=%d\n", AlarmTestThreads, alarmEarly, alarmLate,
+	stats->totalTicks - startTicks, (int) (WallClock() - startWall));
+    delete alarmDone;
+}
+
+//----------------------------------------------------------------------
+// ShareTest
+// 	Run ShareThreads threads that do nothing but count and yield,
+//	at priorities MinPriority, MinPriority - 1, ..., until they have
+//	had ShareRounds turns between them, and print each thread's share
+//	of the turns.  Under "-sched lottery" or "-sched stride" the
+//	shares should come out close to 1 : 2 : 3 ... (cf. TicketsFor);
+//	under the priority scheduler the most urgent one takes them all.
+//----------------------------------------------------------------------
+
+#define ShareThreads	3
+#define ShareRounds	6000
+
+static int shareTurns[ShareThreads];
+static int shareTotal;
+static Semaphore *shareDone;
+
+static void
+ShareThread(_int which)
+{
+    while (shareTotal < ShareRounds) {
+	shareTurns[which]++;
+	shareTotal++;
+	currentThread->Yield();
+    }
+    shareDone->V();
+}
+
+void
+ShareTest()
+{
+    int i;
+
+    shareDone = new Semaphore("share test", 0);
+    shareTotal = 0;
+    for (i = 0; i < ShareThreads; i++) {
+	shareTurns[i] = 0;
+	(new Thread("share", MinPriority - i))->Fork(ShareThread, i);
+    }
+    for (i = 0; i < ShareThreads; i++)
+	shareDone->P();
+    for (i = 0; i < ShareThreads; i++)
+	printf("*** thread at priority %d, %d tickets: %d of %d turns\n",
+	    MinPriority - i, TicketsFor(MinPriority - i), shareTurns[i],
+	    shareTotal);
+    delete shareDone;
+}
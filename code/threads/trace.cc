@@ -0,0 +1,242 @@
+// trace.cc
+//	Routines to record scheduler events in a ring buffer, and to
+//	write them out as Chrome trace-event JSON.
+//
+//	In the JSON file, simulated ticks are shown as microseconds.
+//	Each Nachos thread is a track: a "running" slice for each time it
+//	had the CPU (labelled with why it gave it up), and a "ready"
+//	slice for each time it waited on the ready list.  Interrupts are
+//	instant events on a track of their own.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "trace.h"
+#include "system.h"
+
+#define TraceMask	(TraceRecords - 1)
+#define InterruptTrack	0		// track for interrupts, in the JSON
+
+static char *reasonNames[] = { "yield", "sleep", "finish", "preempt" };
+static char *intNames[] = { "timer", "disk", "console write",
+			"console read", "network send", "network recv",
+			"timeout" };
+
+//----------------------------------------------------------------------
+// SchedTrace::SchedTrace
+//	Start tracing, with an empty buffer.
+//
+//	"fileName" is the host file to write the trace into, when Nachos
+//	shuts down.
+//----------------------------------------------------------------------
+
+SchedTrace::SchedTrace(char *traceFileName)
+{
+    records = new TraceRecord[TraceRecords];
+    next = 0;
+    maxNames = 64;
+    names = new char *[maxNames];
+    numNames = 0;
+    preempting = FALSE;
+    fileName = traceFileName;
+}
+
+//----------------------------------------------------------------------
+// SchedTrace::~SchedTrace
+//	Write out the trace, and de-allocate the buffer.
+//----------------------------------------------------------------------
+
+SchedTrace::~SchedTrace()
+{
+    if (!Export())
+	printf("Unable to write the scheduler trace to %s\n", fileName);
+    for (int i = 0; i < numNames; i++)
+	delete [] names[i];
+    delete [] names;
+    delete [] records;
+}
+
+//----------------------------------------------------------------------
+// SchedTrace::NewRecord
+//	Return the next slot in the ring, stamped with the time and the
+//	type of event.  Once the ring is full, this is the oldest record.
+//----------------------------------------------------------------------
+
+TraceRecord *
+SchedTrace::NewRecord(int type)
+{
+    TraceRecord *rec = &records[next++ & TraceMask];
+
+    rec->when = stats->totalTicks;
+    rec->type = type;
+    return rec;
+}
+
+//----------------------------------------------------------------------
+// SchedTrace::Id
+//	Return the trace id of "thread", giving it one (and keeping a
+//	copy of its name) the first time we see it.  Ids start at 1.
+//----------------------------------------------------------------------
+
+int
+SchedTrace::Id(Thread *thread)
+{
+    char **bigger;
+    char *name;
+
+    if (thread->traceId != 0)
+	return thread->traceId;
+    if (numNames == maxNames) {
+	bigger = new char *[2 * maxNames];
+	for (int i = 0; i < numNames; i++)
+	    bigger[i] = names[i];
+	delete [] names;
+	names = bigger;
+	maxNames *= 2;
+    }
+    name = thread->getName() != NULL ? thread->getName() : (char *) "?";
+    names[numNames] = new char[strlen(name) + 1];
+    strcpy(names[numNames], name);
+    thread->traceId = ++numNames;
+    return thread->traceId;
+}
+
+//----------------------------------------------------------------------
+// SchedTrace::Switch
+//	Record that Scheduler::Run is about to switch from "oldThread"
+//	to "nextThread".  Why the old thread stopped follows from the
+//	state it has been left in.
+//----------------------------------------------------------------------
+
+void
+SchedTrace::Switch(Thread *oldThread, Thread *nextThread)
+{
+    TraceRecord *rec = NewRecord(TraceSwitch);
+
+    if (oldThread == threadToBeDestroyed)
+	rec->reason = TraceFinish;
+    else if (oldThread->getStatus() != READY)
+	rec->reason = TraceSleep;
+    else if (preempting)
+	rec->reason = TracePreempt;
+    else
+	rec->reason = TraceYield;
+    rec->from = Id(oldThread);
+    rec->to = Id(nextThread);
+    preempting = FALSE;
+}
+
+//----------------------------------------------------------------------
+// SchedTrace::Ready, SchedTrace::InterruptCalled
+//	Record a thread going onto the ready list, and an interrupt
+//	handler being called.
+//----------------------------------------------------------------------
+
+void
+SchedTrace::Ready(Thread *thread)
+{
+    TraceRecord *rec = NewRecord(TraceReady);
+
+    rec->to = Id(thread);
+}
+
+void
+SchedTrace::InterruptCalled(int type)
+{
+    TraceRecord *rec = NewRecord(TraceInterrupt);
+
+    rec->from = type;
+}
+
+//----------------------------------------------------------------------
+// PrintName
+//	Write a thread name as a JSON string.
+//----------------------------------------------------------------------
+
+static void
+PrintName(FILE *fp, char *name)
+{
+    fputc('"', fp);
+    for (; *name != '\0'; name++) {
+	if (*name == '"' || *name == '\\')
+	    fputc('\\', fp);
+	if ((unsigned char) *name >= ' ')
+	    fputc(*name, fp);
+    }
+    fputc('"', fp);
+}
+
+//----------------------------------------------------------------------
+// SchedTrace::Export
+//	Write the records still in the ring, oldest first, to the trace
+//	file as a Chrome trace-event JSON object.
+//
+//	Returns FALSE if the file could not be written.
+//----------------------------------------------------------------------
+
+bool
+SchedTrace::Export()
+{
+    unsigned int first = (next > TraceRecords) ? next - TraceRecords : 0;
+    int *readySince = new int[numNames + 1];
+    int running = 0, runStart = 0;
+    TraceRecord *rec;
+    FILE *fp;
+    int i;
+
+    if ((fp = fopen(fileName, "w")) == NULL) {
+	delete [] readySince;
+	return FALSE;
+    }
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+	"\"args\":{\"name\":\"nachos\"}},\n");
+    fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+	"\"tid\":%d,\"args\":{\"name\":\"interrupts\"}}", InterruptTrack);
+    for (i = 1; i <= numNames; i++) {
+	fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+	    "\"tid\":%d,\"args\":{\"name\":", i);
+	PrintName(fp, names[i - 1]);
+	fprintf(fp, "}}");
+	readySince[i] = -1;
+    }
+    if (first < next)
+	runStart = records[first & TraceMask].when;
+
+    for (unsigned int n = first; n < next; n++) {
+	rec = &records[n & TraceMask];
+	switch (rec->type) {
+	  case TraceReady:
+	    readySince[rec->to] = rec->when;
+	    break;
+	  case TraceInterrupt:
+	    fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\","
+		"\"pid\":1,\"tid\":%d,\"ts\":%d}", intNames[(int) rec->from],
+		InterruptTrack, rec->when);
+	    break;
+	  case TraceSwitch:
+	    fprintf(fp, ",\n{\"name\":\"running\",\"ph\":\"X\",\"pid\":1,"
+		"\"tid\":%d,\"ts\":%d,\"dur\":%d,\"args\":{\"until\":\"%s\"}}",
+		rec->from, runStart, rec->when - runStart,
+		reasonNames[(int) rec->reason]);
+	    if (readySince[rec->to] >= 0) {
+		fprintf(fp, ",\n{\"name\":\"ready\",\"ph\":\"X\",\"pid\":1,"
+		    "\"tid\":%d,\"ts\":%d,\"dur\":%d}", rec->to,
+		    readySince[rec->to], rec->when - readySince[rec->to]);
+		readySince[rec->to] = -1;
+	    }
+	    running = rec->to;
+	    runStart = rec->when;
+	    break;
+	}
+    }
+    if (running != 0)			// the thread running at the end
+	fprintf(fp, ",\n{\"name\":\"running\",\"ph\":\"X\",\"pid\":1,"
+	    "\"tid\":%d,\"ts\":%d,\"dur\":%d}", running, runStart,
+	    stats->totalTicks - runStart);
+    fprintf(fp, "\n]}\n");
+    delete [] readySince;
+    return (bool) (fclose(fp) == 0);
+}
@@ -0,0 +1,81 @@
+// trace.h
+//	Data structures for tracing the scheduler.
+//
+//	When Nachos is run with "-trace <file>", every context switch,
+//	every thread put on the ready list and every interrupt that is
+//	handled is written into a ring buffer of fixed-size records,
+//	stamped with the simulated time.  At shutdown the buffer is
+//	written out as Chrome trace-event JSON, which can be loaded
+//	into chrome://tracing or ui.perfetto.dev to see, thread by
+//	thread, when each one ran and how long it waited to.
+//
+//	Once the buffer fills up, the oldest records are overwritten, so
+//	the trace always covers the end of the run.  Without "-trace"
+//	there is no buffer, and the hooks cost one test of a pointer.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "copyright.h"
+#include "utility.h"
+
+class Thread;
+
+#define TraceRecords	(1 << 16)	// records kept; must be a power of 2
+
+// What a record is about
+enum TraceType { TraceSwitch, TraceReady, TraceInterrupt };
+
+// Why the thread that was running gave up the CPU
+enum TraceReason { TraceYield, TraceSleep, TraceFinish, TracePreempt };
+
+// One event.  Threads are named by small numbers, handed out the
+// first time a thread shows up in the trace (cf. Thread::traceId).
+
+class TraceRecord {
+  public:
+    int when;			// stats->totalTicks at the event
+    char type;			// a TraceType
+    char reason;		// a TraceReason, for TraceSwitch
+    short unused;
+    int from;			// TraceSwitch: the thread switched out
+				// TraceInterrupt: the kind of interrupt
+    int to;			// TraceSwitch: the thread switched in
+				// TraceReady: the thread made ready
+};
+
+// The following class defines the trace buffer.
+
+class SchedTrace {
+  public:
+    SchedTrace(char *fileName);	// start tracing; the trace goes into
+				// "fileName" when Nachos stops
+    ~SchedTrace();		// write out the trace
+
+    void Switch(Thread *oldThread, Thread *nextThread);
+				// Scheduler::Run is switching threads
+    void Ready(Thread *thread);	// "thread" went onto the ready list
+    void InterruptCalled(int type);	// an interrupt handler is
+					// being called
+    void Preempting(bool on) { preempting = on; }
+				// the next switch is a time slice
+
+  private:
+    TraceRecord *records;	// the ring buffer
+    unsigned int next;		// records written so far
+    char **names;		// thread names, by trace id
+    int numNames;		// ids handed out so far
+    int maxNames;		// size of "names"
+    bool preempting;		// set while the timer forces a Yield
+    char *fileName;		// where the trace goes
+
+    TraceRecord *NewRecord(int type);	// next slot in the ring
+    int Id(Thread *thread);	// the thread's trace id
+    bool Export();		// write the JSON file
+};
+
+#endif // TRACE_H
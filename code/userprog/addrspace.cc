@@ -21,25 +21,54 @@
 #include "noff.h"
 
 //----------------------------------------------------------------------
-// SwapHeader
-// 	Do little endian to big endian conversion on the bytes in the 
-//	object file header, in case the file was generated on a little
-//	endian machine, and we're now running on a big endian machine.
+// Covers
+// 	Return TRUE if segment "seg" fills all of virtual page "vpn", so
+//	that loading the segment overwrites every byte of the page.
 //----------------------------------------------------------------------
 
-static void 
-SwapHeader (NoffHeader *noffH)
+static bool
+Covers(Segment *seg, int vpn)
 {
-	noffH->noffMagic = WordToHost(noffH->noffMagic);
-	noffH->code.size = WordToHost(noffH->code.size);
-	noffH->code.virtualAddr = WordToHost(noffH->code.virtualAddr);
-	noffH->code.inFileAddr = WordToHost(noffH->code.inFileAddr);
-	noffH->initData.size = WordToHost(noffH->initData.size);
-	noffH->initData.virtualAddr = WordToHost(noffH->initData.virtualAddr);
-	noffH->initData.inFileAddr = WordToHost(noffH->initData.inFileAddr);
-	noffH->uninitData.size = WordToHost(noffH->uninitData.size);
-	noffH->uninitData.virtualAddr = WordToHost(noffH->uninitData.virtualAddr);
-	noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
+    return (bool) (seg->size > 0 && seg->virtualAddr <= vpn * PageSize
+		&& (vpn + 1) * PageSize <= seg->virtualAddr + seg->size);
+}
+
+//----------------------------------------------------------------------
+// SegmentEnd
+// 	Return the virtual address just past segment "seg", or 0 if it
+//	is empty.  coff2noff leaves the addresses of empty segments
+//	uninitialized, so they can't be trusted.
+//----------------------------------------------------------------------
+
+static int
+SegmentEnd(Segment *seg)
+{
+    return (seg->size > 0) ? seg->virtualAddr + seg->size : 0;
+}
+
+//----------------------------------------------------------------------
+// WriteBack, ReleaseMapping
+// 	Write the page in "frame" back to page "vpn" of "mapping" (the
+//	last page of a mapping may be partly past its end); and let go
+//	of a reference to a mapping, deleting it once no one holds one.
+//----------------------------------------------------------------------
+
+static void
+WriteBack(Mapping *mapping, int vpn, int frame)
+{
+    int offset = (vpn - mapping->firstPage) * PageSize;
+
+    mapping->file->WriteAt(&machine->mainMemory[frame * PageSize],
+	min(PageSize, mapping->length - offset), offset);
+}
+
+static void
+ReleaseMapping(Mapping *mapping)
+{
+    if (--mapping->refs == 0) {
+	delete mapping->file;
+	delete mapping;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -58,6 +87,32 @@ SwapHeader (NoffHeader *noffH)
 //----------------------------------------------------------------------
 
 AddrSpace::AddrSpace(OpenFile *executable)
+{
+    ExecImage image(executable);
+
+    ASSERT(image.IsValid());
+    Load(&image);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AddrSpace
+// 	Create an address space to run the program in "image", which
+//	has already been read into memory (cf. imagecache.h).
+//----------------------------------------------------------------------
+
+AddrSpace::AddrSpace(ExecImage *image)
+{
+    Load(image);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Load
+// 	Set up the page table for the program in "image", and copy in
+//	its code and initialized data.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::Load(ExecImage *image)
 {
     int spaceid=GlobalSpaceId->Find();
     ASSERT(spaceid!=-1);
@@ -73,46 +128,97 @@ AddrSpace::AddrSpace(OpenFile *executable)
     filedescriptor[0]=StdoutFile;
     filedescriptor[1]=StdoutFile;
     filedescriptor[2]=StdoutFile;
-    NoffHeader noffH;
+    NoffHeader noffH = image->noffH;
     unsigned int i, size;
-
-    executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
-    if ((noffH.noffMagic != NOFFMAGIC) && 
-		(WordToHost(noffH.noffMagic) == NOFFMAGIC))
-    	SwapHeader(&noffH);
-    ASSERT(noffH.noffMagic == NOFFMAGIC);
+    int firstText, endText, firstZero, *sharedText = NULL;
 
 // how big is address space?
     size = noffH.code.size + noffH.initData.size + noffH.uninitData.size 
 			+ UserStackSize;	// we need to increase the size
 						// to leave room for the stack
     numPages = divRoundUp(size, PageSize);
-    size = numPages * PageSize;
 
-    ASSERT(numPages <= NumPhysPages);		// check we're not trying
+    ASSERT(numPages <= (unsigned) NumPhysPages);	// check we're not trying
 						// to run anything too big --
 						// at least until we have
 						// virtual memory
 
+// the pages above the stack are left free for mapping files (cf. Mmap)
+    mmapBase = numPages;
+    numPages += MmapPages;
+    mappings = NULL;
+    size = numPages * PageSize;
+
     DEBUG('a', "Initializing address space, num pages %d, size %d\n", 
 					numPages, size);
+
+// the pages with nothing but code on them are read-only, and shared with
+// any other process running the same program (cf. textcache.h).  In a 
+// page-aligned executable, the code has pages of its own, up to the
+// end of the last one; otherwise, the last page of code may well start
+// the data too.
+    firstText = divRoundUp(noffH.code.virtualAddr, PageSize);
+    if (image->IsAligned())
+	endText = divRoundUp(SegmentEnd(&noffH.code), PageSize);
+    else
+	endText = SegmentEnd(&noffH.code) / PageSize;
+    if (noffH.initData.size > 0 
+		&& endText > noffH.initData.virtualAddr / PageSize)
+	endText = noffH.initData.virtualAddr / PageSize;
+    if (noffH.uninitData.size > 0 
+		&& endText > noffH.uninitData.virtualAddr / PageSize)
+	endText = noffH.uninitData.virtualAddr / PageSize;
+    if (endText < firstText)
+	endText = firstText;
+#ifdef FILESYS
+    if (endText > firstText)
+	sharedText = textCache->Find(image->sector, firstText, 
+					endText - firstText);
+#endif
+
+// the pages past the code and initialized data (uninitialized data and
+// the stack) are only given a frame, full of zeroes, when they are first
+// touched (cf. PageFault)
+    firstZero = divRoundUp(max(SegmentEnd(&noffH.code), 
+		SegmentEnd(&noffH.initData)), PageSize);
+
 // first, set up the translation 
     pageTable = new TranslationEntry[numPages];
-    ASSERT(GlobalFreeMap->NumClear() >= numPages);
+    copyOnWrite = new bool[numPages];
+    onSwap = new bool[numPages];
     for (i = 0; i < numPages; i++) {
-	pageTable[i].virtualPage = i;	// for now, virtual page # = phys page #
-	pageTable[i].physicalPage =GlobalFreeMap->Find();
-	pageTable[i].valid = TRUE;
+	pageTable[i].virtualPage = i;
+	pageTable[i].valid = (i < (unsigned) firstZero);
 	pageTable[i].use = FALSE;
 	pageTable[i].dirty = FALSE;
-	pageTable[i].readOnly = FALSE;  // if the code segment was entirely on 
-					// a separate page, we could set its 
-					// pages to be read-only
+	pageTable[i].readOnly = (i >= (unsigned) firstText && i < (unsigned) endText);
+	copyOnWrite[i] = FALSE;
+	onSwap[i] = FALSE;
+	if (sharedText != NULL && pageTable[i].readOnly) {
+	    pageTable[i].physicalPage = sharedText[i - firstText];
+	    frameTable->Share(pageTable[i].physicalPage);
+	} else
+	    pageTable[i].physicalPage = -1;
     }
+    size = (sharedText != NULL) ? firstZero - (endText - firstText) : firstZero;
+    textCache->Reclaim(size);
+    if ((swapBase = swapArea->Allocate(mmapBase)) == -1)
+	DEBUG('a', "No room in swap for space %d; it stays in memory\n",
+	    SpaceId);
     
-// zero out the entire address space, to zero the unitialized data segment 
-// and the stack segment
+// zero out the pages that the code and data segments don't fill; the
+// unitialized data segment and the stack segment are zeroed on demand
     //bzero(machine->mainMemory, size);
+    for (i = 0; i < (unsigned) firstZero; i++)
+	if (pageTable[i].physicalPage != -1)
+	    continue;			// shared code
+	else {
+	    if (Covers(&noffH.code, i) || Covers(&noffH.initData, i))
+		pageTable[i].physicalPage = frameTable->Allocate(this, i);
+	    else
+		pageTable[i].physicalPage = frameTable->AllocateZeroed(this, i);
+	    ASSERT(pageTable[i].physicalPage != -1);	// memory is full of
+	}					// pages that can't go to swap
 
 // then, copy in the code and data segments into memory
     if (noffH.code.size > 0) {
@@ -120,40 +226,198 @@ AddrSpace::AddrSpace(OpenFile *executable)
 			noffH.code.virtualAddr, noffH.code.size);
         //executable->ReadAt(&(machine->mainMemory[noffH.code.virtualAddr]),
 		//	noffH.code.size, noffH.code.inFileAddr);
-        int virtualpage=noffH.code.virtualAddr/PageSize;
-        int offset=noffH.code.virtualAddr%PageSize;
-        int physicaladdr=pageTable[virtualpage].physicalPage*PageSize+offset;
-        executable->ReadAt(&(machine->mainMemory[physicaladdr]),
-		noffH.code.size, noffH.code.inFileAddr);
+        if (sharedText != NULL)		// only the pages not shared
+	    LoadSegment(image->contents, noffH.code.virtualAddr, 
+			noffH.code.size, noffH.code.inFileAddr, firstText, endText);
+	else
+	    LoadSegment(image->contents, noffH.code.virtualAddr, 
+			noffH.code.size, noffH.code.inFileAddr, 0, 0);
     }
     if (noffH.initData.size > 0) {
         DEBUG('a', "Initializing data segment, at 0x%x, size %d\n", 
 			noffH.initData.virtualAddr, noffH.initData.size);
         //executable->ReadAt(&(machine->mainMemory[noffH.initData.virtualAddr]),
 		//	noffH.initData.size, noffH.initData.inFileAddr);
-        int virtualpage=noffH.initData.virtualAddr/PageSize;
-        int offset=noffH.initData.virtualAddr%PageSize;
-        int physicaladdr=pageTable[virtualpage].physicalPage*PageSize+offset;
-        executable->ReadAt(&(machine->mainMemory[physicaladdr]),
-        noffH.initData.size, noffH.initData.inFileAddr);
+        LoadSegment(image->contents, noffH.initData.virtualAddr, 
+		noffH.initData.size, noffH.initData.inFileAddr, 0, 0);
     }
+#ifdef FILESYS
+    if (sharedText == NULL && endText > firstText) {
+	int *frames = new int[endText - firstText];
+
+	for (int vpn = firstText; vpn < endText; vpn++)
+	    frames[vpn - firstText] = pageTable[vpn].physicalPage;
+	textCache->Insert(image->sector, firstText, 
+			endText - firstText, frames);
+	delete [] frames;
+    }
+#endif
+    StartAccounting();
     Print();
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::LoadSegment
+// 	Copy a segment of the executable into memory.  The frames of the
+//	pages it spans need not be contiguous, so we copy the segment a
+//	page at a time.
+//
+//	"contents" is the executable, read into memory
+//	"virtualAddr", "size", "inFileAddr" describe the segment
+//	Virtual pages "skipFirst" .. "skipEnd - 1" are already loaded,
+//	and are left alone.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::LoadSegment(char *contents, int virtualAddr, int size,
+			int inFileAddr, int skipFirst, int skipEnd)
+{
+    int vpn, frame, offset, chunk;
+
+    while (size > 0) {
+	vpn = virtualAddr / PageSize;
+	frame = pageTable[vpn].physicalPage;
+	offset = virtualAddr % PageSize;
+	chunk = min(PageSize - offset, size);
+	if (vpn < skipFirst || vpn >= skipEnd)
+	    bcopy(&contents[inFileAddr], 
+		&(machine->mainMemory[frame * PageSize + offset]), chunk);
+	virtualAddr += chunk;
+	inFileAddr += chunk;
+	size -= chunk;
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AddrSpace
+// 	Create the address space of a forked process: a copy of
+//	"parent", which must be the address space of the current thread.
+//
+//	Nothing is copied yet.  The child maps the same frames as the
+//	parent, and every writable page of both is made read-only, so
+//	that the first write to it, by either process, traps with a
+//	ReadOnlyException; only then is the page copied (cf.
+//	CopyOnWrite).  So forking costs one page table, and later on
+//	one page copy for each page that is actually written.  The
+//	exception is the pages the parent has pushed out to swap, which
+//	are copied into the child's own swap slots right away.
+//
+//	The child starts out with just the standard input and output,
+//	as a process started by Exec does; open files are not shared.
+//----------------------------------------------------------------------
+
+AddrSpace::AddrSpace(AddrSpace *parent)
+{
+    char buffer[PageSize];
+    unsigned int i;
+    int frame;
+
+    SpaceId = GlobalSpaceId->Find();
+    ASSERT(SpaceId != -1);
+    for (i = 0; i < 10; i++)
+	filedescriptor[i] = NULL;
+    filedescriptor[0] = filedescriptor[1] = filedescriptor[2] =
+	new OpenFile("stdout");
+
+    numPages = parent->numPages;
+    mmapBase = parent->mmapBase;
+    mappings = NULL;			// mapped files aren't shared either
+    pageTable = new TranslationEntry[numPages];
+    copyOnWrite = new bool[numPages];
+    for (i = 0; i < numPages; i++) {
+	pageTable[i] = parent->pageTable[i];
+	pageTable[i].use = pageTable[i].dirty = FALSE;
+	copyOnWrite[i] = FALSE;
+	if (i >= (unsigned) mmapBase) {
+	    pageTable[i].valid = FALSE;
+	    pageTable[i].physicalPage = -1;
+	    continue;
+	}
+	if (parent->pageTable[i].valid && !parent->pageTable[i].readOnly) {
+	    parent->pageTable[i].readOnly = pageTable[i].readOnly = TRUE;
+	    parent->copyOnWrite[i] = TRUE;
+	}
+	copyOnWrite[i] = parent->copyOnWrite[i];
+	if (pageTable[i].valid)		// else it's on swap, or still
+	    frameTable->Share(pageTable[i].physicalPage);	// all zeroes
+    }
+
+// the parent's pages on swap (or in the cache of clean pages) get copied;
+// if the child has no swap slots, it needs frames for them
+    onSwap = new bool[numPages];
+    swapBase = swapArea->Allocate(mmapBase);
+    for (i = 0; i < numPages; i++) {
+	onSwap[i] = FALSE;
+	if (parent->pageTable[i].valid || !parent->onSwap[i])
+	    continue;
+	if ((frame = frameTable->FindCached(parent, i)) != -1)
+	    bcopy(&machine->mainMemory[frame * PageSize], buffer, PageSize);
+	else
+	    swapArea->ReadSlot(parent->swapBase + i, buffer);
+	if (swapBase != -1) {
+	    swapArea->WriteSlot(swapBase + i, buffer);
+	    onSwap[i] = TRUE;
+	} else {
+	    frame = frameTable->Allocate(this, i);
+	    ASSERT(frame != -1);
+	    bcopy(buffer, &machine->mainMemory[frame * PageSize], PageSize);
+	    pageTable[i].physicalPage = frame;
+	    pageTable[i].valid = TRUE;
+	}
+    }
+#ifdef USE_TLB
+    parent->InvalidateTLB(0, parent->numPages);	// the parent's pages are
+					// read-only now, and the TLB doesn't know
+#endif
+    StartAccounting();
+    DEBUG('a', "Forked address space %d from %d, %d pages shared\n",
+	SpaceId, parent->SpaceId, numPages);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::StartAccounting
+// 	Start keeping track of the memory use of a new process: none of
+//	its pages has been seen used yet, and until it starts faulting,
+//	it should do with the frames it has been given.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::StartAccounting()
+{
+    lastUsed = new int[numPages];
+    for (unsigned int i = 0; i < numPages; i++)
+	lastUsed[i] = -1;
+    workingSet = 0;
+    numFaults = recentFaults = 0;
+    quota = peakResident = Resident();
+    startTicks = stats->totalTicks;
+    frameTable->AddSpace(this);
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-// 	Dealloate an address space.  Nothing for now!
+// 	Dealloate an address space.  Frames still shared with another
+//	address space stay in use until that one is done with them too.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
     //释放获取的spaceid以及内存块
     //GlobalFreeMap->Clear(SpaceId);
+    UnmapAll();
+    frameTable->RemoveSpace(this);
     for(int i=0;i<numPages;i++){
-        GlobalFreeMap->Clear(pageTable[i].physicalPage);
+        if(pageTable[i].physicalPage!=-1)
+            frameTable->Release(pageTable[i].physicalPage, this);
     }
+    frameTable->DropCached(this);
+    if (swapBase != -1)
+	swapArea->Free(swapBase, mmapBase);
     GlobalSpaceId->Clear(SpaceId);
    delete [] pageTable;
+   delete [] copyOnWrite;
+   delete [] lastUsed;
+   delete [] onSwap;
 }
 
 //----------------------------------------------------------------------
@@ -182,10 +446,11 @@ AddrSpace::InitRegisters()
     machine->WriteRegister(NextPCReg, 4);
 
    // Set the stack register to the end of the address space, where we
-   // allocated the stack; but subtract off a bit, to make sure we don't
-   // accidentally reference off the end!
-    machine->WriteRegister(StackReg, numPages * PageSize - 16);
-    DEBUG('a', "Initializing stack register to %d\n", numPages * PageSize - 16);
+   // allocated the stack (just below the pages for mapped files); but
+   // subtract off a bit, to make sure we don't accidentally reference
+   // off the end!
+    machine->WriteRegister(StackReg, mmapBase * PageSize - 16);
+    DEBUG('a', "Initializing stack register to %d\n", mmapBase * PageSize - 16);
 }
 
 //----------------------------------------------------------------------
@@ -230,6 +495,574 @@ void AddrSpace::Print()
     printf("============================================\n\n");
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::CopyOnWrite
+// 	Handle a write to virtual page "vpn", which trapped because the
+//	page is read-only.  If it is only read-only because its frame is
+//	shared after a Fork, give this address space a private, writable
+//	copy of the page (or, if no one else maps the frame any more,
+//	just make it writable again), so the write can be retried.
+//
+//	Returns FALSE if the page really is read-only, or if there is no
+//	free frame to copy it into.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CopyOnWrite(int vpn)
+{
+    int oldFrame, newFrame;
+
+    if (vpn < 0 || vpn >= (int) numPages || !copyOnWrite[vpn])
+	return FALSE;
+    oldFrame = pageTable[vpn].physicalPage;
+    if (frameTable->RefCount(oldFrame) > 1) {
+	if ((newFrame = frameTable->Allocate(this, vpn)) == -1)
+	    return FALSE;
+	bcopy(&machine->mainMemory[oldFrame * PageSize],
+	    &machine->mainMemory[newFrame * PageSize], PageSize);
+	frameTable->Release(oldFrame, this);
+	pageTable[vpn].physicalPage = newFrame;
+	DEBUG('a', "Space %d: copied page %d from frame %d to frame %d\n",
+	    SpaceId, vpn, oldFrame, newFrame);
+    } else				// the frame is all ours now
+	frameTable->SetOwner(oldFrame, this, vpn);
+    numFaults++;
+    recentFaults++;
+    pageTable[vpn].readOnly = FALSE;
+    copyOnWrite[vpn] = FALSE;
+#ifdef USE_TLB
+    InvalidateTLB(vpn, vpn + 1);	// drop the stale translation
+#endif
+    return TRUE;
+}
+
+#ifdef USE_TLB
+//----------------------------------------------------------------------
+// AddrSpace::InvalidateTLB
+// 	Drop the translations of pages "first" up to (but not including)
+//	"end" from the TLB of every processor that is running a thread
+//	of this address space -- not only the one being simulated.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::InvalidateTLB(int first, int end)
+{
+    for (int cpu = 0; cpu < NumCPUs; cpu++) {
+	Thread *thread = scheduler->Running(cpu);
+	TranslationEntry *tlb = machine->TLBOf(cpu);
+
+	if (thread == NULL || thread->space != this)
+	    continue;
+	for (int i = 0; i < TLBSize; i++)
+	    if (tlb[i].valid && tlb[i].virtualPage >= first
+		    && tlb[i].virtualPage < end)
+		tlb[i].valid = FALSE;
+    }
+}
+#endif
+
+//----------------------------------------------------------------------
+// AddrSpace::PageFault
+// 	Handle a reference to virtual page "vpn", which trapped because
+//	the page is not valid, and bring the page in, so the instruction
+//	can be retried:
+//
+//	  - if the page is still in the cache of clean pages, just map
+//	    its frame again;
+//	  - if it is a page of a mapped file, read it from the file;
+//	  - if it is on swap, read it back, along with the next few pages
+//	    that are on swap too, as long as there are free frames for
+//	    them; those go into the cache, in case they are used soon;
+//	  - otherwise, it is a page of uninitialized data or of the stack
+//	    that hasn't been touched yet: give it a frame full of zeroes.
+//
+//	Whether the page is read-only is left as it was.
+//
+//	Returns FALSE if "vpn" is outside the address space, or there is
+//	no frame to be had.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::PageFault(int vpn)
+{
+    int frame, frames[SwapReadAhead], n, i, offset;
+    Mapping *mapping;
+
+    if (vpn < 0 || vpn >= (int) numPages || pageTable[vpn].physicalPage != -1)
+	return FALSE;
+    if ((frame = frameTable->FindCached(this, vpn)) != -1) {
+	frameTable->TakeCached(frame);
+	DEBUG('a', "Space %d: page %d still in frame %d\n", SpaceId, vpn,
+	    frame);
+    } else if (vpn >= mmapBase) {
+	if ((mapping = FindMapping(vpn)) == NULL
+		|| (frame = frameTable->Allocate(this, vpn)) == -1)
+	    return FALSE;
+	offset = (vpn - mapping->firstPage) * PageSize;
+	DEBUG('a', "Space %d: reading page %d from byte %d of its file\n",
+	    SpaceId, vpn, offset);
+	bzero(&machine->mainMemory[frame * PageSize], PageSize);
+	mapping->file->ReadAt(&machine->mainMemory[frame * PageSize],
+	    min(PageSize, mapping->length - offset), offset);
+    } else if (onSwap[vpn]) {
+	if ((frame = frameTable->Allocate(this, vpn)) == -1)
+	    return FALSE;
+	frames[0] = frame;
+	for (n = 1; n < SwapReadAhead && vpn + n < (int) numPages; n++)
+	    if (pageTable[vpn + n].valid || !onSwap[vpn + n]
+		    || frameTable->FindCached(this, vpn + n) != -1
+		    || (frames[n] = frameTable->AllocateCached(this, 
+							vpn + n)) == -1)
+		break;
+	DEBUG('a', "Space %d: reading pages %d-%d from swap\n", SpaceId,
+	    vpn, vpn + n - 1);
+	swapArea->ReadPages(swapBase + vpn, frames, n);
+	for (i = 1; i < n; i++)
+	    frameTable->IoDone(frames[i]);
+    } else {
+	if ((frame = frameTable->AllocateZeroed(this, vpn)) == -1)
+	    return FALSE;
+	DEBUG('a', "Space %d: zero-filled page %d in frame %d\n", SpaceId,
+	    vpn, frame);
+    }
+    stats->numPageFaults++;
+    numFaults++;
+    recentFaults++;
+    pageTable[vpn].physicalPage = frame;
+    pageTable[vpn].valid = TRUE;
+    pageTable[vpn].use = pageTable[vpn].dirty = FALSE;
+    if (Resident() > peakResident)
+	peakResident = Resident();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CanPageOut
+// 	Return TRUE if page "vpn" can be pushed out to swap: it is in
+//	memory, in a frame of its own (not shared after a Fork, nor
+//	with the code cache) that isn't in the middle of a transfer, and
+//	there is somewhere to put it: a swap slot, or for a page of a
+//	mapped file, the file.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CanPageOut(int vpn)
+{
+    int frame;
+
+    if (vpn < 0 || vpn >= (int) numPages || !pageTable[vpn].valid
+		|| (swapBase == -1 && vpn < mmapBase))
+	return FALSE;
+    frame = pageTable[vpn].physicalPage;
+    return (bool) (frameTable->RefCount(frame) == 1
+	&& frameTable->Owner(frame) == this 
+	&& frameTable->OwnerPage(frame) == vpn && !frameTable->Busy(frame));
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Referenced
+// 	Return TRUE if page "vpn" has been used since the last time we
+//	asked (or sampled the use bits), and clear its use bit.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::Referenced(int vpn)
+{
+    if (!pageTable[vpn].use)
+	return FALSE;
+    pageTable[vpn].use = FALSE;
+    lastUsed[vpn] = frameTable->Now();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageOut
+// 	Push page "vpn" out to swap, along with as many of the pages on
+//	either side of it as can go and haven't been used lately, up to
+//	SwapCluster pages in all.  Their frames go into the cache of
+//	clean pages (cf. frametable.h).
+//
+//	Only the pages that were written to, or that have never been
+//	written out, need writing; since the pages are consecutive, so
+//	are their swap slots, and each run of them is written in one go.
+//	The pages are unmapped first, so a fault on one of them while we
+//	wait for the disk finds it in the cache.
+//
+//	A page of a mapped file goes back to its file instead, on its
+//	own (cf. PageOutMapped).
+//
+//	Returns the number of pages pushed out.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::PageOut(int vpn)
+{
+    int frames[SwapCluster];
+    bool mustWrite[SwapCluster];
+    int first = vpn, end = vpn + 1, base = swapBase, i, j, k;
+
+    ASSERT(CanPageOut(vpn));
+    if (vpn >= mmapBase) {
+	PageOutMapped(vpn);
+	return 1;
+    }
+    while (end - first < SwapCluster && CanPageOut(first - 1) 
+		&& !Referenced(first - 1))
+	first--;
+    while (end - first < SwapCluster && end < mmapBase && CanPageOut(end)
+		&& !Referenced(end))
+	end++;
+
+    for (i = first; i < end; i++) {
+	frames[i - first] = pageTable[i].physicalPage;
+	mustWrite[i - first] = (bool) (pageTable[i].dirty || !onSwap[i]);
+	if (mustWrite[i - first])
+	    frameTable->StartIo(frames[i - first]);
+	frameTable->Cache(frames[i - first]);
+	pageTable[i].valid = FALSE;
+	pageTable[i].physicalPage = -1;
+	pageTable[i].use = pageTable[i].dirty = FALSE;
+	onSwap[i] = TRUE;
+    }
+#ifdef USE_TLB
+    InvalidateTLB(first, end);		// drop the stale translations
+#endif
+    DEBUG('a', "Space %d: pushing pages %d-%d out to swap\n", SpaceId,
+	first, end - 1);
+
+    for (i = 0; i < end - first; i = j) {
+	for (; i < end - first && !mustWrite[i]; i++)
+	    ;
+	for (j = i; j < end - first && mustWrite[j]; j++)
+	    ;
+	if (j > i) {
+	    swapArea->WritePages(base + first + i, &frames[i], j - i);
+	    for (k = i; k < j; k++)
+		frameTable->IoDone(frames[k]);
+	}
+    }
+    return end - first;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageOutMapped
+// 	Let go of the frame of page "vpn" of a mapped file, writing the
+//	page back to the file first if it has been written to.  The
+//	frame goes into the cache of clean pages, as for swap.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::PageOutMapped(int vpn)
+{
+    Mapping *mapping = FindMapping(vpn);
+    int frame = pageTable[vpn].physicalPage;
+    bool dirty = pageTable[vpn].dirty;
+
+    ASSERT(mapping != NULL);
+    if (dirty)
+	frameTable->StartIo(frame);
+    frameTable->Cache(frame);
+    pageTable[vpn].valid = FALSE;
+    pageTable[vpn].physicalPage = -1;
+    pageTable[vpn].use = pageTable[vpn].dirty = FALSE;
+#ifdef USE_TLB
+    InvalidateTLB(vpn, vpn + 1);	// drop the stale translation
+#endif
+    DEBUG('a', "Space %d: writing page %d back to its file\n", SpaceId,
+	vpn);
+    if (dirty) {
+	mapping->refs++;		// in case the owner unmaps it
+	WriteBack(mapping, vpn, frame);	// while we wait for the disk
+	frameTable->IoDone(frame);
+	ReleaseMapping(mapping);
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Mmap
+// 	Map the first "length" bytes of "file" into this address space,
+//	at the first pages free among those set aside for mappings.
+//	Nothing is read yet: each page is read from the file the first
+//	time it is touched (cf. PageFault), and written back if it has
+//	been written to when it is pushed out of memory, or when the
+//	file is unmapped.  Changes made to the file through Write are
+//	not seen by pages already in memory.
+//
+//	Returns the virtual address of the mapping, or 0 if "length" is
+//	not within the file or there is no room for it.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::Mmap(OpenFile *file, int length)
+{
+#ifdef FILESYS
+    int numMapped = divRoundUp(length, PageSize), first, vpn;
+    Mapping *mapping;
+
+    if (file == NULL || length <= 0 || length > file->Length())
+	return 0;
+    for (first = mmapBase; first + numMapped <= (int) numPages; 
+		first = vpn + 1) {
+	for (vpn = first; vpn < first + numMapped; vpn++)
+	    if (FindMapping(vpn) != NULL)
+		break;
+	if (vpn == first + numMapped) {
+	    mapping = new Mapping;
+	    mapping->file = new OpenFile(file->hdrSector);
+	    mapping->firstPage = first;
+	    mapping->numPages = numMapped;
+	    mapping->length = length;
+	    mapping->refs = 1;
+	    mapping->next = mappings;
+	    mappings = mapping;
+	    DEBUG('a', "Space %d: mapped %d bytes at page %d\n", SpaceId,
+		length, first);
+	    return first * PageSize;
+	}
+    }
+#endif
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Munmap, AddrSpace::UnmapAll
+// 	Unmap the file mapped at "addr" (or every file mapped), writing
+//	back the pages that have been written to.
+//
+//	Munmap returns FALSE if nothing is mapped at "addr".
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::Munmap(int addr)
+{
+    for (Mapping *mapping = mappings; mapping != NULL; mapping = mapping->next)
+	if (mapping->firstPage * PageSize == addr) {
+	    Unmap(mapping);
+	    return TRUE;
+	}
+    return FALSE;
+}
+
+void
+AddrSpace::UnmapAll()
+{
+    while (mappings != NULL)
+	Unmap(mappings);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FindMapping
+// 	Return the mapping covering virtual page "vpn", or NULL.
+//----------------------------------------------------------------------
+
+Mapping *
+AddrSpace::FindMapping(int vpn)
+{
+    for (Mapping *mapping = mappings; mapping != NULL; mapping = mapping->next)
+	if (vpn >= mapping->firstPage 
+		&& vpn < mapping->firstPage + mapping->numPages)
+	    return mapping;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Unmap
+// 	Take "mapping" off the list, and let go of its pages: those in
+//	memory are unmapped first, then written back if need be, so that
+//	no one pushes them out meanwhile; those in the cache of clean
+//	pages are simply dropped.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::Unmap(Mapping *mapping)
+{
+    Mapping **prev;
+    int vpn, frame;
+    bool dirty;
+
+    for (prev = &mappings; *prev != mapping; prev = &(*prev)->next)
+	;
+    *prev = mapping->next;
+    for (vpn = mapping->firstPage; 
+		vpn < mapping->firstPage + mapping->numPages; vpn++) {
+	if (pageTable[vpn].valid) {
+	    frame = pageTable[vpn].physicalPage;
+	    dirty = pageTable[vpn].dirty;
+	    pageTable[vpn].valid = FALSE;
+	    pageTable[vpn].physicalPage = -1;
+	    pageTable[vpn].use = pageTable[vpn].dirty = FALSE;
+#ifdef USE_TLB
+	    InvalidateTLB(vpn, vpn + 1);
+#endif
+	    if (dirty)
+		WriteBack(mapping, vpn, frame);
+	    frameTable->Release(frame, this);
+	} else if ((frame = frameTable->FindCached(this, vpn)) != -1)
+	    frameTable->Uncache(frame);
+    }
+    DEBUG('a', "Space %d: unmapped page %d\n", SpaceId, mapping->firstPage);
+    ReleaseMapping(mapping);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Touch
+// 	Make page "vpn" ready for the kernel to read, or if "writing",
+//	to write: bring it in if it isn't in memory, and give the space
+//	its own copy if it is shared after a Fork, just as if a user
+//	instruction had touched it.  Returns FALSE if the page can't be
+//	touched that way.
+//
+//	The caller must copy to or from the frame before anything else
+//	can block, or the page could be pushed out again meanwhile.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::Touch(int vpn, bool writing)
+{
+    if (vpn < 0 || vpn >= (int) numPages)
+	return FALSE;
+    if (!pageTable[vpn].valid && !PageFault(vpn))
+	return FALSE;
+    if (writing && pageTable[vpn].readOnly && !CopyOnWrite(vpn))
+	return FALSE;
+    pageTable[vpn].use = TRUE;
+    if (writing)
+	pageTable[vpn].dirty = TRUE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyIn, AddrSpace::CopyOut
+// 	Copy "size" bytes between user memory, starting at "virtAddr",
+//	and a kernel buffer, a page at a time rather than a byte at a
+//	time through Machine::ReadMem and Machine::WriteMem.  Returns
+//	FALSE if part of the range isn't in the address space (or, for
+//	CopyOut, is read-only); some of the bytes may have been copied.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CopyIn(int virtAddr, char *into, int size)
+{
+    int vpn, offset, n;
+
+    for (; size > 0; virtAddr += n, into += n, size -= n) {
+	vpn = (unsigned) virtAddr / PageSize;
+	offset = (unsigned) virtAddr % PageSize;
+	n = min(size, PageSize - offset);
+	if (!Touch(vpn, FALSE))
+	    return FALSE;
+	bcopy(&machine->mainMemory[pageTable[vpn].physicalPage * PageSize 
+	    + offset], into, n);
+    }
+    return TRUE;
+}
+
+bool
+AddrSpace::CopyOut(int virtAddr, char *from, int size)
+{
+    int vpn, offset, n;
+
+    for (; size > 0; virtAddr += n, from += n, size -= n) {
+	vpn = (unsigned) virtAddr / PageSize;
+	offset = (unsigned) virtAddr % PageSize;
+	n = min(size, PageSize - offset);
+	if (!Touch(vpn, TRUE))
+	    return FALSE;
+	bcopy(from, &machine->mainMemory[pageTable[vpn].physicalPage 
+	    * PageSize + offset], n);
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Resident
+// 	Return the number of pages of this address space that have a
+//	frame, whether or not the frame is shared.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::Resident()
+{
+    int resident = 0;
+
+    for (unsigned int i = 0; i < numPages; i++)
+	if (pageTable[i].valid)
+	    resident++;
+    return resident;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SampleUseBits
+// 	Called every SampleInterval timer interrupts (cf. FrameTable::
+//	TimerTick); "now" is the number of the sample.  Record which
+//	pages the process has used since the last sample, clearing their
+//	use bits, and count the pages used within the last
+//	WorkingSetWindow samples, as the estimate of its working set.
+//
+//	Then set how many frames the process should have, by its page
+//	fault frequency: if it faulted a lot since the last sample, it
+//	needs more frames than it has; if it hardly faulted at all, its
+//	working set is all it needs.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::SampleUseBits(int now)
+{
+    int resident = 0;
+
+    workingSet = 0;
+    for (unsigned int i = 0; i < numPages; i++) {
+	if (!pageTable[i].valid)
+	    continue;
+	resident++;
+	if (pageTable[i].use) {
+	    lastUsed[i] = now;
+	    pageTable[i].use = FALSE;
+	}
+	if (lastUsed[i] >= 0 && now - lastUsed[i] < WorkingSetWindow)
+	    workingSet++;
+    }
+#ifdef USE_TLB
+    for (int cpu = 0; cpu < NumCPUs; cpu++) {	// each TLB we are in has
+	Thread *thread = scheduler->Running(cpu);	// use bits of its own
+	TranslationEntry *tlb = machine->TLBOf(cpu);
+
+	if (thread == NULL || thread->space != this)
+	    continue;
+	for (int i = 0; i < TLBSize; i++)
+	    if (tlb[i].valid && tlb[i].use) {
+		lastUsed[tlb[i].virtualPage] = now;
+		tlb[i].use = FALSE;
+	    }
+    }
+#endif
+
+    if (recentFaults >= PFFHigh)
+	quota = resident + recentFaults;
+    else if (recentFaults < PFFLow)
+	quota = max(workingSet, 1);
+    DEBUG('a', "Space %d: resident %d, working set %d, %d faults, "
+	"quota %d\n", SpaceId, resident, workingSet, recentFaults, quota);
+    recentFaults = 0;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PrintMemoryUse
+// 	Print how much memory the process has used, and how often it
+//	has faulted (per 1000 ticks of its lifetime).
+//----------------------------------------------------------------------
+
+void
+AddrSpace::PrintMemoryUse()
+{
+    int ticks = stats->totalTicks - startTicks;
+
+    printf("Space %d: resident %d (peak %d), working set %d, quota %d, "
+	"faults %d (%d per 1000 ticks)\n", SpaceId, Resident(),
+	peakResident, workingSet, quota, numFaults,
+	ticks > 0 ? numFaults * 1000 / ticks : 0);
+}
+
 int AddrSpace::getfiledescriptor(OpenFile*openfile){
     for(int i=3;i<10;i++){
         if(filedescriptor[i]==NULL){
@@ -252,10 +1085,20 @@ void AddrSpace::clear(){
         filedescriptor[i]=NULL;
     }
     numfile=3;
+    UnmapAll();
+    PrintMemoryUse();
+    frameTable->RemoveSpace(this);
     for(int i=0;i<numPages;i++){
         pageTable[i].valid=false;
-        GlobalFreeMap->Clear(pageTable[i].physicalPage);
+        if(pageTable[i].physicalPage!=-1)
+            frameTable->Release(pageTable[i].physicalPage, this);
+        pageTable[i].physicalPage=-1;
+        onSwap[i]=FALSE;
     }
+    frameTable->DropCached(this);
+    if (swapBase != -1)
+	swapArea->Free(swapBase, mmapBase);
+    swapBase = -1;
     printf("errrrrrrrrrrrrrr%d\n",SpaceId);
     GlobalSpaceId->Clear(SpaceId);
 }
\ No newline at end of file
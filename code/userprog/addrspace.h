@@ -17,12 +17,35 @@
 #include "filesys.h"
 
 #define UserStackSize		1024 	// increase this as necessary!
+#define MmapPages		32	// pages set aside, above the stack,
+					// to map files into (cf. MaxFileSize)
+
+class ExecImage;
+
+// A file mapped into an address space by Mmap.  The mapping has its own
+// OpenFile, so it outlives the file descriptor it was made from; it is
+// deleted when the last of the mapping itself and any page being
+// written back to it lets go.
+
+class Mapping {
+  public:
+    OpenFile *file;			// the file mapped
+    int firstPage;			// first virtual page of the mapping
+    int numPages;			// # of pages it covers
+    int length;				// # of bytes of the file mapped
+    int refs;				// the mapping, and pages in transit
+    Mapping *next;			// next mapping of the same space
+};
 
 class AddrSpace {
   public:
     AddrSpace(OpenFile *executable);	// Create an address space,
 					// initializing it with the program
 					// stored in the file "executable"
+    AddrSpace(ExecImage *image);	// Same, but the program has been
+					// read in already
+    AddrSpace(AddrSpace *parent);	// Create a copy-on-write copy of
+					// "parent", for Fork
     ~AddrSpace();			// De-allocate an address space
 
     void InitRegisters();		// Initialize user-level CPU registers,
@@ -31,6 +54,38 @@ class AddrSpace {
     void SaveState();			// Save/restore address space-specific
     void RestoreState();		// info on a context switch 
     void Print();
+
+    bool CopyOnWrite(int vpn);		// Give this space its own copy of
+					// page "vpn", after a write fault
+    bool PageFault(int vpn);		// Bring in page "vpn", after a
+					// reference to it faulted
+    bool CanPageOut(int vpn);		// Could page "vpn" go to swap?
+    bool Referenced(int vpn);		// Used since last asked? (clears
+					// the use bit)
+    int PageOut(int vpn);		// Push page "vpn", and idle pages
+					// next to it, out to swap
+
+    int Mmap(OpenFile *file, int length);
+					// Map the first "length" bytes of
+					// "file"; returns the address, or 0
+    bool Munmap(int addr);		// Write back and drop the mapping
+					// at "addr"
+    void UnmapAll();			// Same, for every mapping
+
+    bool CopyIn(int virtAddr, char *into, int size);
+					// Copy user memory into a kernel
+					// buffer; FALSE if it isn't there
+    bool CopyOut(int virtAddr, char *from, int size);
+					// Copy a kernel buffer out to user
+					// memory; FALSE if it can't be
+
+    void SampleUseBits(int now);	// Note which pages were used since
+					// the last sample, and adjust quota
+    int Resident();			// # of pages with a frame
+    bool OverQuota() { return Resident() > quota; }
+					// Holding more frames than it
+					// seems to need?
+    void PrintMemoryUse();		// Print resident set and fault rate
     int getSpaceID(){
       return SpaceId;
     }
@@ -50,6 +105,49 @@ class AddrSpace {
 					// for now!
     unsigned int numPages;		// Number of pages in the virtual 
 					// address space
+    bool *copyOnWrite;			// Page is read-only only because
+					// its frame is shared after a Fork
+
+    int *lastUsed;			// Sample in which each page was last
+					// seen used; -1 if never
+    int workingSet;			// # of pages used in the last
+					// WorkingSetWindow samples
+    int quota;				// # of frames it should get, from
+					// its page fault frequency
+    int numFaults;			// Page faults, in all
+    int recentFaults;			// Page faults since the last sample
+    int peakResident;			// Most pages ever resident at once
+    int startTicks;			// When the process started
+
+    void StartAccounting();		// Set up the fields above
+
+    int swapBase;			// Swap slot of page 0; -1 if the
+					// space has none, and can't be
+					// paged out
+    bool *onSwap;			// Swap slot holds a copy of the page
+
+    int mmapBase;			// First page set aside for mappings
+					// (the rest of the space is below)
+    Mapping *mappings;			// Files mapped into the space
+
+    Mapping *FindMapping(int vpn);	// The mapping covering page "vpn"
+    void Unmap(Mapping *mapping);	// Write back and drop a mapping
+    void PageOutMapped(int vpn);	// Write back a page of a mapping,
+					// and let go of its frame
+
+#ifdef USE_TLB
+    void InvalidateTLB(int first, int end);
+					// Drop pages first..end-1 from the
+					// TLBs of the processors we run on
+#endif
+    bool Touch(int vpn, bool writing);	// Bring in page "vpn" for the
+					// kernel to read or write
+
+    void Load(ExecImage *image);		// Set up the space for "image"
+    void LoadSegment(char *contents, int virtualAddr, int size,
+		int inFileAddr, int skipFirst, int skipEnd);
+					// Copy a segment into memory, except
+					// for the pages already there
     int SpaceId=-100;
 
 };
@@ -0,0 +1,482 @@
+// frametable.cc 
+//	Routines to allocate and share frames of physical memory.
+//
+//	Interrupts are not turned off here: frames are only allocated
+//	and released by the thread running a user program, from inside
+//	a system call or exception (or cleared by the idle loop, when
+//	no thread is running).  The only thing in here that can block is
+//	paging out to swap; frames being transferred are marked busy
+//	first (cf. StartIo), so that no one else reuses them meanwhile.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "frametable.h"
+
+#define ZeroPerIdle	4		// frames cleared each time the
+					// machine goes idle
+
+//----------------------------------------------------------------------
+// FrameTable::FrameTable
+// 	Initialize the frame table, with no frame referenced.
+//
+//	"numFrames" is the number of frames of physical memory.
+//----------------------------------------------------------------------
+
+FrameTable::FrameTable(int nFrames)
+{
+    numFrames = nFrames;
+    refCount = new int[numFrames];
+    zeroed = new bool[numFrames];
+    owner = new AddrSpace *[numFrames];
+    ownerPage = new int[numFrames];
+    for (int i = 0; i < numFrames; i++) {
+	refCount[i] = 0;
+	zeroed[i] = TRUE;		// cf. Machine::Machine
+	owner[i] = NULL;
+	ownerPage[i] = -1;
+    }
+    ioCount = new int[numFrames];
+    cached = new bool[numFrames];
+    cachedAt = new int[numFrames];
+    for (int i = 0; i < numFrames; i++) {
+	ioCount[i] = 0;
+	cached[i] = FALSE;
+	cachedAt[i] = 0;
+    }
+    cacheClock = cacheHits = hand = 0;
+    maxSpaces = numFrames;		// cf. GlobalSpaceId
+    spaces = new AddrSpace *[maxSpaces];
+    for (int i = 0; i < maxSpaces; i++)
+	spaces[i] = NULL;
+    numTicks = numSamples = 0;
+}
+
+FrameTable::~FrameTable()
+{
+    delete [] refCount;
+    delete [] zeroed;
+    delete [] owner;
+    delete [] ownerPage;
+    delete [] spaces;
+    delete [] ioCount;
+    delete [] cached;
+    delete [] cachedAt;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::FindFree
+// 	Take a frame off the free map: a zeroed one if "wantZeroed" and
+//	there is one, else one that isn't, so as not to use up the
+//	zeroed ones for nothing.
+//
+//	If memory is full, drop the code of a program no one is running
+//	any more (cf. textcache.h) and try again; failing that, reuse
+//	the frame of the oldest clean page, pushing pages out to swap
+//	first if need be.  This may block.  Returns -1 if there is still
+//	no free frame.
+//----------------------------------------------------------------------
+
+int
+FrameTable::FindFree(bool wantZeroed)
+{
+    int frame;
+
+    for (frame = 0; frame < numFrames; frame++)
+	if (!GlobalFreeMap->Test(frame) && zeroed[frame] == wantZeroed) {
+	    GlobalFreeMap->Mark(frame);
+	    return frame;
+	}
+    frame = GlobalFreeMap->Find();
+    if (frame == -1) {
+	textCache->Reclaim(1);
+	frame = GlobalFreeMap->Find();
+    }
+    if (frame == -1)
+	frame = TakeOldestCached();
+    while (frame == -1 && PageOut())	// someone may have freed a
+	if ((frame = GlobalFreeMap->Find()) == -1)	// frame meanwhile
+	    frame = TakeOldestCached();
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Allocate, FrameTable::AllocateZeroed
+// 	Take a frame off the free map, for page "vpn" of "owner".  The
+//	frame from Allocate holds whatever it held before; the one from
+//	AllocateZeroed is all zeroes.
+//
+//	Returns the frame number, or -1 if memory is full.
+//----------------------------------------------------------------------
+
+int
+FrameTable::Allocate(AddrSpace *space, int vpn)
+{
+    int frame = FindFree(FALSE);
+
+    if (frame == -1)
+	return -1;
+    ASSERT(refCount[frame] == 0);
+    refCount[frame] = 1;
+    zeroed[frame] = FALSE;
+    SetOwner(frame, space, vpn);
+    return frame;
+}
+
+int
+FrameTable::AllocateZeroed(AddrSpace *space, int vpn)
+{
+    int frame = FindFree(TRUE);
+
+    if (frame == -1)
+	return -1;
+    ASSERT(refCount[frame] == 0);
+    if (!zeroed[frame]) {
+	DEBUG('a', "No zeroed frame ready; clearing frame %d\n", frame);
+	bzero(&machine->mainMemory[frame * PageSize], PageSize);
+    }
+    refCount[frame] = 1;
+    zeroed[frame] = FALSE;
+    SetOwner(frame, space, vpn);
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::SetOwner
+// 	Record that "frame" holds page "vpn" of "space".
+//----------------------------------------------------------------------
+
+void
+FrameTable::SetOwner(int frame, AddrSpace *space, int vpn)
+{
+    ASSERT(frame >= 0 && frame < numFrames);
+    owner[frame] = space;
+    ownerPage[frame] = vpn;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::State
+// 	Return what "frame" is being used for.
+//----------------------------------------------------------------------
+
+FrameState
+FrameTable::State(int frame)
+{
+    if (refCount[frame] == 0)
+	return cached[frame] ? FrameCached : FrameFree;
+    else if (owner[frame] == NULL)
+	return FrameUnowned;
+    else if (refCount[frame] > 1)
+	return FrameShared;
+    return FramePrivate;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Share
+// 	Count one more page table entry mapping "frame", which must
+//	already be in use.
+//----------------------------------------------------------------------
+
+void
+FrameTable::Share(int frame)
+{
+    ASSERT(frame >= 0 && frame < numFrames && refCount[frame] > 0);
+    refCount[frame]++;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Release
+// 	"space" no longer maps "frame"; if no one else does, put the
+//	frame back on the free map.  If "space" owned the frame, now no
+//	one does.
+//----------------------------------------------------------------------
+
+void
+FrameTable::Release(int frame, AddrSpace *space)
+{
+    ASSERT(frame >= 0 && frame < numFrames && refCount[frame] > 0);
+    if (owner[frame] == space)
+	SetOwner(frame, NULL, -1);
+    if (--refCount[frame] == 0) {
+	SetOwner(frame, NULL, -1);
+	if (Busy(frame))		// free it when the transfer is done
+	    cached[frame] = TRUE;
+	else
+	    GlobalFreeMap->Clear(frame);
+    }
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Cache
+// 	The only mapping of "frame" has gone away, because its page has
+//	been pushed out to swap.  Keep the page in the frame, tagged with
+//	its owner and virtual page, until the frame is needed.
+//----------------------------------------------------------------------
+
+void
+FrameTable::Cache(int frame)
+{
+    ASSERT(refCount[frame] == 1 && owner[frame] != NULL);
+    refCount[frame] = 0;
+    cached[frame] = TRUE;
+    cachedAt[frame] = cacheClock++;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::FindCached, FrameTable::TakeCached
+// 	Look for page "vpn" of "space" in the cache of clean pages; and
+//	map it again, taking it out of the cache.  The frame may still
+//	be being written out; that's fine, what's in it is the same.
+//----------------------------------------------------------------------
+
+int
+FrameTable::FindCached(AddrSpace *space, int vpn)
+{
+    for (int frame = 0; frame < numFrames; frame++)
+	if (cached[frame] && owner[frame] == space && ownerPage[frame] == vpn)
+	    return frame;
+    return -1;
+}
+
+void
+FrameTable::TakeCached(int frame)
+{
+    ASSERT(cached[frame] && refCount[frame] == 0);
+    cached[frame] = FALSE;
+    refCount[frame] = 1;
+    cacheHits++;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::AllocateCached
+// 	Take a free frame to read page "vpn" of "space" ahead into, and
+//	put it in the cache of clean pages, busy until the read is done.
+//	Read-ahead is not worth pushing anything out for, so we only
+//	look at the free map.
+//
+//	Returns the frame, or -1 if there is none free.
+//----------------------------------------------------------------------
+
+int
+FrameTable::AllocateCached(AddrSpace *space, int vpn)
+{
+    int frame = GlobalFreeMap->Find();
+
+    if (frame == -1)
+	return -1;
+    ASSERT(refCount[frame] == 0);
+    zeroed[frame] = FALSE;
+    SetOwner(frame, space, vpn);
+    cached[frame] = TRUE;
+    cachedAt[frame] = cacheClock++;
+    StartIo(frame);
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::TakeOldestCached
+// 	Reuse the frame of the clean page that has been in the cache the
+//	longest.  Its owner will have to read it back from swap.
+//
+//	Returns the frame, still marked in use, or -1 if the cache is
+//	empty (or every page in it is still being transferred).
+//----------------------------------------------------------------------
+
+int
+FrameTable::TakeOldestCached()
+{
+    int oldest = -1;
+
+    for (int frame = 0; frame < numFrames; frame++)
+	if (cached[frame] && !Busy(frame) && (oldest == -1 
+		|| cachedAt[frame] < cachedAt[oldest]))
+	    oldest = frame;
+    if (oldest != -1) {
+	cached[oldest] = FALSE;
+	SetOwner(oldest, NULL, -1);
+    }
+    return oldest;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Uncache, FrameTable::DropCached
+// 	The page cached in "frame" is of no more use (or "space" is done,
+//	and none of its pages are): free the frame.
+//----------------------------------------------------------------------
+
+void
+FrameTable::Uncache(int frame)
+{
+    ASSERT(cached[frame]);
+    SetOwner(frame, NULL, -1);
+    if (!Busy(frame)) {			// else IoDone frees it
+	cached[frame] = FALSE;
+	GlobalFreeMap->Clear(frame);
+    }
+}
+
+void
+FrameTable::DropCached(AddrSpace *space)
+{
+    for (int frame = 0; frame < numFrames; frame++)
+	if (cached[frame] && owner[frame] == space)
+	    Uncache(frame);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::StartIo, FrameTable::IoDone
+// 	Mark "frame" busy while it is being read from or written to
+//	swap, so that it isn't reused in the middle of the transfer.  A
+//	cached frame whose owner went away meanwhile is freed once the
+//	transfer is done.
+//----------------------------------------------------------------------
+
+void
+FrameTable::StartIo(int frame)
+{
+    ioCount[frame]++;
+}
+
+void
+FrameTable::IoDone(int frame)
+{
+    ASSERT(ioCount[frame] > 0);
+    if (--ioCount[frame] == 0 && cached[frame] && owner[frame] == NULL) {
+	cached[frame] = FALSE;
+	GlobalFreeMap->Clear(frame);
+    }
+}
+
+//----------------------------------------------------------------------
+// FrameTable::PageOut
+// 	Choose a page to push out to swap, by the clock algorithm: go
+//	round the frames from where we left off, skipping the pages used
+//	since we last came by (and clearing their use bits, so they are
+//	fair game next time).  The first time round, only processes
+//	holding more frames than their quota are considered.  The owner
+//	of the page pushes it out, along with whatever neighbours it
+//	can (cf. AddrSpace::PageOut).  This blocks while they are
+//	written.
+//
+//	Returns FALSE if there is no page that can be pushed out.
+//----------------------------------------------------------------------
+
+bool
+FrameTable::PageOut()
+{
+    AddrSpace *space;
+    int frame, vpn;
+
+    for (int pass = 0; pass < 2; pass++)
+	for (int n = 0; n < 2 * numFrames; n++) {
+	    frame = hand;
+	    hand = (hand + 1) % numFrames;
+	    space = owner[frame];
+	    vpn = ownerPage[frame];
+	    if (space == NULL || cached[frame] || !Registered(space) 
+			|| !space->CanPageOut(vpn))
+		continue;
+	    if (pass == 0 && !space->OverQuota())
+		continue;
+	    if (space->Referenced(vpn))	// second chance
+		continue;
+	    space->PageOut(vpn);
+	    return TRUE;
+	}
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::ZeroIdleFrames
+// 	Called from Interrupt::Idle, when no thread is ready to run:
+//	clear up to ZeroPerIdle free frames that aren't clear yet.  This
+//	takes no simulated time, as the CPU would otherwise be idle.
+//----------------------------------------------------------------------
+
+void
+FrameTable::ZeroIdleFrames()
+{
+    int done = 0;
+
+    for (int frame = 0; frame < numFrames && done < ZeroPerIdle; frame++)
+	if (!zeroed[frame] && !GlobalFreeMap->Test(frame)) {
+	    bzero(&machine->mainMemory[frame * PageSize], PageSize);
+	    zeroed[frame] = TRUE;
+	    done++;
+	}
+}
+
+//----------------------------------------------------------------------
+// FrameTable::AddSpace, FrameTable::Registered, FrameTable::RemoveSpace
+// 	Keep track of the address spaces of the running processes, to
+//	sample their use bits.  Only their pages are pushed out to swap:
+//	a space still being set up isn't ready for it.
+//----------------------------------------------------------------------
+
+void
+FrameTable::AddSpace(AddrSpace *space)
+{
+    ASSERT(space->getSpaceID() >= 0 && space->getSpaceID() < maxSpaces);
+    spaces[space->getSpaceID()] = space;
+}
+
+bool
+FrameTable::Registered(AddrSpace *space)
+{
+    return (bool) (space->getSpaceID() >= 0 
+	&& space->getSpaceID() < maxSpaces
+	&& spaces[space->getSpaceID()] == space);
+}
+
+void
+FrameTable::RemoveSpace(AddrSpace *space)
+{
+    if (Registered(space))
+	spaces[space->getSpaceID()] = NULL;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::TimerTick
+// 	Called from the timer interrupt handler.  Every SampleInterval
+//	interrupts, have every running process look at (and clear) the
+//	use bits of its pages.
+//----------------------------------------------------------------------
+
+void
+FrameTable::TimerTick()
+{
+    if (++numTicks < SampleInterval)
+	return;
+    numTicks = 0;
+    numSamples++;
+    for (int i = 0; i < maxSpaces; i++)
+	if (spaces[i] != NULL)
+	    spaces[i]->SampleUseBits(numSamples);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Print
+// 	Print how the frames are used, and the memory use of each
+//	running process.  Called when Nachos halts.
+//----------------------------------------------------------------------
+
+void
+FrameTable::Print()
+{
+    int counts[FrameCached + 1], i;
+
+    for (i = 0; i <= FrameCached; i++)
+	counts[i] = 0;
+    for (i = 0; i < numFrames; i++)
+	counts[State(i)]++;
+    printf("Frames: free %d, private %d, shared %d, unowned %d, "
+	"cached %d (%d faults found their page there)\n",
+	counts[FrameFree], counts[FramePrivate], counts[FrameShared],
+	counts[FrameUnowned], counts[FrameCached], cacheHits);
+    for (i = 0; i < maxSpaces; i++)
+	if (spaces[i] != NULL)
+	    spaces[i]->PrintMemoryUse();
+}
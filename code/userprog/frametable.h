@@ -0,0 +1,149 @@
+// frametable.h 
+//	Data structures to keep track of the frames of physical memory
+//	that are mapped into user address spaces.
+//
+//	Which frames are free is still kept in GlobalFreeMap; on top of
+//	that we count, for each frame, how many page table entries map
+//	it.  A frame can be mapped more than once when a process has
+//	been forked: parent and child share every page, read-only, until
+//	one of them writes to it (cf. AddrSpace::CopyOnWrite).  The frame
+//	only goes back on the free map when the last mapping goes away.
+//
+//	We also remember which free frames are known to hold nothing but
+//	zeroes.  Pages that must start out zero (the stack, uninitialized
+//	data) take those first, so that they usually needn't be cleared
+//	when they are handed out; while the machine is idle, waiting for
+//	the disk, we clear a few more free frames to keep a supply of them.
+//
+//	For each frame in use, the table also records which address
+//	space it belongs to and at what virtual page (an "inverted page
+//	table"), so that we can go from a frame back to the page table
+//	entry that maps it.  A frame shared after a Fork belongs to the
+//	space that first mapped it, as long as that one still does; a
+//	frame that only the code cache (cf. textcache.h) or only
+//	processes other than its owner still map belongs to no one.
+//
+//	Every SampleInterval timer interrupts, we look at the "use" bits
+//	of every page table, to estimate each process's working set, and
+//	at how often each process has faulted, to set how many frames it
+//	should get (page fault frequency, cf. AddrSpace::SampleUseBits).
+//
+//	When no frame is free, we push pages out to swap (cf. swap.h).
+//	Victims are chosen by the clock algorithm, going round the frames
+//	and giving a second chance to pages used since the last time
+//	round; pages of processes holding more frames than their quota
+//	go first.  Only private pages are paged out: shared ones stay in
+//	memory until all but one of their mappings are gone.
+//
+//	A page pushed out isn't forgotten right away: its frame goes into
+//	a cache of clean pages, still tagged with its owner and virtual
+//	page, and is only reused when the free frames run out.  If the
+//	owner faults on the page before that, it gets the frame back
+//	without reading the page from disk.  Pages read ahead on a fault
+//	wait in the same cache until they are touched.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FRAMETABLE_H
+#define FRAMETABLE_H
+
+#include "copyright.h"
+#include "utility.h"
+
+class AddrSpace;
+
+#define SampleInterval	10		// timer interrupts between samples
+					// of the use bits
+#define WorkingSetWindow 4		// a page used in the last this many
+					// samples is in the working set
+#define PFFHigh		4		// faults per sample above which a
+					// process needs more frames
+#define PFFLow		1		// below which it can do with fewer
+
+// What a frame is being used for
+enum FrameState { FrameFree, FramePrivate, FrameShared, FrameUnowned,
+		  FrameCached };
+
+class FrameTable {
+  public:
+    FrameTable(int numFrames);		// all frames unreferenced
+    ~FrameTable();
+
+    int Allocate(AddrSpace *owner, int vpn);
+					// take a free frame for page "vpn"
+					// of "owner", with one reference; -1
+					// if there is none, even after
+					// dropping cached code
+    int AllocateZeroed(AddrSpace *owner, int vpn);
+					// same, but the frame is cleared
+    void Share(int frame);		// one more mapping of "frame"
+    void Release(int frame, AddrSpace *space);
+					// "space" (NULL for the code cache)
+					// no longer maps "frame"; free it
+					// when no one does
+    void SetOwner(int frame, AddrSpace *owner, int vpn);
+					// "frame" is page "vpn" of "owner"
+    int RefCount(int frame) { return refCount[frame]; }
+    AddrSpace *Owner(int frame) { return owner[frame]; }
+    int OwnerPage(int frame) { return ownerPage[frame]; }
+    FrameState State(int frame);	// what "frame" is used for
+
+    void Cache(int frame);		// its only mapping is gone, but
+					// keep the page, as a clean page
+    int FindCached(AddrSpace *space, int vpn);
+					// the frame caching page "vpn" of
+					// "space", or -1
+    void TakeCached(int frame);		// map a cached page again
+    int AllocateCached(AddrSpace *space, int vpn);
+					// a free frame, to read page "vpn"
+					// of "space" ahead into; -1 if none
+    void Uncache(int frame);		// forget the page cached in "frame"
+    void DropCached(AddrSpace *space);	// forget the pages of "space"
+    void StartIo(int frame);		// "frame" is being read or written;
+    void IoDone(int frame);		// don't reuse it until it's done
+    bool Busy(int frame) { return (bool) (ioCount[frame] > 0); }
+
+    void AddSpace(AddrSpace *space);	// a process has started
+    void RemoveSpace(AddrSpace *space);	// a process is done
+    void TimerTick();			// called on each timer interrupt
+    int Now() { return numSamples; }	// # of samples taken so far
+    void Print();			// print the frames, and the memory
+					// use of each process
+
+    void ZeroIdleFrames();		// clear a few free frames, while
+					// there is nothing else to do
+
+  private:
+    int numFrames;			// # of frames of physical memory
+    int *refCount;			// # of mappings of each frame
+    bool *zeroed;			// free frame is known to be clear
+    AddrSpace **owner;			// the space each frame belongs to
+    int *ownerPage;			// and its virtual page there
+
+    AddrSpace **spaces;			// the running processes, by SpaceId
+    int maxSpaces;			// size of "spaces"
+    int numTicks;			// timer interrupts since last sample
+    int numSamples;			// samples taken so far
+
+    int *ioCount;			// # of transfers to or from swap
+					// the frame is part of
+    bool *cached;			// frame holds a clean page no one
+					// maps
+    int *cachedAt;			// when it went into the cache
+    int cacheClock;			// # of pages cached so far
+    int cacheHits;			// # of faults that found their
+					// page in the cache
+    int hand;				// where the clock algorithm is
+
+    int FindFree(bool wantZeroed);	// a free frame, preferably
+					// zeroed (or not); -1 if none
+    int TakeOldestCached();		// reuse the frame of the oldest
+					// clean page; -1 if none
+    bool PageOut();			// push some pages out to swap;
+					// FALSE if none can be
+    bool Registered(AddrSpace *space);	// is "space" a running process?
+};
+
+#endif // FRAMETABLE_H
@@ -0,0 +1,216 @@
+// imagecache.cc 
+//	Routines to read executables into memory, and to keep the most
+//	recently run ones there.
+//
+//	Images are only touched from inside system calls, which don't
+//	block in here except while opening or reading an executable; the
+//	list isn't being walked, and a new image isn't in it yet, while
+//	that happens.  The caller of Load may well block while it uses
+//	the image, though (AddrSpace::Load can have to page out to make
+//	room), so the image is counted as in use until it's Released.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "imagecache.h"
+
+//----------------------------------------------------------------------
+// SwapHeader
+// 	Do little endian to big endian conversion on the bytes in the 
+//	object file header, in case the file was generated on a little
+//	endian machine, and we're now running on a big endian machine.
+//----------------------------------------------------------------------
+
+static void 
+SwapHeader (NoffHeader *noffH)
+{
+	noffH->noffMagic = WordToHost(noffH->noffMagic);
+	noffH->code.size = WordToHost(noffH->code.size);
+	noffH->code.virtualAddr = WordToHost(noffH->code.virtualAddr);
+	noffH->code.inFileAddr = WordToHost(noffH->code.inFileAddr);
+	noffH->initData.size = WordToHost(noffH->initData.size);
+	noffH->initData.virtualAddr = WordToHost(noffH->initData.virtualAddr);
+	noffH->initData.inFileAddr = WordToHost(noffH->initData.inFileAddr);
+	noffH->uninitData.size = WordToHost(noffH->uninitData.size);
+	noffH->uninitData.virtualAddr = WordToHost(noffH->uninitData.virtualAddr);
+	noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
+}
+
+//----------------------------------------------------------------------
+// ExecImage::ExecImage
+// 	Read the NOFF header of "executable", and then the code and
+//	initialized data, with one read for both.
+//
+//	If the file isn't a NOFF executable, the image is left invalid
+//	(cf. IsValid).
+//----------------------------------------------------------------------
+
+ExecImage::ExecImage(OpenFile *executable)
+{
+    contents = NULL;
+    size = 0;
+    name = NULL;
+    refCount = 0;
+    next = NULL;
+#ifdef FILESYS
+    sector = executable->hdrSector;
+#else
+    sector = -1;
+#endif
+
+    if (executable->ReadAt((char *)&noffH, sizeof(noffH), 0) 
+		!= sizeof(noffH))
+	return;
+    if ((noffH.noffMagic != NOFFMAGIC) && 
+		(noffH.noffMagic != NOFFMAGICALIGNED) &&
+		(WordToHost(noffH.noffMagic) == NOFFMAGIC || 
+		 WordToHost(noffH.noffMagic) == NOFFMAGICALIGNED))
+    	SwapHeader(&noffH);
+    if (noffH.noffMagic != NOFFMAGIC && noffH.noffMagic != NOFFMAGICALIGNED)
+	return;
+
+    if (noffH.code.size > 0)
+	size = noffH.code.inFileAddr + noffH.code.size;
+    if (noffH.initData.size > 0)
+	size = max(size, noffH.initData.inFileAddr + noffH.initData.size);
+    contents = new char[size + 1];	// never of length 0
+    if (executable->ReadAt(contents, size, 0) != size) {
+	delete [] contents;
+	contents = NULL;
+    }
+}
+
+ExecImage::~ExecImage()
+{
+    delete [] contents;
+    delete [] name;
+}
+
+ImageCache::ImageCache()
+{
+    images = NULL;
+    numImages = 0;
+}
+
+ImageCache::~ImageCache()
+{
+    ExecImage *image;
+
+    while ((image = images) != NULL) {
+	images = image->next;
+	Release(image);
+    }
+}
+
+//----------------------------------------------------------------------
+// SameExecutable
+// 	Is "image" the executable that "name" now refers to?  With the
+//	Nachos file system, a cached image is recognized by the header
+//	sector of its file rather than by name, so that a name which has
+//	since been removed, or given to another file, can't bring back the
+//	old program.  The stub file system has no header sectors to go by.
+//----------------------------------------------------------------------
+
+static bool
+SameExecutable(ExecImage *image, char *name, OpenFile *executable)
+{
+#ifdef FILESYS
+    return (bool) (image->sector == executable->hdrSector);
+#else
+    return (bool) !strcmp(image->name, name);
+#endif
+}
+
+//----------------------------------------------------------------------
+// ImageCache::Load
+// 	Return the image of the executable called "name".  The file is
+//	always opened, to find out what "name" refers to now, but only
+//	read if we don't have its image.  If we have it, move it to the
+//	front of the list; if not, read it in, and throw out the least
+//	recently used image if the cache is full.
+//	The caller mustn't delete the image, but must Release it when it
+//	is done with it; until then, the image stays valid even if it is
+//	thrown out of the cache.
+//
+//	Returns NULL if there is no such file, or it's not an executable.
+//----------------------------------------------------------------------
+
+ExecImage *
+ImageCache::Load(char *name)
+{
+    ExecImage **prev, *image;
+    OpenFile *executable;
+
+    if ((executable = fileSystem->Open(name)) == NULL)
+	return NULL;
+    for (prev = &images; (image = *prev) != NULL; prev = &image->next)
+	if (SameExecutable(image, name, executable)) {
+	    DEBUG('a', "Executable %s is cached\n", name);
+	    delete executable;
+	    *prev = image->next;
+	    image->next = images;
+	    images = image;
+	    image->refCount++;
+	    return image;
+	}
+
+    image = new ExecImage(executable);
+    delete executable;
+    if (!image->IsValid()) {
+	delete image;
+	return NULL;
+    }
+    image->name = new char[strlen(name) + 1];
+    strcpy(image->name, name);
+
+    if (numImages == ImageCacheSize) {	// throw out the oldest
+	for (prev = &images; (*prev)->next != NULL; prev = &(*prev)->next)
+	    ;
+	Release(*prev);
+	*prev = NULL;
+	numImages--;
+    }
+    image->next = images;
+    images = image;
+    numImages++;
+    image->refCount = 2;		// one for the cache, one for the caller
+    return image;
+}
+
+//----------------------------------------------------------------------
+// ImageCache::Release
+// 	Drop a reference to "image", freeing it once it is neither in
+//	the cache nor being loaded from.
+//----------------------------------------------------------------------
+
+void
+ImageCache::Release(ExecImage *image)
+{
+    ASSERT(image->refCount > 0);
+    if (--image->refCount == 0)
+	delete image;
+}
+
+//----------------------------------------------------------------------
+// ImageCache::Invalidate
+// 	The executable whose header is at "sector" is being written to
+//	or removed; forget every image of it.
+//----------------------------------------------------------------------
+
+void
+ImageCache::Invalidate(int sector)
+{
+    ExecImage **prev = &images, *image;
+
+    while ((image = *prev) != NULL)
+	if (image->sector == sector) {
+	    DEBUG('a', "Dropping the cached image of %s\n", image->name);
+	    *prev = image->next;
+	    Release(image);
+	    numImages--;
+	} else
+	    prev = &image->next;
+}
@@ -0,0 +1,71 @@
+// imagecache.h 
+//	Data structures to keep the executables of recently run programs
+//	in memory, so that running them again needs no disk I/O.
+//
+//	An ExecImage is the NOFF header of an executable, already
+//	checked and byte-swapped, plus the contents of its code and
+//	initialized data segments.  AddrSpace loads a program from one.
+//
+//	The ImageCache keeps the images of the last few programs run by
+//	Exec, under the sector of their file header.  Exec still opens
+//	the file, to find out which header its name leads to, but only
+//	reads it if that header isn't in the cache.  An image is thrown
+//	out when its file is written to or removed (cf. OpenFile::WriteAt,
+//	FileSystem::Remove, Directory::Clear), or to make room for a newer
+//	one; if Exec is still loading a program from it, it is only freed
+//	once Exec is done with it.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "filesys.h"
+#include "noff.h"
+
+#define ImageCacheSize	8		// # of programs kept
+
+class ExecImage {
+  public:
+    ExecImage(OpenFile *executable);	// read in the executable
+    ~ExecImage();
+
+    bool IsValid() { return contents != NULL; }
+					// was it a NOFF file we could read?
+    bool IsAligned() { return noffH.noffMagic == NOFFMAGICALIGNED; }
+					// made by "coff2noff -a"?
+
+    NoffHeader noffH;			// the header, in host byte order
+    int sector;				// header sector of the executable
+    char *contents;			// the file, up to the end of the
+					// initialized data; "inFileAddr"
+					// is an index into this
+    int size;				// # of bytes in "contents"
+
+    char *name;				// what Exec called it, if cached
+    int refCount;			// the cache, plus callers of Load
+					// that haven't Released it yet
+    ExecImage *next;			// next image, less recently used
+};
+
+class ImageCache {
+  public:
+    ImageCache();			// an empty cache
+    ~ImageCache();			// drop all the images
+
+    ExecImage *Load(char *name);	// the image of the executable
+					// "name", read in if need be;
+					// NULL if it can't be
+    void Release(ExecImage *image);	// done with an image from Load
+    void Invalidate(int sector);	// the executable has changed
+
+  private:
+    ExecImage *images;			// most recently used first
+    int numImages;			// # of images in the list
+};
+
+#endif // IMAGECACHE_H
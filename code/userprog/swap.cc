@@ -0,0 +1,137 @@
+// swap.cc
+//	Routines to allocate slots in the swap area, and to move pages
+//	between memory and the swap disk.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "swap.h"
+
+//----------------------------------------------------------------------
+// SwapArea::SwapArea
+// 	Initialize the swap area, with every slot free.  Whatever the
+//	swap disk held before is of no use to us.
+//
+//	"name" is the UNIX file to keep the swap disk in.
+//----------------------------------------------------------------------
+
+SwapArea::SwapArea(char *name)
+{
+    disk = new SynchDisk(name);
+    freeMap = new BitMap(NumSectors);
+    lock = new Lock("swap area");
+    pagesOut = runsOut = pagesIn = runsIn = 0;
+}
+
+SwapArea::~SwapArea()
+{
+    delete disk;
+    delete freeMap;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// SwapArea::Allocate
+// 	Find "numSlots" consecutive free slots, first fit, and mark them
+//	in use.  Returns the first of them, or -1 if there is no run
+//	that long.
+//----------------------------------------------------------------------
+
+int
+SwapArea::Allocate(int numSlots)
+{
+    int first, i;
+
+    for (first = 0; first + numSlots <= NumSectors; first = i + 1) {
+	for (i = first; i < first + numSlots; i++)
+	    if (freeMap->Test(i))
+		break;
+	if (i == first + numSlots) {
+	    for (i = first; i < first + numSlots; i++)
+		freeMap->Mark(i);
+	    return first;
+	}
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// SwapArea::Free
+// 	Give back the run of slots starting at "first".
+//----------------------------------------------------------------------
+
+void
+SwapArea::Free(int first, int numSlots)
+{
+    for (int i = first; i < first + numSlots; i++)
+	freeMap->Clear(i);
+}
+
+//----------------------------------------------------------------------
+// SwapArea::ReadPages, SwapArea::WritePages
+// 	Move "n" pages between the consecutive slots starting at "first"
+//	and the frames in "frames" (which needn't be consecutive), one
+//	sector after the other.
+//----------------------------------------------------------------------
+
+void
+SwapArea::ReadPages(int first, int *frames, int n)
+{
+    lock->Acquire();
+    for (int i = 0; i < n; i++)
+	disk->ReadSector(first + i,
+		&machine->mainMemory[frames[i] * PageSize]);
+    pagesIn += n;
+    runsIn++;
+    lock->Release();
+}
+
+void
+SwapArea::WritePages(int first, int *frames, int n)
+{
+    lock->Acquire();
+    for (int i = 0; i < n; i++)
+	disk->WriteSector(first + i,
+		&machine->mainMemory[frames[i] * PageSize]);
+    pagesOut += n;
+    runsOut++;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SwapArea::ReadSlot, SwapArea::WriteSlot
+// 	Move one page between a slot and a kernel buffer.  Used to copy
+//	the pages a forked process shares with its parent.
+//----------------------------------------------------------------------
+
+void
+SwapArea::ReadSlot(int slot, char *data)
+{
+    lock->Acquire();
+    disk->ReadSector(slot, data);
+    lock->Release();
+}
+
+void
+SwapArea::WriteSlot(int slot, char *data)
+{
+    lock->Acquire();
+    disk->WriteSector(slot, data);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SwapArea::Print
+// 	Print how many pages went out to swap and came back in.  Called
+//	when Nachos halts.
+//----------------------------------------------------------------------
+
+void
+SwapArea::Print()
+{
+    printf("Swap: %d pages written in %d runs, %d pages read in %d runs\n",
+	pagesOut, runsOut, pagesIn, runsIn);
+}
@@ -0,0 +1,60 @@
+// swap.h
+//	Data structures to manage the swap area: the disk that the pages
+//	of user programs are written out to when memory runs short.
+//
+//	The swap area is a disk of its own (the UNIX file "SWAP"), with
+//	one page per sector.  Each process is given a contiguous run of
+//	slots when it starts, one per virtual page, so that page "vpn"
+//	always goes to slot "swapBase + vpn".  Neighbouring pages then
+//	sit in neighbouring sectors, and a run of them can be written
+//	out, or read back in, one sector after the other, with a single
+//	seek (cf. AddrSpace::PageOut and AddrSpace::PageFault).
+//
+//	A run is transferred while holding a lock, so that no other
+//	swap request moves the disk head in the middle of it.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SWAP_H
+#define SWAP_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "bitmap.h"
+#include "synch.h"
+#include "synchdisk.h"
+
+#define SwapCluster	8		// most pages written out at once
+#define SwapReadAhead	4		// most pages read in on one fault
+
+class SwapArea {
+  public:
+    SwapArea(char *name);		// an empty swap area, on the disk
+					// in UNIX file "name"
+    ~SwapArea();
+
+    int Allocate(int numSlots);		// a run of "numSlots" free slots;
+					// returns the first, or -1
+    void Free(int first, int numSlots);	// give the run back
+
+    void ReadPages(int first, int *frames, int n);
+					// read slots "first" .. into frames
+    void WritePages(int first, int *frames, int n);
+					// write frames into slots "first" ..
+    void ReadSlot(int slot, char *data);	// read one slot into "data"
+    void WriteSlot(int slot, char *data);	// write "data" into one slot
+
+    void Print();			// print how much paging was done
+
+  private:
+    SynchDisk *disk;			// the swap disk
+    BitMap *freeMap;			// which slots are in use
+    Lock *lock;				// held for each run of transfers
+
+    int pagesOut, runsOut;		// pages written, in how many runs
+    int pagesIn, runsIn;		// pages read, in how many runs
+};
+
+#endif // SWAP_H
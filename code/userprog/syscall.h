@@ -29,6 +29,10 @@
 #define SC_Close	8
 #define SC_Fork		9
 #define SC_Yield	10
+#define SC_Sleep	11
+#define SC_Mmap		12
+#define SC_Munmap	13
+#define SC_Submit	14
 
 #ifndef IN_ASM
 
@@ -108,22 +112,98 @@ int Read(char *buffer, int size, OpenFileId id);
 /* Close the file, we're done reading and writing to it. */
 void Close(OpenFileId id);
 
+/* Map the first "length" bytes of the open file into the address space,
+ * and return the address they start at (0 if "length" is more than the
+ * length of the file, or they don't fit).  The pages are read from the
+ * file as they are touched, and written back, if they have been written
+ * to, when they are unmapped.  The mapping stays valid after the file
+ * is closed.
+ */
+char *Mmap(OpenFileId id, int length);
+
+/* Unmap the file mapped at "addr".  Return 0, or -1 if nothing is 
+ * mapped there.  Everything still mapped is unmapped on Exit.
+ */
+int Munmap(char *addr);
+
+/* Batched file operations.  Rather than trapping once per Open, Read,
+ * Write or Close, a program queues up requests in the submission ring
+ * of an IoRing in its own memory, and hands them all to the kernel
+ * with a single Submit.  The kernel carries them out in order, each as
+ * the system call of the same name would, and posts a completion for
+ * each in the completion ring, carrying the request's "tag" and what
+ * the system call would have returned (-1 for a bad request).
+ *
+ * Both rings hold IoRingSize entries, and are indexed by counters that
+ * only ever go up: entry "i" is at [i % IoRingSize].  The program
+ * fills sq[sqTail], then advances sqTail; the kernel advances sqHead
+ * past each request it takes.  The kernel fills cq[cqTail], then
+ * advances cqTail; the program advances cqHead past each completion it
+ * has looked at.  The kernel stops taking requests while the
+ * completion ring is full, so completions are never lost.
+ *
+ * The fields are all ints (for IoOpen, "buffer" is the address of the
+ * file name), so that the kernel and user programs agree on the layout.
+ */
+
+#define IoRingSize	16
+
+#define IoOpen		0
+#define IoClose		1
+#define IoRead		2
+#define IoWrite		3
+
+typedef struct {
+    int op;			/* IoOpen, IoClose, IoRead or IoWrite */
+    int fd;			/* the file, except for IoOpen */
+    int buffer;			/* where the data (or the name) is */
+    int size;			/* # of bytes to read or write */
+    int tag;			/* handed back in the completion */
+} IoRequest;
+
+typedef struct {
+    int tag;			/* the tag of the request */
+    int result;			/* what it returned */
+} IoCompletion;
+
+typedef struct {
+    int sqHead, sqTail;		/* submission ring counters */
+    int cqHead, cqTail;		/* completion ring counters */
+    IoRequest sq[IoRingSize];
+    IoCompletion cq[IoRingSize];
+} IoRing;
+
+/* Carry out the requests queued in "ring".  Return how many were
+ * carried out (their completions are posted when Submit returns), or
+ * -1 if "ring" isn't a valid ring in the address space.
+ */
+int Submit(IoRing *ring);
+
 
 
 /* User-level thread operations: Fork and Yield.  To allow multiple
  * threads to run within a user program. 
  */
 
-/* Fork a thread to run a procedure ("func") in the *same* address space 
- * as the current thread.
+/* Fork a new process to run a procedure ("func") in a *copy* of the
+ * address space of the current thread, starting on the current stack.
+ * The copy is made lazily: the two processes share memory until one
+ * of them writes to a page.  Return the SpaceId of the new process,
+ * to Join it.  "func" should end by calling Exit.
  */
-void Fork(void (*func)());
+SpaceId Fork(void (*func)());
 
 /* Yield the CPU to another runnable thread, whether in this address space 
  * or not. 
  */
 void Yield();		
 
+/* Put the calling thread to sleep for (at least) "ticks" ticks of
+ * simulated time.  Other threads, in this address space or not, run
+ * in the meantime.
+ */
+void Sleep(int ticks);
+
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */
@@ -0,0 +1,156 @@
+// textcache.cc 
+//	Routines to share the code pages of executables between
+//	address spaces.
+//
+//	The cache only holds a few programs (as many as fit in memory),
+//	so a linked list, searched from the front, is plenty.  As with
+//	the frame table, it is only used from inside system calls, and
+//	nothing in here blocks.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "textcache.h"
+
+TextCache::TextCache()
+{
+    entries = NULL;
+}
+
+TextCache::~TextCache()
+{
+    while (entries != NULL)
+	Remove(&entries);
+}
+
+//----------------------------------------------------------------------
+// TextCache::Find
+// 	Look for pages "firstPage" .. "firstPage + numPages - 1" of the
+//	executable whose header is at "sector".  If they are cached,
+//	move them to the front of the list, and return their frames.
+//	The caller must take its own references on the frames.
+//
+//	Returns NULL if the executable isn't cached.
+//----------------------------------------------------------------------
+
+int *
+TextCache::Find(int sector, int firstPage, int numPages)
+{
+    TextEntry **prev, *entry;
+
+    for (prev = &entries; (entry = *prev) != NULL; prev = &entry->next)
+	if (entry->sector == sector && entry->firstPage == firstPage
+		&& entry->numPages == numPages) {
+	    *prev = entry->next;
+	    entry->next = entries;
+	    entries = entry;
+	    DEBUG('a', "Sharing code pages of the executable at sector %d\n",
+		sector);
+	    return entry->frames;
+	}
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// TextCache::Insert
+// 	Remember the frames that have just been loaded with the code of
+//	the executable at "sector", taking a reference on each of them.
+//----------------------------------------------------------------------
+
+void
+TextCache::Insert(int sector, int firstPage, int numPages, int *frames)
+{
+    TextEntry *entry = new TextEntry;
+
+    Invalidate(sector);			// different pages of an old copy?
+    entry->sector = sector;
+    entry->firstPage = firstPage;
+    entry->numPages = numPages;
+    entry->frames = new int[numPages];
+    for (int i = 0; i < numPages; i++) {
+	entry->frames[i] = frames[i];
+	frameTable->Share(frames[i]);
+    }
+    entry->next = entries;
+    entries = entry;
+}
+
+//----------------------------------------------------------------------
+// TextCache::Invalidate
+// 	The executable at "sector" is being written to or removed, so
+//	its code in memory may no longer match the file.  Forget it.
+//	Processes that are running it keep their frames until they exit.
+//----------------------------------------------------------------------
+
+void
+TextCache::Invalidate(int sector)
+{
+    TextEntry **prev;
+
+    for (prev = &entries; *prev != NULL; prev = &(*prev)->next)
+	if ((*prev)->sector == sector) {
+	    Remove(prev);
+	    return;
+	}
+}
+
+//----------------------------------------------------------------------
+// TextCache::Reclaim
+// 	Put frames back on the free map until at least "numFrames" are
+//	free, or there are no more unused programs to drop.  The least
+//	recently used programs go first.
+//----------------------------------------------------------------------
+
+void
+TextCache::Reclaim(int numFrames)
+{
+    TextEntry **prev, **victim;
+
+    while (GlobalFreeMap->NumClear() < numFrames) {
+	victim = NULL;
+	for (prev = &entries; *prev != NULL; prev = &(*prev)->next)
+	    if (!InUse(*prev))
+		victim = prev;
+	if (victim == NULL)
+	    return;
+	DEBUG('a', "Dropping the cached code of sector %d\n",
+	    (*victim)->sector);
+	Remove(victim);
+    }
+}
+
+//----------------------------------------------------------------------
+// TextCache::InUse
+// 	Return TRUE if some address space maps the pages of "entry".
+//	The cache's own reference is the only one otherwise.
+//----------------------------------------------------------------------
+
+bool
+TextCache::InUse(TextEntry *entry)
+{
+    for (int i = 0; i < entry->numPages; i++)
+	if (frameTable->RefCount(entry->frames[i]) > 1)
+	    return TRUE;
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// TextCache::Remove
+// 	Unlink the entry "*prev" points to, and drop the references it
+//	holds on its frames.
+//----------------------------------------------------------------------
+
+void
+TextCache::Remove(TextEntry **prev)
+{
+    TextEntry *entry = *prev;
+
+    *prev = entry->next;
+    for (int i = 0; i < entry->numPages; i++)
+	frameTable->Release(entry->frames[i], NULL);
+    delete [] entry->frames;
+    delete entry;
+}
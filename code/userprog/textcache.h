@@ -0,0 +1,60 @@
+// textcache.h 
+//	Data structures to share the code of a program between all the
+//	processes running it.
+//
+//	When a program is loaded, the pages holding nothing but its code
+//	are remembered here, by the sector of the executable's file
+//	header.  The next process to load the same executable maps the
+//	same frames, read-only, instead of allocating new ones and
+//	reading the code from disk again.
+//
+//	The cache holds a reference (cf. frametable.h) on each of the
+//	frames, so the code stays in memory after the last process using
+//	it exits, in case the program is run again.  Programs that no
+//	process is running are thrown out, least recently used first,
+//	when memory runs short; and a program is thrown out as soon as
+//	its file is written to or removed.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TEXTCACHE_H
+#define TEXTCACHE_H
+
+#include "copyright.h"
+#include "utility.h"
+
+// The shared code pages of one executable.
+
+class TextEntry {
+  public:
+    int sector;				// header sector of the executable
+    int firstPage;			// first virtual page shared
+    int numPages;			// # of pages shared
+    int *frames;			// the frame of each page
+    TextEntry *next;			// next entry, less recently used
+};
+
+class TextCache {
+  public:
+    TextCache();			// an empty cache
+    ~TextCache();			// drop everything in the cache
+
+    int *Find(int sector, int firstPage, int numPages);
+					// the frames holding these pages
+					// of the executable, or NULL
+    void Insert(int sector, int firstPage, int numPages, int *frames);
+					// remember freshly loaded pages
+    void Invalidate(int sector);	// the executable has changed
+    void Reclaim(int numFrames);	// free up to "numFrames" frames,
+					// by dropping unused programs
+
+  private:
+    TextEntry *entries;			// most recently used first
+
+    bool InUse(TextEntry *entry);	// is a process still mapping it?
+    void Remove(TextEntry **prev);	// drop an entry, and its frames
+};
+
+#endif // TEXTCACHE_H